@@ -62,7 +62,7 @@ def build_and_render(scene_name):
     return np.copy(film.buffer())
 
 
-objloaders = ['tinyobjloader']
+objloaders = ['fast', 'tinyobjloader']
 scene_names = lmscene.scenes_small()
 
 
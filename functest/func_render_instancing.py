@@ -88,13 +88,13 @@ for i in range(1,numTheta+1):
 
 # + {"code_folding": []}
 mesh = lm.load_mesh('mesh_sphere', 'raw', {
-    'ps': vs.flatten().tolist(),
-    'ns': ns.flatten().tolist(),
-    'ts': ts.flatten().tolist(),
+    'ps': lm.buffer(vs),
+    'ns': lm.buffer(ns),
+    'ts': lm.buffer(ts),
     'fs': {
-        'p': fs.flatten().tolist(),
-        't': fs.flatten().tolist(),
-        'n': fs.flatten().tolist()
+        'p': lm.buffer(fs),
+        't': lm.buffer(fs),
+        'n': lm.buffer(fs)
     }
 })
 
@@ -38,7 +38,7 @@ lm.info()
 
 lm.comp.load_plugin(os.path.join(env.bin_path, 'objloader_tinyobjloader'))
 
-objloader_names = ['simple', 'tinyobjloader']
+objloader_names = ['simple', 'fast', 'tinyobjloader']
 scene_names = lmscene.scenes_small()
 
 loading_time_df = pd.DataFrame(columns=objloader_names, index=scene_names)
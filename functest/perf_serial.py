@@ -75,3 +75,38 @@ for scene_name in scene_names:
     scene_setup_time_df['deserialization'][scene_name] = deserialization_time
 
 scene_setup_time_df
+
+# ### Scaling of deserialization with the number of threads
+#
+# The assets are saved in separate sections and deserialized in parallel.
+
+# +
+scene_name = scene_names[-1]
+lm.reset()
+lm.load_film('film_output', 'bitmap', {
+    'w': 1920,
+    'h': 1080
+})
+accel = lm.load_accel('accel', 'sahbvh', {})
+scene = lm.load_scene('scene', 'default', {
+    'accel': accel.loc()
+})
+lmscene.load(scene, env.scene_path, scene_name)
+lm.save_state_to_file('lm.serialized')
+
+num_threads = [n for n in [1,2,4,8,16,32,64] if n <= os.cpu_count()]
+deserialization_time_df = pd.DataFrame(columns=['deserialization'], index=num_threads)
+for n in num_threads:
+    lm.parallel.init('openmp', {'num_threads': n})
+    def deserialize_scene():
+        lm.load_state_from_file('lm.serialized')
+    deserialization_time_df['deserialization'][n] = timeit.timeit(stmt=deserialize_scene, number=1)
+lm.parallel.init('openmp', {})
+# -
+
+deserialization_time_df
+
+deserialization_time_df.plot(logx=True, marker='o')
+plt.xlabel('number of threads')
+plt.ylabel('time (s)')
+plt.show()
@@ -54,6 +54,37 @@ public:
         \param path Path to the serialized asset.
     */
     virtual Component* load_serialized(const std::string& name, const std::string& path) = 0;
+
+    /*!
+        \brief Save the assets in the group to a file.
+        \param path Output path.
+
+        \rst
+        Saves the assets in a container with one section per asset and a table of contents.
+        The sections are serialized in parallel.
+        Weak references are saved as indices to a table of locators in each section,
+        so they can refer to the assets in other sections.
+        Large arrays (:cpp:class:`lm::Blob`) are saved in page-aligned blob regions
+        separated from the sections.
+        Throws an exception if failed.
+        \endrst
+    */
+    virtual void save_sections(const std::string& path) = 0;
+
+    /*!
+        \brief Load the assets saved with :cpp:func:`lm::AssetGroup::save_sections`.
+        \param path Path to the file.
+
+        \rst
+        Replaces the assets in the group with the assets in the file.
+        The sections are deserialized in parallel
+        and the weak references are resolved after all sections are loaded.
+        The file is memory-mapped and the large arrays refer to the blob regions in the mapping,
+        so that the pages are read on demand and shared among the processes loading the same file.
+        Throws an exception if failed.
+        \endrst
+    */
+    virtual void load_sections(const std::string& path) = 0;
 };
 
 /*!
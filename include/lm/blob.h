@@ -0,0 +1,206 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "serial.h"
+#include <memory>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \addtogroup serial
+    @{
+*/
+
+/*!
+    \brief Large array of plain data.
+
+    \rst
+    This class holds a large array of trivially-copyable elements, e.g., vertices of a mesh.
+    The elements are either owned by the instance or refer to a memory region
+    kept alive by the instance, e.g., a memory-mapped state file.
+
+    If the archive enables blobs, the elements are stored in the blob region as they are in memory
+    and the loaded instance refers to the elements in the region without copying.
+    The region is thus only readable by a build with the same byte order and floating point size,
+    which the state file records in its header.
+    Otherwise, the elements are serialized in the stream as ``std::vector<T>``.
+    \endrst
+*/
+template <typename T>
+class Blob {
+    static_assert(std::is_trivially_copyable_v<T>, "Blob requires trivially copyable type");
+
+private:
+    std::vector<T> owned_;              // Owned elements
+    const T* data_ = nullptr;           // Elements in the external region. nullptr if owned.
+    size_t size_ = 0;                   // Number of elements in the external region
+    std::shared_ptr<const void> owner_; // Owner of the external region
+
+public:
+    Blob() = default;
+
+    /*!
+        \brief Construct from the owned elements.
+    */
+    Blob(std::vector<T>&& v)
+        : owned_(std::move(v))
+    {}
+
+public:
+    /*!
+        \brief Check if the elements refer to an external region.
+    */
+    bool mapped() const {
+        return data_ != nullptr;
+    }
+
+    /*!
+        \brief Get pointer to the elements.
+    */
+    const T* data() const {
+        return mapped() ? data_ : owned_.data();
+    }
+
+    /*!
+        \brief Get number of elements.
+    */
+    size_t size() const {
+        return mapped() ? size_ : owned_.size();
+    }
+
+    /*!
+        \brief Check if the array is empty.
+    */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /*!
+        \brief Get an element.
+    */
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    /*!
+        \brief Get iterator to the beginning of the elements.
+    */
+    const T* begin() const {
+        return data();
+    }
+
+    /*!
+        \brief Get iterator to the end of the elements.
+    */
+    const T* end() const {
+        return data() + size();
+    }
+
+    /*!
+        \brief Get the elements as a modifiable vector.
+
+        \rst
+        If the elements refer to an external region, the elements are copied into memory.
+        \endrst
+    */
+    std::vector<T>& vec() {
+        if (mapped()) {
+            owned_.assign(data_, data_ + size_);
+            unmap();
+        }
+        return owned_;
+    }
+
+    /*!
+        \brief Remove all elements.
+    */
+    void clear() {
+        owned_.clear();
+        unmap();
+    }
+
+    /*!
+        \brief Refer to the elements in an external region.
+        \param data Pointer to the elements.
+        \param size Number of elements.
+        \param owner Owner keeping the region alive.
+    */
+    void map(const T* data, size_t size, std::shared_ptr<const void> owner) {
+        owned_.clear();
+        owned_.shrink_to_fit();
+        data_ = data;
+        size_ = size;
+        owner_ = std::move(owner);
+    }
+
+private:
+    void unmap() {
+        data_ = nullptr;
+        size_ = 0;
+        owner_.reset();
+    }
+};
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(LM_NAMESPACE)
+
+// ------------------------------------------------------------------------------------------------
+
+//! \cond
+
+LM_NAMESPACE_BEGIN(cereal)
+
+/*
+    Save function specialized for lm::Blob<T>.
+*/
+template <typename T>
+void save(lm::OutputArchive& ar, const lm::Blob<T>& blob) {
+    if (ar.blobs_enabled()) {
+        const auto size = uint64_t(blob.size());
+        const auto offset = ar.add_blob(blob.data(), blob.size() * sizeof(T));
+        ar(CEREAL_NVP_("blob", uint8_t(1)), CEREAL_NVP_("offset", offset), CEREAL_NVP_("size", size));
+    }
+    else {
+        ar(CEREAL_NVP_("blob", uint8_t(0)), CEREAL_NVP_("data", std::vector<T>(blob.begin(), blob.end())));
+    }
+}
+
+/*
+    Load function specialized for lm::Blob<T>.
+*/
+template <typename T>
+void load(lm::InputArchive& ar, lm::Blob<T>& blob) {
+    uint8_t is_blob;
+    ar(CEREAL_NVP_("blob", is_blob));
+    if (is_blob) {
+        if (!ar.blobs_enabled()) {
+            throw cereal::Exception("Blob region is not specified");
+        }
+        uint64_t offset, size;
+        ar(CEREAL_NVP_("offset", offset), CEREAL_NVP_("size", size));
+        if (size > std::numeric_limits<uint64_t>::max() / sizeof(T)) {
+            throw cereal::Exception("Invalid blob");
+        }
+        const auto* data = ar.blob(offset, size * sizeof(T));
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0) {
+            throw cereal::Exception("Misaligned blob");
+        }
+        blob.map(reinterpret_cast<const T*>(data), size_t(size), ar.blobs_owner());
+    }
+    else {
+        std::vector<T> v;
+        ar(CEREAL_NVP_("data", v));
+        blob = lm::Blob<T>(std::move(v));
+    }
+}
+
+LM_NAMESPACE_END(cereal)
+
+//! \endcond
@@ -263,6 +263,8 @@ struct LightSample;
 class Scene;
 class Accel;              // accel.h
 class Renderer;           // renderer.h
+class Sampler;            // sampler.h
+class Denoiser;           // denoiser.h
 LM_FORWARD_DECLARE_WITH_NAMESPACE(comp::detail, struct Access)
 
 // ------------------------------------------------------------------------------------------------
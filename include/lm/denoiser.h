@@ -0,0 +1,50 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "component.h"
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \addtogroup denoiser
+    @{
+*/
+
+/*!
+    \brief Denoiser component interface.
+
+    \rst
+    This interface provides a post process to reduce the noise of the rendered images.
+    The implementation can use the auxiliary features of the scene,
+    e.g., albedo, normal, or depth, rendered in the same pass as the image
+    as AOV channels of the film.
+    A denoiser can be executed directly after :cpp:func:`lm::Renderer::render`
+    or specified in the renderer to be executed at the end of the rendering.
+    \endrst
+*/
+class Denoiser : public Component {
+public:
+    /*!
+        \brief Denoise a film.
+        \param input Input film.
+        \param output Output film.
+
+        \rst
+        This function reads the normalized values of the input film
+        and writes the denoised values to the output film.
+        The output film must have the same size as the input film
+        and can be the same as the input film.
+        \endrst
+    */
+    virtual void denoise(Film* input, Film* output) const = 0;
+};
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -41,6 +41,7 @@ struct FilmBuffer {
     int w;          //!< Width of the buffer.
     int h;          //!< Height of the buffer.
     Float* data;    //!< Data.
+    int c = 3;      //!< Number of components per pixel.
 };
 
 /*!
@@ -139,9 +140,104 @@ public:
 
     /*!
         \brief Clear the film.
+
+        \rst
+        This function also resets the accumulated weight to zero.
+        \endrst
     */
     virtual void clear() = 0;
 
+    /*!
+        \brief Get accumulated weight.
+        \return Accumulated weight.
+
+        \rst
+        In progressive accumulation, renderers keep the unnormalized sum of the contributions
+        in the film and add the weight of the samples with :cpp:func:`add_weight`,
+        e.g., the number of samples per pixel.
+        The film outputs the normalized values, i.e., the sum divided by the weight,
+        from :cpp:func:`save` and :cpp:func:`buffer` functions.
+        If the weight is zero, the pixel values are output as they are.
+        The default implementation returns zero for films not supporting the accumulation.
+        \endrst
+    */
+    virtual Float weight() const {
+        return 0_f;
+    }
+
+    /*!
+        \brief Add weight for the normalization of the accumulated values.
+        \param w Weight.
+
+        \rst
+        The default implementation ignores the weight.
+        \endrst
+    */
+    virtual void add_weight(Float w) {
+        LM_UNUSED(w);
+    }
+
+    /*!
+        \brief Add an arbitrary output variable (AOV) channel.
+        \param name Name of the channel.
+        \param components Number of components per pixel (1 or 3).
+        \return Index of the channel. -1 if the film does not support AOVs.
+
+        \rst
+        AOV channels store auxiliary values per pixel, e.g., albedo, normal, or depth,
+        which renderers write in the same pass as the color with :cpp:func:`splat_aov`.
+        The channels share the accumulated weight of the film.
+        Therefore :cpp:func:`clear`, :cpp:func:`rescale`, and the normalization by the weight
+        are applied to the channels as well as the color.
+        If the channel with the same name already exists, the function returns its index.
+        \endrst
+    */
+    virtual int add_aov(const std::string& name, int components) {
+        LM_UNUSED(name, components);
+        return -1;
+    }
+
+    /*!
+        \brief Get index of an AOV channel.
+        \param name Name of the channel.
+        \return Index of the channel. -1 if not found.
+    */
+    virtual int aov_index(const std::string& name) const {
+        LM_UNUSED(name);
+        return -1;
+    }
+
+    /*!
+        \brief Splat a value to an AOV channel by pixel coordinates.
+        \param index Index of the channel.
+        \param x x coordinate of the film.
+        \param y y coordinate of the film.
+        \param v Value. Only the first component is used for single-component channels.
+
+        \rst
+        This function is thread-safe.
+        \endrst
+    */
+    virtual void splat_aov(int index, int x, int y, Vec3 v) {
+        LM_UNUSED(index, x, y, v);
+    }
+
+    /*!
+        \brief Get buffer of an AOV channel.
+        \param index Index of the channel.
+        \return Film buffer containing the normalized values.
+
+        \rst
+        The buffer contains ``c`` components per pixel
+        where ``c`` is the number of components of the channel.
+        The buffer becomes invalid if the film is deleted.
+        \endrst
+    */
+    virtual FilmBuffer aov_buffer(int index) {
+        LM_UNUSED(index);
+        return { 0, 0, nullptr, 0 };
+    }
+
 public:
     /*!
         \brief Get aspect ratio.
@@ -203,6 +299,17 @@ public:
         const auto p = raster_to_pixel(rp);
         splat_pixel(p.x, p.y, v);
     }
+
+    /*!
+        \brief Splat a value to an AOV channel.
+        \param index Index of the channel.
+        \param rp Raster position.
+        \param v Value.
+    */
+    void splat_aov(int index, Vec2 rp, Vec3 v) {
+        const auto p = raster_to_pixel(rp);
+        splat_aov(index, p.x, p.y, v);
+    }
 };
 
 /*!
@@ -32,6 +32,186 @@ inline lm::Json operator "" _lmJson(const char* s, size_t n) {
 
 // ------------------------------------------------------------------------------------------------
 
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+LM_NAMESPACE_BEGIN(json)
+
+LM_NAMESPACE_BEGIN(detail)
+
+// Name of the element type of buffer
+template <typename T> constexpr const char* buffer_type_name();
+template <> constexpr const char* buffer_type_name<float>() { return "float32"; }
+template <> constexpr const char* buffer_type_name<double>() { return "float64"; }
+template <> constexpr const char* buffer_type_name<std::int32_t>() { return "int32"; }
+template <> constexpr const char* buffer_type_name<std::int64_t>() { return "int64"; }
+template <> constexpr const char* buffer_type_name<std::uint32_t>() { return "uint32"; }
+template <> constexpr const char* buffer_type_name<std::uint64_t>() { return "uint64"; }
+
+LM_NAMESPACE_END(detail)
+
+/*!
+    \addtogroup json
+    @{
+*/
+
+/*!
+    \brief Memory region of a buffer.
+*/
+struct BufferView {
+    std::string type;   //!< Element type (``float32``, ``float64``, ``int32``, ``int64``, ``uint32``, or ``uint64``).
+    const void* data;   //!< Pointer to the contiguous array.
+    size_t size;        //!< Number of elements.
+};
+
+/*!
+    \brief Scoped registration of a buffer.
+
+    \rst
+    A buffer is an external contiguous array passed to the components without converting
+    the elements into a Json array. This is useful to pass large arrays to the components,
+    e.g., Python binding registers numpy arrays wrapped by ``lm.buffer()``.
+    The array is registered in a process-wide table during the lifetime of this object
+    and the Json object only holds the reference to the entry, never the address of the array.
+    The reference becomes invalid after the object is destructed,
+    so the components must not keep the reference after construction.
+    Use :cpp:func:`lm::json::array_size` and :cpp:func:`lm::json::copy_array`
+    to read an array given either as a buffer or a Json array.
+    \endrst
+*/
+class ScopedBuffer {
+private:
+    std::uint64_t id_;
+
+public:
+    /*!
+        \brief Register a buffer.
+        \param type Element type.
+        \param data Pointer to the contiguous array.
+        \param size Number of elements.
+    */
+    LM_PUBLIC_API ScopedBuffer(const std::string& type, const void* data, size_t size);
+
+    /*!
+        \brief Register a typed buffer.
+        \param data Pointer to the contiguous array.
+        \param size Number of elements.
+    */
+    template <typename T>
+    ScopedBuffer(const T* data, size_t size)
+        : ScopedBuffer(detail::buffer_type_name<T>(), data, size)
+    {}
+
+    LM_PUBLIC_API ~ScopedBuffer();
+    LM_DISABLE_COPY_AND_MOVE(ScopedBuffer)
+
+    /*!
+        \brief Get Json object referencing the buffer.
+    */
+    Json ref() const {
+        return { {"buffer_", id_} };
+    }
+};
+
+/*!
+    \brief Check if the Json object references a buffer.
+*/
+LM_INLINE bool is_buffer_view(const Json& j) {
+    return j.is_object() && j.find("buffer_") != j.end();
+}
+
+/*!
+    \brief Get the buffer referenced by the Json object.
+
+    \rst
+    This function throws an exception if the buffer is not registered.
+    \endrst
+*/
+LM_PUBLIC_API BufferView buffer_view(const Json& j);
+
+/*!
+    \brief Parse a Json text.
+    \param s Json text.
+
+    \rst
+    Buffers can only be passed by the caller registering them.
+    This function rejects the objects of the same form as the buffer references,
+    so the text from external sources, e.g., scene files or network requests, cannot refer to them.
+    \endrst
+*/
+LM_PUBLIC_API Json parse(const std::string& s);
+
+/*!
+    \brief Get number of elements of an array given as a buffer or a Json array.
+*/
+LM_INLINE size_t array_size(const Json& j) {
+    if (is_buffer_view(j)) {
+        return buffer_view(j).size;
+    }
+    if (!j.is_array()) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument,
+            "Invalid JSON type [expected='array', actual='{}']", j.type_name());
+    }
+    return j.size();
+}
+
+/*!
+    \brief Copy elements of an array given as a buffer or a Json array.
+    \param j Buffer reference or Json array.
+    \param out Output array.
+    \param n Number of elements to copy.
+
+    \rst
+    If the buffer has the same element type as ``T``,
+    the elements are copied with a single ``memcpy``.
+    Otherwise the elements are converted to ``T``.
+    \endrst
+*/
+template <typename T>
+void copy_array(const Json& j, T* out, size_t n) {
+    if (n > array_size(j)) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument,
+            "Invalid number of elements [expected={}, actual={}]", n, array_size(j));
+    }
+    if (n == 0) {
+        return;
+    }
+    if (!is_buffer_view(j)) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = j[i].get<T>();
+        }
+        return;
+    }
+    const auto b = buffer_view(j);
+    const auto& type = b.type;
+    const auto* data = b.data;
+    if (type == detail::buffer_type_name<T>()) {
+        std::memcpy(out, data, n * sizeof(T));
+        return;
+    }
+    const auto convert = [&](const auto* p) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = static_cast<T>(p[i]);
+        }
+    };
+    if      (type == "float32") { convert((const float*)data); }
+    else if (type == "float64") { convert((const double*)data); }
+    else if (type == "int32")   { convert((const std::int32_t*)data); }
+    else if (type == "int64")   { convert((const std::int64_t*)data); }
+    else if (type == "uint32")  { convert((const std::uint32_t*)data); }
+    else if (type == "uint64")  { convert((const std::uint64_t*)data); }
+    else {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Unsupported buffer type [type='{}']", type);
+    }
+}
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(json)
+LM_NAMESPACE_END(LM_NAMESPACE)
+
+// ------------------------------------------------------------------------------------------------
+
 LM_NAMESPACE_BEGIN(nlohmann)
 
 template <int N, typename T, glm::qualifier Q>
@@ -45,6 +225,14 @@ struct adl_serializer<glm::vec<N, T, Q>> {
         j = std::move(a);
     }
     static void from_json(const lm::Json& j, VecT& v) {
+        if (lm::json::is_buffer_view(j)) {
+            if (lm::json::array_size(j) != N) {
+                LM_THROW_EXCEPTION(lm::Error::InvalidArgument,
+                    "Invalid number of elements [expected={}, actual={}]", N, lm::json::array_size(j));
+            }
+            lm::json::copy_array(j, &v[0], N);
+            return;
+        }
         if (!j.is_array()) {
             LM_THROW_EXCEPTION(lm::Error::InvalidArgument,
                 "Invalid JSON type [expected='array', actual='{}']", j.type_name());
@@ -176,7 +364,7 @@ LM_INLINE Json merge(const Json& j1, const Json& j2) {
 */
 template <size_t N>
 Json parse_positional_args(int argc, char** argv, const std::string& temp) {
-    return Json::parse(detail::format_with_string_vector<N>(temp, { argv + 1, argv + argc }));
+    return parse(detail::format_with_string_vector<N>(temp, { argv + 1, argv + argc }));
 }
 
 /*!
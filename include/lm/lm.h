@@ -34,5 +34,8 @@
 #include "film.h"
 #include "model.h"
 #include "objloader.h"
+#include "mappedfile.h"
 #include "renderer.h"
+#include "sampler.h"
+#include "denoiser.h"
 #include "assetgroup.h"
\ No newline at end of file
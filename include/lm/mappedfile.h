@@ -0,0 +1,77 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "common.h"
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \addtogroup mappedfile
+    @{
+*/
+
+/*!
+    \brief Read-only view of the contents of a file.
+
+    \rst
+    The file is memory-mapped if the platform supports (Linux and macOS),
+    otherwise the contents are read into memory.
+    The mapped pages are shared with the page cache, so the same file opened
+    by multiple processes occupies the physical memory only once.
+    The view is valid until the object is closed or destructed.
+    \endrst
+*/
+class MappedFile {
+private:
+    const char* data_ = nullptr;    // Pointer to the beginning of the contents
+    size_t size_ = 0;               // Size of the contents in bytes
+    void* handle_ = nullptr;        // Mapped region or buffer. nullptr if empty.
+
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    LM_DISABLE_COPY_AND_MOVE(MappedFile)
+
+public:
+    /*!
+        \brief Open a file.
+        \param path Path to the file.
+        \return False if failed to open the file.
+    */
+    LM_PUBLIC_API bool open(const std::string& path);
+
+    /*!
+        \brief Close the file.
+    */
+    LM_PUBLIC_API void close();
+
+    /*!
+        \brief Get pointer to the beginning of the contents.
+    */
+    const char* data() const { return data_; }
+
+    /*!
+        \brief Get the size of the contents in bytes.
+    */
+    size_t size() const { return size_; }
+
+    /*!
+        \brief Get pointer to the beginning of the contents.
+    */
+    const char* begin() const { return data_; }
+
+    /*!
+        \brief Get pointer to the end of the contents.
+    */
+    const char* end() const { return data_ + size_; }
+};
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(LM_NAMESPACE)
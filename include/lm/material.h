@@ -54,6 +54,17 @@ public:
     */
     virtual bool is_specular(const PointGeometry& geom, int comp) const = 0;
 
+    /*!
+        \brief Check if the material uses textures.
+
+        \rst
+        The renderers compute the texture footprint only for the textured materials.
+        \endrst
+    */
+    virtual bool is_textured() const {
+        return false;
+    }
+
     /*!
         \brief Sample a ray given surface point and incident direction.
         \param rng Random number generator.
@@ -180,20 +180,78 @@ struct Bound {
 
 LM_NAMESPACE_BEGIN(detail)
 
+// Generate a sample value with the sampler (sampler.h)
+LM_PUBLIC_API Float sampler_u(const Sampler* sampler, long long pixel_index, long long sample_index, int dim);
+
+/*
+    Random number generator based on PCG32 [O'Neill2014].
+    The state is 16 bytes and a number is generated by a few integer operations,
+    compared to 2.5KB of state of std::mt19937.
+    The generator can be initialized by a hash of the pixel and sample indices
+    so that the generated numbers are independent of the thread executing the sample.
+
+    [O'Neill2014] M. E. O'Neill. PCG: A family of simple fast space-efficient
+                  statistically good algorithms for random number generation. 2014.
+*/
 class RngImplBase {
 private:
-    std::mt19937 eng_;
-    std::uniform_real_distribution<double> dist_;  // Always use double
+    uint64_t state_;
+    uint64_t inc_;
+
+protected:
+    // Sampler providing the values of the dimensions of a sample.
+    // If nullptr, the values are generated by the random number generator.
+    const Sampler* sampler_ = nullptr;
+    long long pixel_index_ = 0;
+    long long sample_index_ = 0;
+    int dim_ = 0;
 
 protected:
     RngImplBase() {
-        // Initialize eng_ with random_device
-        eng_.seed(std::random_device{}());
+        // Initialize with random_device
+        std::random_device rd;
+        seed((uint64_t(rd()) << 32) | rd(), rd());
+    }
+    RngImplBase(int seed_value) {
+        seed(uint64_t(seed_value), 0);
+    }
+    RngImplBase(unsigned int seed_value, long long pixel_index, long long sample_index, const Sampler* sampler)
+        : sampler_(sampler)
+        , pixel_index_(pixel_index)
+        , sample_index_(sample_index)
+    {
+        seed(mix(mix(uint64_t(pixel_index)) ^ uint64_t(sample_index)), seed_value);
+    }
+
+    // Value of the next dimension generated by the sampler
+    Float next_sampler_u() {
+        return sampler_u(sampler_, pixel_index_, sample_index_, dim_++);
+    }
+
+    // Generate 32-bit random integer
+    uint32_t next() {
+        const uint64_t old = state_;
+        state_ = old * 6364136223846793005ULL + inc_;
+        const auto xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+        const auto rot = uint32_t(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
     }
-    RngImplBase(int seed) {
-        eng_.seed(seed);
+
+private:
+    void seed(uint64_t init_state, uint64_t init_seq) {
+        state_ = 0;
+        inc_ = (init_seq << 1) | 1;
+        next();
+        state_ += init_state;
+        next();
+    }
+
+    // Finalizer of SplitMix64 to decorrelate consecutive indices
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
     }
-    double u() { return dist_(eng_); }
 };
 
 template <typename F>
@@ -204,7 +262,17 @@ class RngImpl<double> : public RngImplBase {
 public:
     RngImpl() = default;
     RngImpl(int seed) : RngImplBase(seed) {}
-    using RngImplBase::u;
+    RngImpl(unsigned int seed, long long pixel_index, long long sample_index, const Sampler* sampler = nullptr)
+        : RngImplBase(seed, pixel_index, sample_index, sampler) {}
+
+    // Use 53 bits of two 32-bit integers to fill the mantissa
+    double u() {
+        if (sampler_) {
+            return double(next_sampler_u());
+        }
+        const uint64_t v = (uint64_t(next()) << 32) | next();
+        return double(v >> 11) * 0x1p-53;
+    }
 };
 
 template <>
@@ -212,25 +280,19 @@ class RngImpl<float> : public RngImplBase {
 public:
     RngImpl() = default;
     RngImpl(int seed) : RngImplBase(seed) {}
+    RngImpl(unsigned int seed, long long pixel_index, long long sample_index, const Sampler* sampler = nullptr)
+        : RngImplBase(seed, pixel_index, sample_index, sampler) {}
 
     /*
-        According to the C++ standard std::uniform_real_distribution::operator()
-        always returns non-inclusive range. For instance, in our case u()
-        should return values in [0,1). Yet due to the rounding issue
-        the function might return exact value of 1.f when std::uniform_real_distribution is
-        specialized for float. To avoid this problem, we generate
-        the number with double then round it toward negative infinity
-        rather than generating the number with float directly.
-        cf. https://stackoverflow.com/questions/25668600/is-1-0-a-valid-output-from-stdgenerate-canonical
+        Use upper 24 bits to fill the mantissa.
+        Unlike the conversion from double, the value is exactly representable
+        thus the function never returns 1.f due to the rounding.
     */
     float u() {
-        const double rd = RngImplBase::u();
-        float rf = static_cast<float>(rd);
-        if (rf > rd) {
-            rf = std::nextafter(rf, -std::numeric_limits<float>::infinity());
+        if (sampler_) {
+            return float(next_sampler_u());
         }
-        assert(rf < 1.f);
-        return rf;
+        return float(next() >> 8) * 0x1p-24f;
     }
 };
 
@@ -249,6 +311,7 @@ LM_NAMESPACE_END(detail)
     Various random variables are defined based on the uniform random number
     generated by this class. Note that the class internally holds the state
     therefore the member function calls are `not` thread-safe.
+    The generator is based on PCG32 and holds 16 bytes of state.
 
     .. We manually documented the member functions
        because doxygen is not good at documenting template specializations.
@@ -259,6 +322,19 @@ LM_NAMESPACE_END(detail)
 
        Construct the random number generator by a given seed value.
 
+    .. cpp:function:: Rng(unsigned int seed, long long pixel_index, long long sample_index)
+
+       Construct the random number generator for a sample.
+       The generated sequence is a function of the arguments,
+       where the i-th call of ``u()`` corresponds to the i-th dimension of the sample.
+       This makes the result independent of the number of threads and the scheduling.
+
+    .. cpp:function:: Rng(unsigned int seed, long long pixel_index, long long sample_index, const Sampler* sampler)
+
+       Construct the random number generator for a sample where the values are generated
+       by the sampler. The i-th call of ``u()`` returns the value of the i-th dimension
+       given by :cpp:func:`lm::Sampler::u`.
+
     .. cpp:function:: Float u()
 
        Generate an uniform random number in [0,1).
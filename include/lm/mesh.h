@@ -91,6 +91,24 @@ public:
     virtual int num_triangles() const = 0;
 };
 
+LM_NAMESPACE_BEGIN(mesh)
+
+/*!
+    \brief Save a mesh in the binary mesh format.
+    \param mesh Mesh to be saved.
+    \param path Output path.
+
+    \rst
+    This function converts any mesh into the binary mesh format
+    loadable with ``mesh::binary`` component.
+    The vertices shared among the triangles are deduplicated.
+    Throws an exception if failed to write the file.
+    \endrst
+*/
+LM_PUBLIC_API void save_binary(const Mesh* mesh, const std::string& path);
+
+LM_NAMESPACE_END(mesh)
+
 /*!
     @}
 */
@@ -7,6 +7,8 @@
 
 #include "common.h"
 #include "jsontype.h"
+#include <atomic>
+#include <chrono>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 LM_NAMESPACE_BEGIN(parallel)
@@ -43,6 +45,18 @@ LM_PUBLIC_API void init(const std::string& type = DefaultType, const Json& prop
 */
 LM_PUBLIC_API void shutdown();
 
+/*!
+    \brief Check if the parallel context is initialized.
+    \return `true` if the context is initialized, `false` otherwise.
+
+    \rst
+    Components that can work without the parallel subsystem,
+    e.g., those used in the serialization, can fall back to serial execution
+    if this function returns `false`.
+    \endrst
+*/
+LM_PUBLIC_API bool initialized();
+
 /*!
     \brief Get number of threads configured for the subsystem.
     \return Number of threads.
@@ -55,6 +69,129 @@ LM_PUBLIC_API int num_threads();
 */
 LM_PUBLIC_API bool main_thread();
 
+/*!
+    \brief Get number of NUMA nodes used by the subsystem.
+    \return Number of NUMA nodes.
+
+    \rst
+    If the parallel subsystem is not aware of NUMA,
+    the function returns 1.
+    \endrst
+*/
+LM_PUBLIC_API int num_numa_nodes();
+
+/*!
+    \brief Get NUMA node of the current thread.
+    \return NUMA node index in `0 ... num_numa_nodes()-1`.
+
+    \rst
+    The function returns the NUMA node which the current thread is pinned to.
+    If the current thread is not pinned, the function returns 0.
+    \endrst
+*/
+LM_PUBLIC_API int numa_node();
+
+/*!
+    \brief Callback function called for each NUMA node.
+    \param node NUMA node index.
+*/
+using NumaNodeFunc = std::function<void(int node)>;
+
+/*!
+    \brief Execute a function on each NUMA node.
+    \param func Callback function.
+
+    \rst
+    The function calls ``func`` once for each NUMA node
+    from a thread running on the node.
+    This function is useful to replicate read-only data to each node,
+    because the memory is allocated in the node of the thread first touching it.
+    \endrst
+*/
+LM_PUBLIC_API void foreach_numa_node(const NumaNodeFunc& func);
+
+/*!
+    \brief Cancellation token for parallel loops.
+
+    \rst
+    A token is cancelled either explicitly by :cpp:func:`cancel`
+    or implicitly when the current time passes the deadline.
+    Parallel loops given a token check the state at the granularity of chunks
+    and stop dispatching remaining iterations once the token is cancelled.
+    The iterations being processed are not interrupted.
+    :cpp:func:`cancel` only stores an atomic flag,
+    so it is safe to call the function from other threads or signal handlers.
+    \endrst
+*/
+class CancelToken {
+private:
+    using Clock = std::chrono::steady_clock;
+    std::atomic<bool> cancelled_ = false;   // True if cancellation is requested
+    std::atomic<Clock::rep> deadline_ = 0;  // Deadline in ticks of the clock. 0 if not set.
+
+public:
+    CancelToken() = default;
+    LM_DISABLE_COPY_AND_MOVE(CancelToken)
+
+public:
+    /*!
+        \brief Request cancellation.
+    */
+    void cancel() {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    /*!
+        \brief Set absolute deadline.
+        \param deadline Time point after which the token is cancelled.
+    */
+    void set_deadline(Clock::time_point deadline) {
+        deadline_.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    /*!
+        \brief Set deadline relative to the current time.
+        \param seconds Time in seconds from now.
+    */
+    void set_timeout(double seconds) {
+        using namespace std::chrono;
+        set_deadline(Clock::now() + duration_cast<Clock::duration>(duration<double>(seconds)));
+    }
+
+    /*!
+        \brief Clear cancellation request and deadline.
+    */
+    void reset() {
+        cancelled_.store(false, std::memory_order_relaxed);
+        deadline_.store(0, std::memory_order_relaxed);
+    }
+
+    /*!
+        \brief Check if the token is cancelled.
+        \return `true` if cancellation is requested or the deadline has passed.
+    */
+    bool cancelled() const {
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        const auto deadline = deadline_.load(std::memory_order_relaxed);
+        return deadline != 0 && Clock::now().time_since_epoch().count() >= deadline;
+    }
+};
+
+/*!
+    \brief Get global cancellation token.
+    \return Reference to the token.
+
+    \rst
+    The global token is checked by the schedulers dispatching rendering loops.
+    Cancelling the token makes the running renderer return with partial result.
+    The token is not reset automatically; call :cpp:func:`CancelToken::reset`
+    before starting the next rendering.
+    \endrst
+*/
+LM_PUBLIC_API CancelToken& cancel_token();
+
 /*!
     \brief Callback function for parallel process.
     \param index Index of iteration.
@@ -73,22 +210,76 @@ using ProgressUpdateFunc = std::function<void(long long processed)>;
     \param num_samples Total number of samples.
     \param process_func Callback function called for each iteration.
     \param progress_func Callback function called for each progress update.
+    \param token Cancellation token. If nullptr, the loop is not cancellable.
+    \return Number of processed samples.
 
     \rst
     We provide an abstraction for the parallel loop specifialized for rendering purpose.
+    If the loop is cancelled, the returned number is smaller than ``num_samples``.
     \endrst
 */
-LM_PUBLIC_API void foreach(long long num_samples, const ParallelProcessFunc& process_func, const ProgressUpdateFunc& progress_func);
+LM_PUBLIC_API long long foreach(long long num_samples, const ParallelProcessFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token = nullptr);
 
 /*!
     \brief Parallel for loop.
     \param num_samples Total number of samples.
     \param process_func Callback function called for each iteration.
+    \return Number of processed samples.
+*/
+LM_INLINE long long foreach(long long num_samples, const ParallelProcessFunc& process_func) {
+    return foreach(num_samples, process_func, [](long long) {});
+}
+
+/*!
+    \brief Callback function for range-based parallel process.
+    \param begin Index of the first iteration in the range.
+    \param end Index next to the last iteration in the range.
+    \param threadid Thread identifier in `0 ... num_threads()-1`.
+*/
+using ParallelProcessRangeFunc = std::function<void(long long begin, long long end, int threadid)>;
+
+/*!
+    \brief Range-based parallel for loop.
+    \param num_samples Total number of samples.
+    \param grain Number of samples processed by a single callback invocation.
+    \param process_func Callback function called for each range of iterations.
+    \param progress_func Callback function called for each progress update.
+    \param token Cancellation token. If nullptr, the loop is not cancellable.
+    \return Number of processed samples.
+
+    \rst
+    This function splits the iteration space ``[0,num_samples)`` into contiguous ranges
+    of ``grain`` samples (the last range can be smaller) and calls ``process_func``
+    once for each range. Compared to :cpp:func:`lm::parallel::foreach`,
+    the callback can hoist per-range setup like scratch buffers or random number generators
+    out of the loop and iterates the range without an indirect call per sample.
+    The cancellation token is checked before dispatching each range,
+    and the returned number counts the samples in the completed ranges.
+    \endrst
+*/
+LM_PUBLIC_API long long foreach_range(long long num_samples, long long grain, const ParallelProcessRangeFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token = nullptr);
+
+/*!
+    \brief Range-based parallel for loop.
+    \param num_samples Total number of samples.
+    \param grain Number of samples processed by a single callback invocation.
+    \param process_func Callback function called for each range of iterations.
+    \return Number of processed samples.
 */
-LM_INLINE void foreach(long long num_samples, const ParallelProcessFunc& process_func) {
-    foreach(num_samples, process_func, [](long long) {});
+LM_INLINE long long foreach_range(long long num_samples, long long grain, const ParallelProcessRangeFunc& process_func) {
+    return foreach_range(num_samples, grain, process_func, [](long long) {});
 }
 
+/*!
+    \brief Scoped guard of `init` and `shutdown` functions.
+*/
+class ScopedInit {
+public:
+    ScopedInit(const std::string& type = DefaultType, const Json& prop = {}) { init(type, prop); }
+    ~ScopedInit() { shutdown(); }
+    LM_DISABLE_COPY_AND_MOVE(ScopedInit)
+};
+
 /*!
     @}
 */
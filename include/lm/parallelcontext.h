@@ -7,6 +7,8 @@
 
 #include "parallel.h"
 #include "component.h"
+#include <atomic>
+#include <algorithm>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 LM_NAMESPACE_BEGIN(parallel)
@@ -29,7 +31,34 @@ class ParallelContext : public Component {
 public:
     virtual int num_threads() const = 0;
     virtual bool main_thread() const = 0;
-    virtual void foreach(long long numSamples, const ParallelProcessFunc& processFunc, const ProgressUpdateFunc& progressFunc) const = 0;
+    virtual int num_numa_nodes() const { return 1; }
+    virtual int numa_node() const { return 0; }
+    virtual void foreach_numa_node(const NumaNodeFunc& func) const { func(0); }
+    virtual long long foreach(long long numSamples, const ParallelProcessFunc& processFunc, const ProgressUpdateFunc& progressFunc, const CancelToken* token) const = 0;
+
+    /*!
+        \brief Range-based parallel for loop.
+
+        \rst
+        The default implementation dispatches each range with :cpp:func:`foreach`
+        iterating over the number of ranges.
+        The implementation may override this function to provide more efficient scheduling.
+        \endrst
+    */
+    virtual long long foreach_range(long long num_samples, long long grain, const ParallelProcessRangeFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token) const {
+        grain = std::max(1LL, grain);
+        const long long num_ranges = (num_samples + grain - 1) / grain;
+        std::atomic<long long> processed = 0;
+        foreach(num_ranges, [&](long long index, int threadid) {
+            const long long begin = index * grain;
+            const long long end = std::min(begin + grain, num_samples);
+            process_func(begin, end, threadid);
+            processed += end - begin;
+        }, [&](long long) {
+            progress_func(processed);
+        }, token);
+        return processed;
+    }
 };
 
 /*!
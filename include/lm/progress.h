@@ -94,6 +94,20 @@ LM_PUBLIC_API void update(long long processed);
 */
 LM_PUBLIC_API void update_time(Float elapsed);
 
+/*!
+    \brief Get ratio of the progress.
+    \return Ratio in ``[0,1]``.
+
+    \rst
+    This function returns the progress of the latest report
+    independently of the underlying progress reporter.
+    The function is safe to call from the threads other than the one reporting the progress.
+    After the report is ended, the function keeps returning the last ratio
+    until the next report starts.
+    \endrst
+*/
+LM_PUBLIC_API double ratio();
+
 /*!
     \brief Scoped guard of `start` and `end` functions.
 */
@@ -13,6 +13,27 @@
 
 // ------------------------------------------------------------------------------------------------
 
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \brief Numpy array passed to the components as a buffer.
+
+    \rst
+    The type caster of Json converts this object into a reference to a buffer
+    registered during the call (see :cpp:class:`lm::json::ScopedBuffer`),
+    instead of converting the elements into a Json array.
+    The object is created by ``lm.buffer()``.
+    \endrst
+*/
+struct PyBuffer {
+    pybind11::array array;  // C-contiguous numpy array
+    std::string type;       // Element type
+};
+
+LM_NAMESPACE_END(LM_NAMESPACE)
+
+// ------------------------------------------------------------------------------------------------
+
 LM_NAMESPACE_BEGIN(pybind11::detail)
 
 // Type caster for json type
@@ -54,11 +75,22 @@ public:
                 if (!kconv.load(it.first.ptr(), convert) || !vconv.load(it.second.ptr(), convert)) {
                     return false;
                 }
+                if (cast_op<std::string&>(kconv) == "buffer_") {
+                    LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Use lm.buffer() to pass buffers");
+                }
+                keep_buffers(vconv);
                 value.emplace(
                     cast_op<std::string&&>(std::move(kconv)),
                     cast_op<lm::Json&&>(std::move(vconv)));
             }
         }
+        else if (isinstance<lm::PyBuffer>(src)) {
+            // Numpy array wrapped by lm.buffer() is passed without converting the elements.
+            // The buffer is registered until this caster is destructed after the call.
+            const auto& b = src.cast<const lm::PyBuffer&>();
+            buffers_.push_back(std::make_shared<lm::json::ScopedBuffer>(b.type, b.array.data(), size_t(b.array.size())));
+            value = buffers_.back()->ref();
+        }
         else if (isinstance<sequence>(src)) {
             auto s = reinterpret_borrow<sequence>(src);
             value = lm::Json(value_t::array);
@@ -67,6 +99,7 @@ public:
                 if (!vconv.load(it, convert)) {
                     return false;
                 }
+                keep_buffers(vconv);
                 value.push_back(cast_op<lm::Json&&>(std::move(vconv)));
             }
         }
@@ -100,6 +133,11 @@ public:
                 return cast_to_python_object<std::string>(src, policy, std::move(parent));
             }
             case value_t::object: {
+                if (lm::json::is_buffer_view(src)) {
+                    // Buffer is returned as a copy of the elements
+                    const auto b = lm::json::buffer_view(src);
+                    return array(dtype(b.type), { ssize_t(b.size) }, b.data).release();
+                }
                 auto policy_key = return_value_policy_override<std::string>::policy(policy);
                 auto policy_value = return_value_policy_override<lm::Json>::policy(policy);
                 dict d;
@@ -139,6 +177,14 @@ public:
     }
 
 private:
+    // Buffers registered during the call
+    std::vector<std::shared_ptr<lm::json::ScopedBuffer>> buffers_;
+
+    // Keep the buffers registered by the caster of an element
+    void keep_buffers(const type_caster& conv) {
+        buffers_.insert(buffers_.end(), conv.buffers_.begin(), conv.buffers_.end());
+    }
+
     template <typename U>
     static handle cast_to_python_object(const lm::Json& src, return_value_policy policy, handle&& parent) {
         auto p = return_value_policy_override<U>::policy(policy);
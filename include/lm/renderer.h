@@ -25,6 +25,70 @@ public:
     virtual void render() const = 0;
 };
 
+/*!
+    \brief Handle of asynchronous rendering.
+
+    \rst
+    The handle is returned by :cpp:func:`lm::render_async`.
+    The rendering is processed in a background thread.
+    Destroying the handle waits for the completion of the rendering.
+    \endrst
+*/
+class RenderJob {
+public:
+    virtual ~RenderJob() = default;
+
+    /*!
+        \brief Wait for the completion of the rendering.
+
+        \rst
+        If an exception is thrown during the rendering,
+        the function rethrows the exception.
+        \endrst
+    */
+    virtual void wait() = 0;
+
+    /*!
+        \brief Check if the rendering is completed.
+        \return `true` if completed, `false` otherwise.
+    */
+    virtual bool poll() const = 0;
+
+    /*!
+        \brief Request cancellation of the rendering.
+
+        \rst
+        The function cancels the global cancellation token :cpp:func:`lm::parallel::cancel_token`
+        and returns immediately. Call :cpp:func:`wait` to wait for the completion.
+        The film contains partial result after the completion.
+        \endrst
+    */
+    virtual void cancel() = 0;
+
+    /*!
+        \brief Get progress of the rendering.
+        \return Ratio in ``[0,1]``.
+    */
+    virtual double progress() const = 0;
+};
+
+/*!
+    \brief Start rendering asynchronously.
+    \param renderer Renderer.
+    \return Handle of the rendering.
+
+    \rst
+    The function dispatches :cpp:func:`Renderer::render` in a background thread
+    and returns immediately.
+    The global cancellation token is reset when the rendering starts.
+    Only one rendering can be processed asynchronously at a time,
+    because the rendering uses global subsystems.
+    The renderer and the assets referenced by the renderer must not be modified
+    until the completion of the rendering.
+    \endrst
+*/
+LM_PUBLIC_API std::unique_ptr<RenderJob> render_async(const Renderer* renderer);
+
 /*!
     @}
 */
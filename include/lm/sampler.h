@@ -0,0 +1,51 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "component.h"
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \addtogroup sampler
+    @{
+*/
+
+/*!
+    \brief Sampler component interface.
+
+    \rst
+    This interface provides the values of the sample points used in the renderers.
+    A sample point is identified by the pixel index and the pixel sample index,
+    and each dimension of the sample point is accessed independently.
+    Unlike random number generators, the implementation can distribute the sample points
+    across the samples or across the pixels, e.g., with low-discrepancy sequences.
+    The sampler is used through :cpp:class:`lm::Rng` constructed with the sampler,
+    where the i-th call of ``u()`` returns the value of the i-th dimension.
+    \endrst
+*/
+class Sampler : public Component {
+public:
+    /*!
+        \brief Get a value of the sample point.
+        \param pixel_index Pixel index.
+        \param sample_index Pixel sample index.
+        \param dim Dimension index.
+        \return Value in [0,1).
+
+        \rst
+        The function must be thread-safe and deterministic,
+        that is, it returns the same value for the same arguments.
+        \endrst
+    */
+    virtual Float u(long long pixel_index, long long sample_index, int dim) const = 0;
+};
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(LM_NAMESPACE)
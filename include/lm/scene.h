@@ -403,6 +403,23 @@ public:
         }
     }
 
+    /*!
+        \brief Compute texture density at the surface point.
+        \param sp Scene interaction.
+        \return Length in texture coordinates per unit length on the surface.
+
+        \rst
+        The density converts the footprint of a ray on the surface into texture coordinates
+        for texture filtering. The density is computed on request rather than in :cpp:func:`intersect`
+        so that the renderers without texture filtering do not pay for it.
+        This function returns zero if the material does not use textures or the density is unavailable.
+        \endrst
+    */
+    virtual Float texture_density(const SceneInteraction& sp) const {
+        LM_UNUSED(sp);
+        return 0_f;
+    }
+
     // --------------------------------------------------------------------------------------------
 
     /*!
@@ -431,22 +448,26 @@ public:
         \brief Generate a primary ray.
         \param rp Raster position in [0,1]^2.
         \param aspect_ratio Aspect ratio of the film.
+        \param camera Camera node index. -1 to use the camera of the scene.
         \return Generated primary ray.
 
         \rst
         This function deterministically generates a primary ray
         corresponding to the given raster position.
+        The scene can contain multiple camera primitives,
+        where the last added one is used by default.
         \endrst
     */
-    virtual Ray primary_ray(Vec2 rp, Float aspect_ratio) const = 0;
+    virtual Ray primary_ray(Vec2 rp, Float aspect_ratio, int camera = -1) const = 0;
 
     /*!
         \brief Compute a raster position.
         \param wo Primary ray direction.
         \param aspect_ratio Aspect ratio of the film.
+        \param camera Camera node index. -1 to use the camera of the scene.
         \return Raster position.
     */
-    virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio) const = 0;
+    virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio, int camera = -1) const = 0;
 
     /*!
         \brief Sample a ray given surface point and incident direction.
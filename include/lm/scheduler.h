@@ -37,10 +37,110 @@ public:
         \brief Dispatch scheduler.
         \param process Callback function for parallel loop.
         \return Processed samples per pixel.
+
+        \rst
+        The scheduler checks the global cancellation token :cpp:func:`lm::parallel::cancel_token`
+        and returns early if the token is cancelled.
+        In this case, the returned value is the number of samples
+        to be used for the normalization of the partial result, which can be zero.
+        \endrst
     */
     virtual long long run(const ProcessFunc& process) const = 0;
+
+    /*!
+        \brief Callback function for range-based parallel loop.
+        \param pixel_begin First pixel index of the block.
+        \param pixel_end Pixel index next to the last one in the block.
+        \param sample_begin First pixel sample index of the block.
+        \param sample_end Pixel sample index next to the last one in the block.
+        \param threadid Thread index.
+
+        \rst
+        The callback processes all combinations of pixel indices in ``[pixel_begin,pixel_end)``
+        and sample indices in ``[sample_begin,sample_end)``.
+        \endrst
+    */
+    using ProcessRangeFunc = std::function<void(
+        long long pixel_begin, long long pixel_end,
+        long long sample_begin, long long sample_end, int threadid)>;
+
+    /*!
+        \brief Dispatch scheduler with range-based callback.
+        \param process Callback function for parallel loop.
+        \return Processed samples per pixel.
+
+        \rst
+        Renderers can opt in this function instead of :cpp:func:`run`
+        to hoist per-block setup out of the per-sample loop.
+        The default implementation calls ``process`` with a block containing a single sample.
+        \endrst
+    */
+    virtual long long run_range(const ProcessRangeFunc& process) const {
+        return run([&](long long pixel_index, long long sample_index, int threadid) {
+            process(pixel_index, pixel_index + 1, sample_index, sample_index + 1, threadid);
+        });
+    }
+
+    /*!
+        \brief Callback function called after a pass.
+        \param processed Processed samples per pixel including the passes of the previous runs.
+    */
+    using PassFunc = std::function<void(long long processed)>;
+
+    /*!
+        \brief Dispatch scheduler in passes over all pixels.
+        \param process Callback function for parallel loop.
+        \param on_pass Callback function called after each pass.
+        \param processed Processed samples per pixel in the previous runs.
+        \return Processed samples per pixel including the previous runs.
+
+        \rst
+        The scheduler processes the samples in passes, where every pass processes
+        the same number of samples for all pixels, and calls ``on_pass`` between the passes.
+        When ``on_pass`` is called, all pixels contain the same number of samples
+        and no worker is running, so that renderers can save the intermediate state,
+        e.g., for checkpointing.
+        Cancellation is checked between the passes so that a pass is either completed or not started.
+        The scheduler starts from the sample index ``processed``,
+        which makes it possible to resume the rendering from the saved state.
+        The default implementation throws an exception.
+        \endrst
+    */
+    virtual long long run_passes(const ProcessRangeFunc& process, const PassFunc& on_pass, long long processed) const {
+        LM_UNUSED(process, on_pass, processed);
+        LM_THROW_EXCEPTION(Error::Unsupported, "The scheduler does not support passes");
+    }
 };
 
+/*!
+    \brief Restrict the schedulers in the process to a partition of the work.
+    \param index Index of the partition.
+    \param count Number of partitions.
+
+    \rst
+    The schedulers divide the pixels (or the samples in the image space sample mode)
+    into the ranges of the grain size, and process only the ranges assigned to the partition,
+    where the ranges are assigned to the partitions in round-robin order.
+    The number of processed samples returned from the schedulers is not affected,
+    so that the images rendered with all partitions can be combined by summing them up.
+    This function is used to distribute a rendering to multiple processes.
+    Call with ``(0,1)`` to process all ranges (default).
+    \endrst
+*/
+LM_PUBLIC_API void set_partition(int index, int count);
+
+/*!
+    \brief Get index of the partition processed in the process.
+    \return Index of the partition.
+*/
+LM_PUBLIC_API int partition_index();
+
+/*!
+    \brief Get number of partitions.
+    \return Number of partitions. 1 if the work is not distributed.
+*/
+LM_PUBLIC_API int partition_count();
+
 /*!
     @}
 */
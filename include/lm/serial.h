@@ -245,11 +245,12 @@ serialize(lm::OutputArchive& ar, T*& p) {
             LM_ERROR("Serializing weak reference requires locator [key='{}']", Access::key(p));
         }
 
-        // Serializing locator
+        // Serializing locator.
+        // If the root locator is specified, serialize the locator relative to the root.
+        // Otherwise serialize absolute locator.
         const auto root_loc = ar.root_loc();
+        auto relative_loc = loc;
         if (!root_loc.empty()) {
-            // If the root locator is specified, serialize the locator relative to the root.
-
             // Consistency testing
             // Current locator must start with root_loc
             if (loc.rfind(root_loc, 0) != 0) {
@@ -257,14 +258,15 @@ serialize(lm::OutputArchive& ar, T*& p) {
                     "Unserializable asset. Subtree contains a reference to the outer asset. [loc='{}']", loc);
             }
 
-            // Obtain the relative locator to the root and serialize it
-            auto relative_loc = loc;
+            // Obtain the relative locator to the root
             relative_loc.erase(0, root_loc.size());
-            ar(CEREAL_NVP_("loc", relative_loc));
+        }
+        if (ar.weakref_table()) {
+            // Serialize the index to the table of locators
+            ar(CEREAL_NVP_("index", ar.weakref_index(relative_loc)));
         }
         else {
-            // Otherwise serialize absolute locator.
-            ar(CEREAL_NVP_("loc", loc));
+            ar(CEREAL_NVP_("loc", relative_loc));
         }
     }
 }
@@ -282,6 +284,14 @@ serialize(lm::InputArchive& ar, T*& p) {
     if (!valid) {
         p = nullptr;
     }
+    else if (ar.weakref_table()) {
+        // Load index to the table of locators.
+        // The locators are loaded with InputArchive::load_weakref_table()
+        // after all the instances are loaded.
+        uint32_t index;
+        ar(CEREAL_NVP_("index", index));
+        ar.add_weakptr_index((std::uintptr_t) & p, index);
+    }
     else {
         // Load locator
         const auto loc = [&]() {
@@ -324,6 +334,32 @@ LM_NAMESPACE_BEGIN(serial)
     @{
 */
 
+/*!
+    \brief Recover weak references recorded in the input archive.
+    \param ar Input archive.
+
+    \rst
+    Call this function after all the instances referred by the weak references are loaded.
+    If the archive uses the table of locators, each locator is resolved once
+    for all the weak references referring to it.
+    \endrst
+*/
+inline void resolve_weakptrs(InputArchive& ar) {
+    if (ar.weakref_table()) {
+        ar.foreach_weakref_table([](const std::string& loc, const std::vector<std::uintptr_t>& addresses) {
+            auto* p = lm::comp::get<Component>(loc);
+            for (auto address : addresses) {
+                *(Component**)address = p;
+            }
+        });
+        return;
+    }
+    ar.foreach_weakptr([](std::uintptr_t address, const std::string& loc) {
+        Component** weakptr = (Component**)address;
+        *weakptr = lm::comp::get<Component>(loc);
+    });
+}
+
 /*!
     \brief Load a coponent from a file.
     \tparam T Component type.
@@ -337,15 +373,13 @@ std::enable_if_t<
     void
 >
 load_comp(std::istream& stream, Component::Ptr<T>& comp, const std::string& root_loc) {
-    // Deserialize the asset
+    // Deserialize the asset.
+    // Weak references are saved as locators, the format of the files saved by save_comp().
     InputArchive ar(stream, root_loc);
     ar(comp);
 
     // Recover all weak references (if any)
-    ar.foreach_weakptr([](std::uintptr_t address, const std::string& loc) {
-        Component** weakptr = (Component**)address;
-        *weakptr = lm::comp::get<Component>(loc);
-    });
+    resolve_weakptrs(ar);
 }
 
 /*!
@@ -381,7 +415,9 @@ save_comp_owned(std::ostream& stream, T* comp, const std::string& root_loc) {
     };
     comp->foreach_underlying(visitor);
 
-    // Serialize the asset
+    // Serialize the asset.
+    // Weak references are saved as locators to keep compatibility with the saved assets.
+    // The table of locators is used only in the state files of AssetGroup::save_sections().
     OutputArchive ar(stream, comp->loc());
     cereal::save_owned(ar, comp);
 }
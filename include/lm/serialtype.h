@@ -7,6 +7,9 @@
 
 #include "common.h"
 #include <cereal/archives/portable_binary.hpp>
+#include <vector>
+#include <unordered_map>
+#include <memory>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -21,6 +24,16 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE)
     \rst
     We use cereal's portal binary archive as a default output archive type.
     This type is used as an argument type of :cpp:func:`lm::Component::save` function.
+
+    By default, a weak reference to a component is serialized as a locator.
+    If ``weakref_table`` is enabled, the locators are stored once in a table
+    and the weak references are serialized as indices to the table.
+    The table must be written with :cpp:func:`lm::OutputArchive::save_weakref_table`
+    after all components are serialized.
+
+    If blobs are enabled, large arrays (:cpp:class:`lm::Blob`) are not written to the stream.
+    The archive records the arrays and their offsets in the blob region,
+    and the caller is responsible for writing the region after serialization.
     \endrst
 */
 class OutputArchive final : public cereal::OutputArchive<OutputArchive, cereal::AllowEmptyClassElision> {
@@ -29,15 +42,31 @@ private:
     std::string root_loc_;
     cereal::PortableBinaryOutputArchive archive_; 
 
+    // Table of locators referred by weak references
+    bool weakref_table_;
+    std::vector<std::string> weakref_locs_;
+    std::unordered_map<std::string, uint32_t> weakref_index_;
+
+    // Arrays written to the blob region
+    struct BlobEntry {
+        uint64_t offset;    // Offset from the beginning of the blob region
+        const void* data;   // Pointer to the array
+        size_t size;        // Size of the array in bytes
+    };
+    bool blobs_enabled_ = false;
+    std::vector<BlobEntry> blobs_;
+    uint64_t blobs_size_ = 0;
+
 public:
     OutputArchive(std::ostream& stream)
         : OutputArchive(stream, "")
     {}
 
-    OutputArchive(std::ostream& stream, const std::string& root_loc)
+    OutputArchive(std::ostream& stream, const std::string& root_loc, bool weakref_table = false)
         : cereal::OutputArchive<OutputArchive, cereal::AllowEmptyClassElision>(this)
         , archive_(stream)
         , root_loc_(root_loc)
+        , weakref_table_(weakref_table)
     {}
 
     template <std::size_t DataSize> inline
@@ -48,6 +77,68 @@ public:
     std::string root_loc() const {
         return root_loc_;
     }
+
+public:
+    // True if weak references are serialized as indices to the table
+    bool weakref_table() const {
+        return weakref_table_;
+    }
+
+    // Get index of the locator in the table. The locator is added if not found.
+    uint32_t weakref_index(const std::string& loc) {
+        const auto [it, inserted] = weakref_index_.emplace(loc, uint32_t(weakref_locs_.size()));
+        if (inserted) {
+            weakref_locs_.push_back(loc);
+        }
+        return it->second;
+    }
+
+    // Write the table of locators
+    void save_weakref_table() {
+        const auto n = uint64_t(weakref_locs_.size());
+        archive_.saveBinary<sizeof(n)>(&n, sizeof(n));
+        for (const auto& loc : weakref_locs_) {
+            const auto size = uint64_t(loc.size());
+            archive_.saveBinary<sizeof(size)>(&size, sizeof(size));
+            archive_.saveBinary<1>(loc.data(), loc.size());
+        }
+    }
+
+public:
+    // Alignment of the arrays in the blob region
+    static constexpr uint64_t BlobAlignment = 64;
+
+    // Write large arrays to the blob region
+    void enable_blobs() {
+        blobs_enabled_ = true;
+    }
+
+    // True if large arrays are written to the blob region
+    bool blobs_enabled() const {
+        return blobs_enabled_;
+    }
+
+    // Add an array to the blob region and get the offset.
+    // The array must be valid until the region is written.
+    uint64_t add_blob(const void* data, size_t size) {
+        const auto offset = (blobs_size_ + BlobAlignment - 1) / BlobAlignment * BlobAlignment;
+        blobs_.push_back({ offset, data, size });
+        blobs_size_ = offset + size;
+        return offset;
+    }
+
+    // Size of the blob region in bytes
+    uint64_t blobs_size() const {
+        return blobs_size_;
+    }
+
+    // Iterate over the arrays in the blob region
+    using ForeachBlobFunc = std::function<void(uint64_t offset, const void* data, size_t size)>;
+    void foreach_blob(const ForeachBlobFunc& func) const {
+        for (const auto& blob : blobs_) {
+            func(blob.offset, blob.data, blob.size);
+        }
+    }
 };
 
 /*!
@@ -56,6 +147,9 @@ public:
     \rst
     We use cereal's portal binary archive as a default input archive type.
     This type is used as an argument type of :cpp:func:`lm::Component::load` function.
+    ``weakref_table`` must be the same as the one used for the output archive.
+    If the output archive enables blobs, the blob region must be specified
+    with :cpp:func:`lm::InputArchive::set_blobs` before deserialization.
     \endrst
 */
 class InputArchive final : public cereal::InputArchive<InputArchive, cereal::AllowEmptyClassElision> {
@@ -71,15 +165,26 @@ private:
     };
     std::vector<WeakptrAddressLocPair> weakptr_loc_pairs_;
 
+    // Weak pointers grouped by the indices to the table of locators
+    bool weakref_table_;
+    std::vector<std::vector<std::uintptr_t>> weakptr_addresses_;
+    std::vector<std::string> weakref_locs_;
+
+    // Blob region
+    const char* blobs_ = nullptr;
+    uint64_t blobs_size_ = 0;
+    std::shared_ptr<const void> blobs_owner_;
+
 public:
     InputArchive(std::istream& stream)
         : InputArchive(stream, "")
     {}
 
-    InputArchive(std::istream& stream, const std::string& root_loc)
+    InputArchive(std::istream& stream, const std::string& root_loc, bool weakref_table = false)
         : cereal::InputArchive<InputArchive, cereal::AllowEmptyClassElision>(this)
         , archive_(stream)
         , root_loc_(root_loc)
+        , weakref_table_(weakref_table)
     {}
 
     template <std::size_t DataSize> inline
@@ -104,6 +209,80 @@ public:
         for (auto p : weakptr_loc_pairs_) {
             func(p.address, p.loc);
         }
+        foreach_weakref_table([&](const std::string& loc, const std::vector<std::uintptr_t>& addresses) {
+            for (auto address : addresses) {
+                func(address, loc);
+            }
+        });
+    }
+
+public:
+    // True if weak references are serialized as indices to the table
+    bool weakref_table() const {
+        return weakref_table_;
+    }
+
+    // Add a weak pointer entry referring to the locator in the table
+    void add_weakptr_index(std::uintptr_t address, uint32_t index) {
+        if (index >= weakptr_addresses_.size()) {
+            weakptr_addresses_.resize(index + 1);
+        }
+        weakptr_addresses_[index].push_back(address);
+    }
+
+    // Read the table of locators
+    void load_weakref_table() {
+        uint64_t n;
+        archive_.loadBinary<sizeof(n)>(&n, sizeof(n));
+        weakref_locs_.resize(n);
+        for (auto& loc : weakref_locs_) {
+            uint64_t size;
+            archive_.loadBinary<sizeof(size)>(&size, sizeof(size));
+            loc.resize(size);
+            archive_.loadBinary<1>(loc.data(), size);
+            loc = root_loc_ + loc;
+        }
+        if (weakptr_addresses_.size() > weakref_locs_.size()) {
+            throw cereal::Exception("Invalid index of weak reference");
+        }
+    }
+
+    // Iterate over the locators in the table with the weak pointers referring to them.
+    // Each locator appears once, so that it can be resolved once for all the weak pointers.
+    using ForeachWeakrefTableFunc = std::function<void(const std::string& loc, const std::vector<std::uintptr_t>& addresses)>;
+    void foreach_weakref_table(const ForeachWeakrefTableFunc& func) {
+        for (size_t i = 0; i < weakptr_addresses_.size(); i++) {
+            if (!weakptr_addresses_[i].empty()) {
+                func(weakref_locs_[i], weakptr_addresses_[i]);
+            }
+        }
+    }
+
+public:
+    // Set the blob region.
+    // owner keeps the region alive while the loaded arrays refer to it.
+    void set_blobs(const char* data, uint64_t size, std::shared_ptr<const void> owner) {
+        blobs_ = data;
+        blobs_size_ = size;
+        blobs_owner_ = std::move(owner);
+    }
+
+    // True if large arrays are read from the blob region
+    bool blobs_enabled() const {
+        return blobs_owner_ != nullptr;
+    }
+
+    // Get pointer to the array in the blob region
+    const char* blob(uint64_t offset, uint64_t size) const {
+        if (offset > blobs_size_ || size > blobs_size_ - offset) {
+            throw cereal::Exception("Invalid blob");
+        }
+        return blobs_ + offset;
+    }
+
+    // Get the owner of the blob region
+    std::shared_ptr<const void> blobs_owner() const {
+        return blobs_owner_;
     }
 };
 
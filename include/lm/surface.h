@@ -32,6 +32,7 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE)
         - Shading normal ``n``
         - Texture coordinates ``t``
         - Tangent vectors ``u`` and ``v``
+        - Texture footprint ``t_footprint`` used for texture filtering
 
     (2) *A point in a media*.
         The structure describes a point in a media if ``degenerated=true``,
@@ -56,6 +57,7 @@ struct PointGeometry {
     };
     Vec2 t;                 //!< Texture coordinates.
     Vec3 u, v;              //!< Orthogonal tangent vectors.
+    Float t_footprint = 0_f;    //!< Width of the texture lookup in texture coordinates. Zero for point lookup.
 
     /*!
         \brief Make degenerated point.
@@ -208,6 +210,8 @@ enum class TerminatorType {
 struct SceneInteraction {
     int primitive;          //!< Primitive node index.
     PointGeometry geom;     //!< Surface point geometry information.
+    int face = -1;          //!< Face index of the mesh for surface interactions. -1 if unavailable.
+    Mat3 face_M;            //!< Linear component of the global transform of the face. Valid if face >= 0.
     bool endpoint;          //!< True if endpoint of light path.
     bool medium;            //!< True if it is medium interaction.
     std::optional<TerminatorType> terminator;   //!< Terminator type.
@@ -289,9 +293,11 @@ struct SceneInteraction {
         \brief Make camera terminator.
         \param window Window in raster coordinates.
         \param aspect_ratio Aspect ratio.
+        \param camera Camera node index. -1 to use the camera of the scene.
     */
-    static SceneInteraction make_camera_terminator(Vec4 window, Float aspect_ratio) {
+    static SceneInteraction make_camera_terminator(Vec4 window, Float aspect_ratio, int camera = -1) {
         SceneInteraction si;
+        si.primitive = camera;
         si.endpoint = false;
         si.medium = false;
         si.terminator = TerminatorType::Camera;
@@ -7,6 +7,7 @@
 
 #include "component.h"
 #include "math.h"
+#include "exception.h"
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -74,6 +75,26 @@ public:
     */
     virtual Vec3 eval(Vec2 t) const = 0;
 
+    /*!
+        \brief Evaluate color component of the texture with filtering.
+        \param t Texture coordinates.
+        \param footprint Width of the lookup in texture coordinates.
+
+        \rst
+        This function evaluates color of the texture
+        averaged over the region of the width ``footprint`` around ``t``.
+        The implementation can use the footprint to select the resolution of the texture,
+        e.g., mip level.
+        The footprint is usually given by :cpp:member:`lm::PointGeometry::t_footprint`.
+        The default implementation ignores the footprint
+        and is equivalent to :cpp:func:`lm::Texture::eval`.
+        \endrst
+    */
+    virtual Vec3 eval_filtered(Vec2 t, Float footprint) const {
+        LM_UNUSED(footprint);
+        return eval(t);
+    }
+
     /*!
         \brief Evaluate color component of the texture by pixel coordinates.
         \param x x coordinate of the texture.
@@ -115,6 +136,169 @@ public:
     virtual TextureBuffer buffer() { return {}; }
 };
 
+LM_NAMESPACE_BEGIN(texture)
+
+/*!
+    \brief Texture filtering.
+*/
+enum class Filter {
+    Nearest,    //!< Nearest-neighbor lookup of the full-resolution level.
+    Bilinear,   //!< Bilinear interpolation of the full-resolution level.
+    Trilinear,  //!< Bilinear interpolation of the mip levels selected from the footprint.
+};
+
+/*!
+    \brief Get texture filtering from its name.
+    \param name Name of the filtering (``nearest``, ``bilinear``, or ``trilinear``).
+
+    \rst
+    Throws an exception if the name is invalid.
+    \endrst
+*/
+LM_INLINE Filter filter_from_name(const std::string& name) {
+    if (name == "nearest") {
+        return Filter::Nearest;
+    }
+    if (name == "bilinear") {
+        return Filter::Bilinear;
+    }
+    if (name == "trilinear") {
+        return Filter::Trilinear;
+    }
+    LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid texture filter [filter='{}']", name);
+}
+
+/*!
+    \brief Generate a mip level from the finer level.
+    \param size Size of the finer level.
+    \param c Number of components.
+    \param src Texels of the finer level.
+    \param dst Texels of the generated level.
+    \return Size of the generated level.
+
+    \rst
+    The size of the generated level is the half of the finer level rounded down.
+    Each texel is the average of the texels of the finer level covered by the texel,
+    that is, 2x2 texels, or 3 texels in a row or column on the boundary if the size is odd.
+    \endrst
+*/
+LM_INLINE TextureSize downsample(TextureSize size, int c, const float* src, std::vector<float>& dst) {
+    const auto [w, h] = size;
+    const TextureSize level{ std::max(1, w / 2), std::max(1, h / 2) };
+    dst.assign(size_t(level.w) * level.h * c, 0.f);
+    for (int y = 0; y < level.h; y++) {
+        const int y0 = int(int64_t(y) * h / level.h);
+        const int y1 = int(int64_t(y+1) * h / level.h);
+        for (int x = 0; x < level.w; x++) {
+            const int x0 = int(int64_t(x) * w / level.w);
+            const int x1 = int(int64_t(x+1) * w / level.w);
+            float* p = &dst[c*(size_t(level.w)*y+x)];
+            for (int sy = y0; sy < y1; sy++) {
+                for (int sx = x0; sx < x1; sx++) {
+                    for (int k = 0; k < c; k++) {
+                        p[k] += src[c*(size_t(w)*sy+sx)+k];
+                    }
+                }
+            }
+            const float inv = 1.f / float((y1-y0) * (x1-x0));
+            for (int k = 0; k < c; k++) {
+                p[k] *= inv;
+            }
+        }
+    }
+    return level;
+}
+
+/*!
+    \brief Filtered lookup of a mipmapped texture.
+    \param filter Texture filtering.
+    \param num_levels Number of mip levels including the full-resolution level.
+    \param level_size Function ``TextureSize(int level)`` returning the size of the mip level.
+    \param texel Function ``Vec4(int level, int x, int y)`` returning the RGBA texel of the mip level.
+    \param t Texture coordinates.
+    \param footprint Width of the lookup in texture coordinates.
+
+    \rst
+    This function implements the filtering shared by the textures
+    storing the texels in different ways.
+    The texture coordinates are wrapped around,
+    and ``texel`` is called only with the coordinates inside the mip level.
+    The mip level for trilinear filtering is selected where the footprint covers about one texel.
+    The lookup with zero footprint uses the full-resolution level.
+    \endrst
+*/
+template <typename LevelSizeFunc, typename TexelFunc>
+Vec4 filtered_lookup(Filter filter, int num_levels, const LevelSizeFunc& level_size, const TexelFunc& texel, Vec2 t, Float footprint) {
+    const auto u = t.x - std::floor(t.x);
+    const auto v = t.y - std::floor(t.y);
+    const auto nearest = [&](int level) -> Vec4 {
+        const auto [w, h] = level_size(level);
+        return texel(level, std::clamp(int(u * w), 0, w - 1), std::clamp(int(v * h), 0, h - 1));
+    };
+    const auto bilinear = [&](int level) -> Vec4 {
+        const auto [w, h] = level_size(level);
+        const auto x = u * w - .5_f;
+        const auto y = v * h - .5_f;
+        const auto x0 = std::floor(x);
+        const auto y0 = std::floor(y);
+        const auto fx = x - x0;
+        const auto fy = y - y0;
+        const int x1 = (int(x0) + 1 + w) % w;
+        const int y1 = (int(y0) + 1 + h) % h;
+        const int xi = (int(x0) + w) % w;
+        const int yi = (int(y0) + h) % h;
+        return glm::mix(
+            glm::mix(texel(level, xi, yi), texel(level, x1, yi), fx),
+            glm::mix(texel(level, xi, y1), texel(level, x1, y1), fx),
+            fy);
+    };
+    if (filter == Filter::Nearest) {
+        return nearest(0);
+    }
+    if (filter == Filter::Bilinear || footprint <= 0_f || num_levels <= 1) {
+        return bilinear(0);
+    }
+    const auto size = level_size(0);
+    const auto lod = glm::clamp(std::log2(footprint * std::max(size.w, size.h)), 0_f, Float(num_levels - 1));
+    const int l = std::min(int(lod), num_levels - 2);
+    return glm::mix(bilinear(l), bilinear(l+1), lod - l);
+}
+
+/*!
+    \brief Save a texture in the tiled texture format.
+    \param texture Texture to be saved.
+    \param path Output path.
+    \param tile_size Width and height of the tiles in texels.
+
+    \rst
+    This function converts a texture providing the buffer via :cpp:func:`lm::Texture::buffer`
+    into the tiled texture format loadable with ``texture::tiled`` component.
+    The mip levels are generated and stored in the file.
+    Throws an exception if the texture does not provide the buffer or failed to write the file.
+    \endrst
+*/
+LM_PUBLIC_API void save_tiled(Texture* texture, const std::string& path, int tile_size = 64);
+
+/*!
+    \brief Set memory budget of the tile cache.
+    \param bytes Budget in bytes.
+
+    \rst
+    The tiles of ``texture::tiled`` components are loaded on first access
+    into the cache shared among all textures.
+    The least recently used tiles are evicted when the total size of the cached tiles
+    exceeds the budget.
+    \endrst
+*/
+LM_PUBLIC_API void set_tile_cache_budget(size_t bytes);
+
+/*!
+    \brief Get total size of the tiles in the tile cache in bytes.
+*/
+LM_PUBLIC_API size_t tile_cache_size();
+
+LM_NAMESPACE_END(texture)
+
 /*!
     @}
 */
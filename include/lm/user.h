@@ -66,12 +66,20 @@ LM_PUBLIC_API AssetGroup* assets();
 /*!
     \brief Save internal state to a file.
     \param path Output path.
+
+    \rst
+    The root assets are saved with :cpp:func:`lm::AssetGroup::save_sections`.
+    \endrst
 */
 LM_PUBLIC_API void save_state_to_file(const std::string& path);
 
 /*!
     \brief Load internal state from a file.
     \param path Input path.
+
+    \rst
+    The current assets are released and replaced by the assets in the file.
+    \endrst
 */
 LM_PUBLIC_API void load_state_from_file(const std::string& path);
 
@@ -0,0 +1,98 @@
+"""Client of the render server (lm_server)"""
+
+import json
+import socket
+import numpy as np
+
+class ServerError(Exception):
+    """Error returned from the render server"""
+    pass
+
+class Client:
+    """Client of the render server communicating over a Unix domain socket.
+
+    Example::
+
+        with Client('/tmp/lm.sock') as c:
+            c.load('room', assets=[
+                asset('film', 'film::bitmap', {'w': 1920, 'h': 1080}),
+                ...
+            ], primitives=[...])
+            img = c.render('room', 'renderer::pt', {...}, output='film')
+    """
+
+    def __init__(self, path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        self.file = self.sock.makefile('rb')
+
+    def close(self):
+        self.file.close()
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def request(self, req):
+        """Send a request and return the response and the binary payload (or None)"""
+        self.sock.sendall((json.dumps(req) + '\n').encode('utf-8'))
+        line = self.file.readline()
+        if not line:
+            raise ServerError('Connection closed')
+        res = json.loads(line)
+        if res.get('status') != 'ok':
+            raise ServerError(res.get('message', 'Unknown error'))
+        payload = None
+        if 'size' in res:
+            payload = self.file.read(res['size'])
+        return res, payload
+
+    def load(self, slot, assets=[], scene='scene', primitives=[], build=False):
+        """Load assets to the slot and build the scene.
+        Returns the locator of the slot."""
+        res, _ = self.request({
+            'cmd': 'load',
+            'slot': slot,
+            'assets': assets,
+            'scene': scene,
+            'primitives': primitives,
+            'build': build
+        })
+        return res['loc']
+
+    def render(self, slot, renderer, prop, output, path=None):
+        """Render an image with the resident assets of the slot.
+        Returns the path if given, otherwise the image as numpy array of the shape (h,w,c)."""
+        req = {
+            'cmd': 'render',
+            'slot': slot,
+            'renderer': renderer,
+            'prop': prop,
+            'output': output
+        }
+        if path is not None:
+            req['path'] = path
+        res, payload = self.request(req)
+        if path is not None:
+            return res['path']
+        return np.frombuffer(payload, dtype=np.float32).reshape(res['h'], res['w'], res['c'])
+
+    def status(self):
+        """Get the loaded slots and the number of queued jobs"""
+        res, _ = self.request({'cmd': 'status'})
+        return res
+
+    def shutdown(self):
+        """Shutdown the server after the queued jobs"""
+        self.request({'cmd': 'shutdown'})
+
+def asset(name, type, prop={}):
+    """Definition of an asset for Client.load()"""
+    return {'name': name, 'type': type, 'prop': prop}
+
+def loc(slot, name):
+    """Locator of an asset in the slot"""
+    return '$.assets.{}.{}'.format(slot, name)
@@ -17,6 +17,14 @@ public:
         m.def("round_trip", [](lm::Json v) -> lm::Json {
             return v;
         });
+        m.def("is_buffer_view", [](lm::Json v) -> bool {
+            return lm::json::is_buffer_view(v);
+        });
+        m.def("copy_array", [](lm::Json v) -> std::vector<double> {
+            std::vector<double> out(lm::json::array_size(v));
+            lm::json::copy_array(v, out.data(), out.size());
+            return out;
+        });
     }
 };
 
@@ -1,5 +1,6 @@
 """JSON tests"""
 import pytest
+import numpy as np
 from numpy.testing import assert_allclose
 import lightmetrica as lm
 from pylm_test import json as m
@@ -60,4 +61,28 @@ def test_round_trip_dict():
         '3': {'3.1': {'3.2':{'3.3':{}}}}
     }
     assert m.round_trip(value) == value
-    
\ No newline at end of file
+    
+def test_buffer():
+    """Tests numpy arrays passed as buffers"""
+    # Arrays of supported types
+    for dtype in [np.float32, np.float64, np.int32, np.int64, np.uint32, np.uint64]:
+        a = np.array([[1,2,3],[4,5,6]], dtype=dtype)
+        assert m.is_buffer_view(lm.buffer(a))
+        assert m.copy_array(lm.buffer(a)) == pytest.approx([1,2,3,4,5,6])
+        assert_allclose(m.round_trip(lm.buffer(a)), [1,2,3,4,5,6])
+        # Nested buffers are valid during the call
+        assert_allclose(m.round_trip({'a': [lm.buffer(a)]})['a'][0], [1,2,3,4,5,6])
+    # Non-contiguous array is copied
+    a = np.arange(6, dtype=np.float64)[::2]
+    assert m.copy_array(lm.buffer(a)) == pytest.approx([0,2,4])
+    # Unsupported type
+    with pytest.raises(Exception):
+        lm.buffer(np.array([1,2,3], dtype=np.int16))
+    # Numpy arrays without lm.buffer() are converted to Json arrays
+    a = np.array([1.,2.,3.])
+    assert not m.is_buffer_view(a)
+    assert m.round_trip(a) == pytest.approx([1,2,3])
+    assert m.copy_array([1,2,3]) == pytest.approx([1,2,3])
+    # Dict of the same form as buffer references is rejected
+    with pytest.raises(Exception):
+        m.round_trip({'buffer_': 1})
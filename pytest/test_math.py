@@ -37,4 +37,22 @@ def test_to_python():
                     [1,1,1,0],
                     [0,1,1,1],
                     [1,1,0,1]])
-    assert_allclose(m.get_mat4(), mat)
\ No newline at end of file
+    assert_allclose(m.get_mat4(), mat)
+
+
+def test_rng():
+    """Tests random number generator"""
+    # Numbers are in [0,1)
+    rng = lm.Rng(42)
+    us = [rng.u() for _ in range(10000)]
+    assert all(0 <= u < 1 for u in us)
+    assert np.mean(us) == pytest.approx(.5, abs=.02)
+
+    # Generator for a sample is a function of the seed, pixel, and sample indices
+    def seq(seed, pixel, sample):
+        rng = lm.Rng(seed, pixel, sample)
+        return [rng.u() for _ in range(4)]
+    assert seq(1, 2, 3) == seq(1, 2, 3)
+    assert seq(1, 2, 3) != seq(1, 2, 4)
+    assert seq(1, 2, 3) != seq(1, 3, 3)
+    assert seq(1, 2, 3) != seq(2, 2, 3)
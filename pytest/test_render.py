@@ -0,0 +1,32 @@
+"""Asynchronous rendering tests"""
+import threading
+import pytest
+import lightmetrica as lm
+
+def test_render_async():
+    """Rendering in background thread"""
+    started = threading.Event()
+    finish = threading.Event()
+    class Renderer_Wait(lm.Renderer):
+        def render(self):
+            started.set()
+            finish.wait()
+
+    job = Renderer_Wait().render_async()
+    # The main thread can run Python code during the rendering
+    assert started.wait(10)
+    assert not job.poll()
+    finish.set()
+    job.wait()
+    assert job.poll()
+    assert job.progress() == 1
+
+def test_render_async_exception():
+    """Exception thrown in rendering is rethrown by wait()"""
+    class Renderer_Throw(lm.Renderer):
+        def render(self):
+            raise RuntimeError('error')
+
+    job = Renderer_Throw().render_async()
+    with pytest.raises(Exception):
+        job.wait()
@@ -0,0 +1,101 @@
+"""Render server tests"""
+import os
+import sys
+import time
+import subprocess
+import pytest
+from lightmetrica import server
+
+def start_server(sock_path):
+    """Start lm_server and wait until the socket is ready"""
+    exe = os.path.join(pytest.lmenv.bin_path, 'lm_server')
+    if sys.platform == 'win32' or not os.path.exists(exe):
+        pytest.skip('lm_server is not available')
+    proc = subprocess.Popen([exe, sock_path, '2'])
+    for _ in range(100):
+        if os.path.exists(sock_path):
+            return proc
+        if proc.poll() is not None:
+            break
+        time.sleep(.1)
+    proc.kill()
+    pytest.fail('Failed to start lm_server')
+
+
+def test_load_render_shutdown(tmp_path):
+    """Load a scene to a slot, render it, and shutdown the server"""
+    sock_path = str(tmp_path / 'lm.sock')
+    proc = start_server(sock_path)
+    try:
+        with server.Client(sock_path) as c:
+            loc = c.load('quad', assets=[
+                server.asset('film', 'film::bitmap', {'w': 8, 'h': 4}),
+                server.asset('camera', 'camera::pinhole', {
+                    'position': [0,0,5],
+                    'center': [0,0,0],
+                    'up': [0,1,0],
+                    'vfov': 30
+                }),
+                server.asset('mesh', 'mesh::raw', {
+                    'ps': [-1,-1,-1,1,-1,-1,1,1,-1,-1,1,-1],
+                    'ns': [0,0,1],
+                    'ts': [0,0,1,0,1,1,0,1],
+                    'fs': {
+                        'p': [0,1,2,0,2,3],
+                        'n': [0,0,0,0,0,0],
+                        't': [0,1,2,0,2,3]
+                    }
+                }),
+                server.asset('material', 'material::diffuse', {'Kd': [1,1,1]}),
+                server.asset('light', 'light::area', {
+                    'Ke': [1,1,1],
+                    'mesh': server.loc('quad', 'mesh')
+                }),
+                server.asset('accel', 'accel::sahbvh', {}),
+                server.asset('scene', 'scene::default', {
+                    'accel': server.loc('quad', 'accel')
+                })
+            ], primitives=[
+                {'camera': server.loc('quad', 'camera')},
+                {
+                    'mesh': server.loc('quad', 'mesh'),
+                    'material': server.loc('quad', 'material'),
+                    'light': server.loc('quad', 'light')
+                }
+            ])
+            assert loc == '$.assets.quad'
+            assert 'quad' in c.status()['slots']
+
+            # The quad covers the center of the image
+            img = c.render('quad', 'renderer::raycast', {
+                'scene': server.loc('quad', 'scene'),
+                'output': server.loc('quad', 'film'),
+                'bg_color': [0,0,0],
+                'use_constant_color': True
+            }, output='film')
+            assert img.shape == (4, 8, 3)
+            assert img[2,4] == pytest.approx([1,1,1])
+
+            # Path tracing uses the per-thread state of the parallel loops
+            # with fewer threads than the logical cores
+            img = c.render('quad', 'renderer::pt', {
+                'scene': server.loc('quad', 'scene'),
+                'output': server.loc('quad', 'film'),
+                'scheduler': 'sample',
+                'spp': 4,
+                'max_length': 2,
+                'seed': 42
+            }, output='film')
+            assert img.shape == (4, 8, 3)
+            assert img[2,4,0] > 0
+
+            # Errors are returned without stopping the server
+            with pytest.raises(server.ServerError):
+                c.render('missing', 'renderer::raycast', {}, output='film')
+
+            c.shutdown()
+        assert proc.wait(timeout=30) == 0
+        assert not os.path.exists(sock_path)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
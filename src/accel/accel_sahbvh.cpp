@@ -8,6 +8,8 @@
 #include <lm/accel.h>
 #include <lm/scene.h>
 #include <lm/mesh.h>
+#include <lm/parallel.h>
+#include <lm/blob.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -109,26 +111,51 @@ struct Node {
    .. [Möller1997] T. Möller & B. Trumbore.
                    Fast, Minimum Storage Ray-Triangle Intersection.
                    Journal of Graphics Tools. 2(1):21--28. 1997.
+
+   :param bool replicate_numa: If true, the nodes and triangles are replicated
+                               to each NUMA node after the build or the deserialization.
+                               Default is false.
 \endrst
 */
 class Accel_SAHBVH final : public Accel {
 private:
-    std::vector<Node> nodes_;                             // Nodes
-    std::vector<Tri> trs_;                                // Triangles
-    std::vector<int> indices_;                            // Triangle indices
+    // Copy of the structure used for traversal
+    struct Replica {
+        std::vector<Node> nodes;
+        std::vector<Tri> trs;
+        std::vector<int> indices;
+    };
+
+    Blob<Node> nodes_;                                    // Nodes
+    Blob<Tri> trs_;                                       // Triangles
+    Blob<int> indices_;                                   // Triangle indices
     std::vector<FlattenedPrimitiveNode> flattened_nodes_; // Flattened scene graph
+    bool replicate_numa_ = false;                         // Replicate the structure per NUMA node
+    std::vector<Replica> replicas_;                       // Replicas for each NUMA node
     
 public:
-    LM_SERIALIZE_IMPL(ar) {
-        ar(nodes_, trs_, indices_, flattened_nodes_);
+    virtual void save(OutputArchive& ar) override {
+        ar(nodes_, trs_, indices_, flattened_nodes_, replicate_numa_);
+    }
+
+    virtual void load(InputArchive& ar) override {
+        ar(nodes_, trs_, indices_, flattened_nodes_, replicate_numa_);
+        replicate();
     }
 
 public:
+    virtual void construct(const Json& prop) override {
+        replicate_numa_ = json::value(prop, "replicate_numa", false);
+    }
+
     virtual void build(const Scene& scene) override {
         // Flatten the scene graph and setup triangle list
         LM_INFO("Flattening scene");
         trs_.clear();
         flattened_nodes_.clear();
+        auto& trs = trs_.vec();
+        auto& nodes = nodes_.vec();
+        auto& indices = indices_.vec();
         scene.traverse_primitive_nodes([&](const SceneNode& node, Mat4 global_transform) {
             if (node.type != SceneNodeType::Primitive) {
                 return;
@@ -146,13 +173,13 @@ public:
                 const auto p1 = global_transform * Vec4(tri.p1.p, 1_f);
                 const auto p2 = global_transform * Vec4(tri.p2.p, 1_f);
                 const auto p3 = global_transform * Vec4(tri.p3.p, 1_f);
-                trs_.emplace_back(p1, p2, p3, flattened_node_index, face);
+                trs.emplace_back(p1, p2, p3, flattened_node_index, face);
             });
         });
 
         // --------------------------------------------------------------------
 
-        const int nt = int(trs_.size()); // Number of triangles
+        const int nt = int(trs.size());  // Number of triangles
         struct Entry {
             int index;
             int start;
@@ -160,9 +187,9 @@ public:
         };
         std::queue<Entry> q;            // Queue for traversal (node index, start, end)
         q.push({0, 0, nt});             // Initialize the queue with root node
-        nodes_.assign(2*nt-1, {});      // Maximum number of nodes: 2*nt-1
-        indices_.assign(nt, 0);
-        std::iota(indices_.begin(), indices_.end(), 0);
+        nodes.assign(2*nt-1, {});       // Maximum number of nodes: 2*nt-1
+        indices.assign(nt, 0);
+        std::iota(indices.begin(), indices.end(), 0);
         std::mutex mu;                  // For concurrent queue
         std::condition_variable cv;     // For concurrent queue
         std::atomic<int> pr = 0;        // Processed triangles
@@ -189,17 +216,17 @@ public:
                 }
 
                 // Calculate the bound for the node
-                Node& n = nodes_[ni];
+                Node& n = nodes[ni];
                 for (int i = s; i < e; i++) {
-                    n.b = merge(n.b, trs_[indices_[i]].b);
+                    n.b = merge(n.b, trs[indices[i]].b);
                 }
 
                 // Function to sort the triangles according to the given axis
                 auto st = [&, s = s, e = e](int ax) {
                     auto cmp = [&](int i1, int i2) {
-                        return trs_[i1].c[ax] < trs_[i2].c[ax];
+                        return trs[i1].c[ax] < trs[i2].c[ax];
                     };
-                    std::sort(&indices_[s], &indices_[e-1]+1, cmp);
+                    std::sort(&indices[s], &indices[e-1]+1, cmp);
                 };
 
                 // Function to create a leaf node
@@ -208,7 +235,7 @@ public:
                     n.s = s;
                     n.e = e;
                     pr += e - s;
-                    if (pr == int(trs_.size())) {
+                    if (pr == int(trs.size())) {
                         std::unique_lock<std::mutex> lk(mu);
                         done = 1;
                         cv.notify_all();
@@ -232,8 +259,8 @@ public:
                         int j = e - s - i;
                         l[i] = bl.surface_area() * i;
                         r[j] = br.surface_area() * i;
-                        bl = i < e - s ? merge(bl, trs_[indices_[s+i]].b) : bl;
-                        br = j > 0 ? merge(br, trs_[indices_[s+j-1]].b) : br;
+                        bl = i < e - s ? merge(bl, trs[indices[s+i]].b) : bl;
+                        br = j > 0 ? merge(br, trs[indices[s+j-1]].b) : br;
                     }
                     for (int i = 1; i < e - s; i++) {
                         const auto c = 1_f + (l[i]+r[i])/n.b.surface_area();
@@ -264,16 +291,49 @@ public:
         for (auto& th : ths) {
             th.join();
         }
+
+        replicate();
     };
 
+private:
+    // Replicate read-only structure to NUMA nodes
+    void replicate() {
+        replicas_.clear();
+        if (!replicate_numa_ || parallel::num_numa_nodes() <= 1) {
+            return;
+        }
+        LM_INFO("Replicating to NUMA nodes");
+        replicas_.resize(parallel::num_numa_nodes());
+        parallel::foreach_numa_node([&](int node) {
+            // Copy from a thread running on the node to allocate the memory locally
+            auto& r = replicas_[node];
+            r.nodes.assign(nodes_.begin(), nodes_.end());
+            r.trs.assign(trs_.begin(), trs_.end());
+            r.indices.assign(indices_.begin(), indices_.end());
+        });
+    }
+
+public:
     virtual std::optional<Hit> intersect(Ray ray, Float tmin, Float tmax) const override {
         exception::ScopedDisableFPEx guard_;  // Disable floating point exceptions
+
+        // Use the replica of the NUMA node of the current thread if available
+        const auto* nodes = nodes_.data();
+        const auto* trs = trs_.data();
+        const auto* indices = indices_.data();
+        if (!replicas_.empty()) {
+            const auto& r = replicas_[parallel::numa_node() % replicas_.size()];
+            nodes = r.nodes.data();
+            trs = r.trs.data();
+            indices = r.indices.data();
+        }
+
         std::optional<Tri::Hit> mh, h;
         int mi = -1;
         int s[99]{};
         int si = 0;
         while (si >= 0) {
-            auto& n = nodes_.at(s[si--]);
+            auto& n = nodes[s[si--]];
             if (!n.b.isect(ray, tmin, tmax)) {
                 continue;
             }
@@ -283,7 +343,7 @@ public:
                 continue;
             }
             for (int i = n.s; i < n.e; i++) {
-                if (h = trs_[indices_[i]].intersect(ray, tmin, tmax)) {
+                if (h = trs[indices[i]].intersect(ray, tmin, tmax)) {
                     mh = h;
                     tmax = h->t;
                     mi = i;
@@ -293,7 +353,7 @@ public:
         if (!mh) {
             return {};
         }
-        const auto& tr = trs_.at(indices_.at(mi));
+        const auto& tr = trs[indices[mi]];
         const auto& fn = flattened_nodes_.at(tr.flattened_node);
         return Hit{ tmax, Vec2(mh->u, mh->v), fn.global_transform, fn.primitive, tr.face };
     }
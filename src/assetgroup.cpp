@@ -6,9 +6,142 @@
 #include <pch.h>
 #include <lm/core.h>
 #include <lm/assetgroup.h>
+#include <lm/serial.h>
+#include <lm/parallel.h>
+#include <lm/mappedfile.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
+namespace {
+
+// Header of the state file written by AssetGroup::save_sections().
+// The header is followed by the table of contents with an entry per asset,
+// the sections containing the serialized assets, and the blob regions of the sections.
+// Each section ends with the table of locators referred by the weak references in the section.
+// The blob region of a section contains the large arrays in the section in the native layout.
+// The byte order and the size of floating point values of the layout are recorded in the header,
+// and the file is rejected on load by the build with a different layout.
+// Each region starts at an offset aligned to the page size.
+// The fields of the header and the entries are encoded in little endian
+// by write_header() and write_entry() irrespective of the platform.
+struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    uint32_t little_endian;     // 1 if the blobs are stored in little endian
+    uint32_t float_size;        // Size of floating point values in the blobs
+};
+
+// Entry of the table of contents.
+// The entry is followed by the name of the asset.
+struct StateSectionEntry {
+    uint64_t offset;        // Offset to the section from the beginning of the file
+    uint64_t size;          // Size of the section in bytes
+    uint32_t compression;   // Compression of the section
+    uint32_t name_size;     // Length of the asset name
+    uint64_t blob_offset;   // Offset to the blob region of the section
+    uint64_t blob_size;     // Size of the blob region in bytes
+};
+
+// Compression of a section
+enum class StateCompression : uint32_t {
+    None = 0,
+};
+
+constexpr char StateMagic[8] = { 'L', 'M', 'S', 'T', 'A', 'T', 'E', '\0' };
+constexpr uint32_t StateVersion = 4;
+constexpr uint64_t StateBlobAlignment = 4096;
+
+uint64_t align_blob_offset(uint64_t offset) {
+    return (offset + StateBlobAlignment - 1) / StateBlobAlignment * StateBlobAlignment;
+}
+
+// True if the platform is little endian
+bool native_little_endian() {
+    const uint16_t v = 1;
+    uint8_t b;
+    std::memcpy(&b, &v, 1);
+    return b == 1;
+}
+
+// Encode an unsigned integer in little endian
+template <typename T>
+void put_le(std::string& buf, T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf.push_back(char((uint64_t(v) >> (8*i)) & 0xff));
+    }
+}
+
+// Decode an unsigned integer in little endian
+template <typename T>
+T get_le(const char*& p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(uint8_t(p[i])) << (8*i);
+    }
+    p += sizeof(T);
+    return T(v);
+}
+
+// Encoded sizes of the header and an entry of the table of contents
+constexpr size_t StateHeaderSize = 8 + 4 + 4 + 4 + 4;
+constexpr size_t StateSectionEntrySize = 8 + 8 + 4 + 4 + 8 + 8;
+
+std::string write_header(const StateHeader& h) {
+    std::string buf(h.magic, sizeof(h.magic));
+    put_le(buf, h.version);
+    put_le(buf, h.num_sections);
+    put_le(buf, h.little_endian);
+    put_le(buf, h.float_size);
+    return buf;
+}
+
+StateHeader read_header(const char* p) {
+    StateHeader h;
+    std::memcpy(h.magic, p, sizeof(h.magic));
+    p += sizeof(h.magic);
+    h.version = get_le<uint32_t>(p);
+    h.num_sections = get_le<uint32_t>(p);
+    h.little_endian = get_le<uint32_t>(p);
+    h.float_size = get_le<uint32_t>(p);
+    return h;
+}
+
+std::string write_entry(const StateSectionEntry& e) {
+    std::string buf;
+    put_le(buf, e.offset);
+    put_le(buf, e.size);
+    put_le(buf, e.compression);
+    put_le(buf, e.name_size);
+    put_le(buf, e.blob_offset);
+    put_le(buf, e.blob_size);
+    return buf;
+}
+
+StateSectionEntry read_entry(const char* p) {
+    StateSectionEntry e;
+    e.offset = get_le<uint64_t>(p);
+    e.size = get_le<uint64_t>(p);
+    e.compression = get_le<uint32_t>(p);
+    e.name_size = get_le<uint32_t>(p);
+    e.blob_offset = get_le<uint64_t>(p);
+    e.blob_size = get_le<uint64_t>(p);
+    return e;
+}
+
+// Read-only stream buffer referring to a memory region without copying
+class MemoryStreamBuf final : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, size_t size) {
+        auto* p = const_cast<char*>(data);
+        setg(p, p, p + size);
+    }
+};
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
 class AssetGroup_ final : public AssetGroup {
 private:
     std::vector<Ptr<Component>> assets_;
@@ -136,6 +269,211 @@ public:
 
         return assets_.back().get();
     }
+
+    virtual void save_sections(const std::string& path) override {
+        LM_INFO("Saving assets [path='{}']", path);
+        LM_INDENT();
+
+        // Serialize the assets into separate sections.
+        // The locators are serialized relative to this group
+        // so that the sections can refer to each other.
+        // Large arrays are recorded to be written in the blob region of the section.
+        struct SectionBlob {
+            uint64_t offset;
+            const void* data;
+            size_t size;
+        };
+        struct Section {
+            std::string data;
+            std::vector<SectionBlob> blobs;
+            uint64_t blobs_size;
+        };
+        const auto n = assets_.size();
+        std::vector<Section> sections(n);
+        parallel::foreach(n, [&](long long i, int) {
+            auto& section = sections[i];
+            std::ostringstream os(std::ios::out | std::ios::binary);
+            {
+                OutputArchive ar(os, loc(), true);
+                ar.enable_blobs();
+                cereal::save_owned(ar, assets_[i].get());
+                ar.save_weakref_table();
+                ar.foreach_blob([&](uint64_t offset, const void* data, size_t size) {
+                    section.blobs.push_back({ offset, data, size });
+                });
+                section.blobs_size = ar.blobs_size();
+            }
+            section.data = os.str();
+        });
+
+        // Names of the assets in the order of the sections
+        std::vector<std::string> names(n);
+        for (const auto& [name, index] : asset_index_map_) {
+            names[index] = name;
+        }
+
+        // Table of contents
+        StateHeader header{};
+        std::memcpy(header.magic, StateMagic, sizeof(StateMagic));
+        header.version = StateVersion;
+        header.num_sections = uint32_t(n);
+        header.little_endian = native_little_endian() ? 1 : 0;
+        header.float_size = uint32_t(sizeof(Float));
+        uint64_t offset = StateHeaderSize;
+        for (const auto& name : names) {
+            offset += StateSectionEntrySize + name.size();
+        }
+        std::vector<StateSectionEntry> entries(n);
+        for (size_t i = 0; i < n; i++) {
+            entries[i].offset = offset;
+            entries[i].size = sections[i].data.size();
+            entries[i].compression = uint32_t(StateCompression::None);
+            entries[i].name_size = uint32_t(names[i].size());
+            offset += sections[i].data.size();
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (sections[i].blobs_size > 0) {
+                offset = align_blob_offset(offset);
+            }
+            entries[i].blob_offset = offset;
+            entries[i].blob_size = sections[i].blobs_size;
+            offset += sections[i].blobs_size;
+        }
+
+        // Write the file.
+        // The file is written to a temporary file and replaced afterwards,
+        // since the blobs might refer to the mapped file in the same path.
+        const auto temp_path = path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::out | std::ios::binary);
+            if (!out) {
+                LM_THROW_EXCEPTION(Error::IOError, "Failed to open file [path='{}']", temp_path);
+            }
+            const auto write_at = [&](uint64_t at, const void* data, size_t size) {
+                const auto curr = uint64_t(out.tellp());
+                const std::vector<char> zeros(at - curr);
+                out.write(zeros.data(), std::streamsize(zeros.size()));
+                out.write((const char*)data, std::streamsize(size));
+            };
+            const auto header_data = write_header(header);
+            out.write(header_data.data(), header_data.size());
+            for (size_t i = 0; i < n; i++) {
+                const auto entry_data = write_entry(entries[i]);
+                out.write(entry_data.data(), entry_data.size());
+                out.write(names[i].data(), names[i].size());
+            }
+            for (const auto& section : sections) {
+                out.write(section.data.data(), section.data.size());
+            }
+            for (size_t i = 0; i < n; i++) {
+                for (const auto& blob : sections[i].blobs) {
+                    write_at(entries[i].blob_offset + blob.offset, blob.data, blob.size);
+                }
+            }
+            if (!out) {
+                LM_THROW_EXCEPTION(Error::IOError, "Failed to write assets [path='{}']", temp_path);
+            }
+        }
+        fs::rename(temp_path, path);
+    }
+
+    virtual void load_sections(const std::string& path) override {
+        LM_INFO("Loading assets [path='{}']", path);
+        LM_INDENT();
+
+        // Map the file.
+        // The mapping is kept alive while the loaded arrays refer to the blobs.
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(path)) {
+            LM_THROW_EXCEPTION(Error::IOError, "Failed to open file [path='{}']", path);
+        }
+        const auto at = [&](uint64_t offset, size_t size) -> const char* {
+            if (offset > file->size() || size > file->size() - offset) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid state file [path='{}']", path);
+            }
+            return file->data() + offset;
+        };
+
+        // Read the table of contents
+        const auto header = read_header(at(0, StateHeaderSize));
+        if (std::memcmp(header.magic, StateMagic, sizeof(StateMagic)) != 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid state file [path='{}']", path);
+        }
+        if (header.version != StateVersion) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Unsupported version of state file [path='{}', version={}]", path, header.version);
+        }
+        if (header.little_endian != (native_little_endian() ? 1u : 0u) || header.float_size != sizeof(Float)) {
+            LM_THROW_EXCEPTION(Error::Unsupported,
+                "State file is saved with an incompatible layout [path='{}', little_endian={}, float_size={}]",
+                path, header.little_endian, header.float_size);
+        }
+        const size_t n = header.num_sections;
+        std::vector<StateSectionEntry> entries(n);
+        std::vector<std::string> names(n);
+        uint64_t offset = StateHeaderSize;
+        for (size_t i = 0; i < n; i++) {
+            auto& entry = entries[i];
+            entry = read_entry(at(offset, StateSectionEntrySize));
+            offset += StateSectionEntrySize;
+            names[i].assign(at(offset, entry.name_size), entry.name_size);
+            offset += entry.name_size;
+            if (entry.compression != uint32_t(StateCompression::None)) {
+                LM_THROW_EXCEPTION(Error::Unsupported, "Unsupported compression of state file [path='{}', compression={}]",
+                    path, entry.compression);
+            }
+            if (entry.offset > file->size() || entry.size > file->size() - entry.offset ||
+                entry.blob_offset > file->size() || entry.blob_size > file->size() - entry.blob_offset) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid state file [path='{}']", path);
+            }
+        }
+
+        // Register the assets
+        // This must happen before deserialization because
+        // the loading process might refer to the underlying component via locator.
+        assets_.clear();
+        asset_index_map_.clear();
+        assets_.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            asset_index_map_[names[i]] = int(i);
+        }
+
+        // Deserialize the sections in parallel.
+        // The sections are read directly from the mapping without copying,
+        // and the large arrays refer to the blobs in the mapped file,
+        // so that the pages are read on demand and shared among the processes.
+        struct WeakRefs {
+            std::string loc;
+            std::vector<std::uintptr_t> addresses;
+        };
+        std::vector<std::vector<WeakRefs>> weakrefs(n);
+        parallel::foreach(n, [&](long long i, int) {
+            const auto& entry = entries[i];
+            MemoryStreamBuf buf(file->data() + entry.offset, entry.size);
+            std::istream is(&buf);
+            InputArchive ar(is, loc(), true);
+            ar.set_blobs(file->data() + entry.blob_offset, entry.blob_size, file);
+            ar(assets_[i]);
+            ar.load_weakref_table();
+            ar.foreach_weakref_table([&](const std::string& loc, const std::vector<std::uintptr_t>& addresses) {
+                weakrefs[i].push_back({ loc, addresses });
+            });
+        });
+
+        // Recover the weak references after all the assets are loaded.
+        // Each locator is resolved once.
+        std::unordered_map<std::string, Component*> resolved;
+        for (const auto& refs : weakrefs) {
+            for (const auto& ref : refs) {
+                auto it = resolved.find(ref.loc);
+                if (it == resolved.end()) {
+                    it = resolved.emplace(ref.loc, comp::get<Component>(ref.loc)).first;
+                }
+                for (auto address : ref.addresses) {
+                    *(Component**)address = it->second;
+                }
+            }
+        }
+    }
 };
 
 LM_COMP_REG_IMPL(AssetGroup_, "asset_group::default");
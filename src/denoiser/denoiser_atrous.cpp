@@ -0,0 +1,209 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/denoiser.h>
+#include <lm/film.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Squared distance between two vectors
+Float distance2(Vec3 a, Vec3 b) {
+    const auto d = a - b;
+    return glm::dot(d, d);
+}
+
+}
+
+/*
+\rst
+.. function:: denoiser::atrous
+
+   Edge-avoiding A-Trous wavelet denoiser.
+
+   :param str albedo: Locator of the film containing albedo. Optional.
+   :param str normal: Locator of the film containing shading normal. Optional.
+   :param str depth: Locator of the film containing depth. Optional.
+   :param int iterations: Number of filtering passes. Default is 5.
+   :param float sigma_color: Edge-stopping parameter for color. Default is 1.
+   :param float sigma_albedo: Edge-stopping parameter for albedo. Default is 0.1.
+   :param float sigma_normal: Edge-stopping parameter for normal. Default is 0.1.
+   :param float sigma_depth: Edge-stopping parameter for relative depth. Default is 0.1.
+
+   This component implements edge-avoiding A-Trous wavelet filter [Dammertz2010]_.
+   The filter applies 5x5 B3-spline kernel with the stride doubled in each pass,
+   where the weights of the kernel are multiplied by the edge-stopping functions
+   of the color and the auxiliary features.
+   The sigma for the color is halved in each pass.
+   The features are read from the AOV channels of the input film named
+   ``albedo``, ``normal``, and ``depth``, which can be rendered in the same pass as the image,
+   e.g., with ``aovs`` parameter of ``renderer::pt``.
+   The features can also be given as separate films with the same size as the input film,
+   which have priority over the AOV channels.
+   Missing features are not used for the edge-stopping functions.
+   The filter is executed in parallel with the parallel subsystem.
+
+   .. [Dammertz2010] H. Dammertz, D. Sewtz, J. Hanika, and H. P. A. Lensch.
+                     Edge-avoiding A-Trous wavelet transform for fast global illumination filtering.
+                     High Performance Graphics, 2010.
+\endrst
+*/
+class Denoiser_ATrous final : public Denoiser {
+private:
+    Film* albedo_;
+    Film* normal_;
+    Film* depth_;
+    int iterations_;
+    Float sigma_color_;
+    Float sigma_albedo_;
+    Float sigma_normal_;
+    Float sigma_depth_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(albedo_, normal_, depth_, iterations_, sigma_color_, sigma_albedo_, sigma_normal_, sigma_depth_);
+    }
+
+    virtual void foreach_underlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, albedo_);
+        comp::visit(visit, normal_);
+        comp::visit(visit, depth_);
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        albedo_ = json::comp_ref_or_nullptr<Film>(prop, "albedo");
+        normal_ = json::comp_ref_or_nullptr<Film>(prop, "normal");
+        depth_ = json::comp_ref_or_nullptr<Film>(prop, "depth");
+        iterations_ = json::value(prop, "iterations", 5);
+        sigma_color_ = json::value(prop, "sigma_color", 1_f);
+        sigma_albedo_ = json::value(prop, "sigma_albedo", .1_f);
+        sigma_normal_ = json::value(prop, "sigma_normal", .1_f);
+        sigma_depth_ = json::value(prop, "sigma_depth", .1_f);
+    }
+
+    virtual void denoise(Film* input, Film* output) const override {
+        const int w = input->size().w;
+        const int h = input->size().h;
+        if (output->size().w != w || output->size().h != h) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Film size is different [expected='({},{})', actual='({},{})']",
+                w, h, output->size().w, output->size().h);
+        }
+
+        LM_INFO("Denoising [w={}, h={}, iterations={}]", w, h, iterations_);
+        LM_INDENT();
+
+        // Copy the normalized values of the films
+        auto curr = to_vec3(input->buffer(), w, h);
+        const auto albedo = read_feature(albedo_, input, "albedo", w, h);
+        const auto normal = read_feature(normal_, input, "normal", w, h);
+        const auto depth = read_feature(depth_, input, "depth", w, h);
+
+        // Filter with ping-pong buffers
+        constexpr Float Kernel[] = { 1_f/16_f, 1_f/4_f, 3_f/8_f, 1_f/4_f, 1_f/16_f };
+        std::vector<Vec3> next(curr.size());
+        for (int iter = 0; iter < iterations_; iter++) {
+            const int step = 1 << iter;
+            const auto sigma_color = sigma_color_ / Float(1 << iter);
+            parallel::foreach_range(h, 1, [&](long long begin, long long end, int) {
+                for (int y = int(begin); y < int(end); y++) {
+                    for (int x = 0; x < w; x++) {
+                        const int p = y*w + x;
+                        Vec3 sum(0_f);
+                        Float weight_sum = 0_f;
+                        for (int j = -2; j <= 2; j++) {
+                            const int yq = y + j*step;
+                            if (yq < 0 || yq >= h) {
+                                continue;
+                            }
+                            for (int i = -2; i <= 2; i++) {
+                                const int xq = x + i*step;
+                                if (xq < 0 || xq >= w) {
+                                    continue;
+                                }
+                                const int q = yq*w + xq;
+                                Float e = distance2(curr[p], curr[q]) / (sigma_color*sigma_color);
+                                if (!albedo.empty()) {
+                                    e += distance2(albedo[p], albedo[q]) / (sigma_albedo_*sigma_albedo_);
+                                }
+                                if (!normal.empty()) {
+                                    e += distance2(normal[p], normal[q]) / (sigma_normal_*sigma_normal_);
+                                }
+                                if (!depth.empty()) {
+                                    const auto dz = (depth[p].x - depth[q].x) / std::max(depth[p].x, Eps);
+                                    e += dz*dz / (sigma_depth_*sigma_depth_);
+                                }
+                                const auto weight = Kernel[i+2] * Kernel[j+2] * std::exp(-e);
+                                sum += weight * curr[q];
+                                weight_sum += weight;
+                            }
+                        }
+                        next[p] = sum / weight_sum;
+                    }
+                }
+            });
+            std::swap(curr, next);
+        }
+
+        // Write the result.
+        // The values are scaled by the weight of the output film
+        // so that the normalized values match the result.
+        // AOVs of the film are kept if the output is the input film.
+        if (output != input) {
+            output->clear();
+        }
+        const auto scale = output->weight() > 0_f ? output->weight() : 1_f;
+        parallel::foreach_range(h, 1, [&](long long begin, long long end, int) {
+            for (int y = int(begin); y < int(end); y++) {
+                for (int x = 0; x < w; x++) {
+                    output->set_pixel(x, y, curr[y*w + x] * scale);
+                }
+            }
+        });
+    }
+
+private:
+    // Copy the normalized values of the film
+    std::vector<Vec3> read(Film* film, int w, int h) const {
+        if (film->size().w != w || film->size().h != h) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Feature film size is different [expected='({},{})', actual='({},{})']",
+                w, h, film->size().w, film->size().h);
+        }
+        return to_vec3(film->buffer(), w, h);
+    }
+
+    // Copy the feature from the feature film if specified, otherwise from the AOV of the input.
+    // Returns empty buffer if the feature is not available.
+    std::vector<Vec3> read_feature(Film* feature, Film* input, const std::string& name, int w, int h) const {
+        if (feature) {
+            return read(feature, w, h);
+        }
+        if (const int index = input->aov_index(name); index >= 0) {
+            return to_vec3(input->aov_buffer(index), w, h);
+        }
+        return {};
+    }
+
+    // Convert film buffer to Vec3 array.
+    // Single-component values are replicated.
+    std::vector<Vec3> to_vec3(const FilmBuffer& buf, int w, int h) const {
+        std::vector<Vec3> v(w*h);
+        for (int i = 0; i < w*h; i++) {
+            const auto* p = buf.data + buf.c*i;
+            v[i] = buf.c == 1 ? Vec3(p[0]) : Vec3(p[0], p[1], p[2]);
+        }
+        return v;
+    }
+};
+
+LM_COMP_REG_IMPL(Denoiser_ATrous, "denoiser::atrous");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -54,6 +54,33 @@ struct AtomicWrapper {
     }
 };
 
+// Allocator performing default initialization instead of value initialization.
+// This leaves the memory untouched on resize() so that the pages are first touched
+// (and thus allocated on the NUMA node of) the threads initializing the elements.
+template <typename T, typename A = std::allocator<T>>
+class DefaultInitAllocator : public A {
+private:
+    using Traits = std::allocator_traits<A>;
+
+public:
+    template <typename U>
+    struct rebind {
+        using other = DefaultInitAllocator<U, typename Traits::template rebind_alloc<U>>;
+    };
+
+    using A::A;
+
+    template <typename U>
+    void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new(static_cast<void*>(ptr)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) {
+        Traits::construct(static_cast<A&>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
 // ------------------------------------------------------------------------------------------------
 
 // Helper functions on image manipulaion
@@ -115,22 +142,51 @@ namespace image {
 
    :param int w: Width of the film.
    :param int h: Height of the film.
+   :param dict aovs: AOV channels to be added as a map from the name
+                     to the number of components (1 or 3). Optional.
 
    This component implements thread-safe bitmap film.
    The invocation of :cpp:func:`lm::Film::setPixel()` function is thread safe.
+   The film data is initialized by the threads of the parallel subsystem if initialized
+   so that the memory is distributed over NUMA nodes by first touch.
+   If the accumulated weight is positive, the pixel values are divided by the weight
+   when the film is saved or the buffer is requested.
+   The film supports AOV channels. :cpp:func:`lm::Film::save` writes each channel
+   to the path of the image with the name of the channel inserted before the extension,
+   e.g., ``out.albedo.pfm`` for ``out.pfm``, so that all layers are saved at once.
+   Single-component channels are saved as grayscale images.
 \endrst
 */
 class Film_Bitmap final : public Film {
+private:
+    using Data = std::vector<AtomicWrapper<Vec3>, DefaultInitAllocator<AtomicWrapper<Vec3>>>;
+
+    // AOV channel.
+    // Values are stored in Vec3 regardless of the number of components.
+    struct AOV {
+        std::string name;
+        int components;
+        Data data;
+        std::vector<Float> data_temp;
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(name, components, data);
+        }
+    };
+
 private:
     int w_;
     int h_;
     int quality_;
-    std::vector<AtomicWrapper<Vec3>> data_;
+    Data data_;
     std::vector<Vec3> data_temp_;  // Temporary buffer for external reference
+    Float weight_ = 0;             // Accumulated weight for normalization
+    std::vector<AOV> aovs_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(w_, h_, quality_, data_);
+        ar(w_, h_, quality_, data_, weight_, aovs_);
     }
 
 public:
@@ -138,7 +194,13 @@ public:
         w_ = json::value<int>(prop, "w");
         h_ = json::value<int>(prop, "h");
         quality_ = json::value<int>(prop, "quality", 90);
-        data_.assign(w_*h_, {});
+        data_.resize(w_*h_);
+        clear();
+        if (const auto it = prop.find("aovs"); it != prop.end()) {
+            for (auto aov = it->begin(); aov != it->end(); ++aov) {
+                add_aov(aov.key(), aov.value().get<int>());
+            }
+        }
     }
 
     virtual FilmSize size() const override {
@@ -170,49 +232,27 @@ public:
             }
         }
 
-        // Save file
-        // Check extension of the output file
-        const auto ext = fs::path(outpath).extension().string();
-        if (ext == ".png") {
-            const auto data = copy<unsigned char>(true);
-            if (!stbi_write_png(outpath.c_str(), w_, h_, 3, data.data(), w_*3)) {
-                return false;
-            }
-        }
-        #if 0
-        else if (ext == ".jpg") {
-            const auto data = copy<unsigned char>(true);
-            if (!stbi_write_jpg(outpath.c_str(), w_, h_, 3, data.data(), quality_)) {
-                return false;
-            }
-        }
-        #endif
-        else if (ext == ".hdr") {
-            auto data = copy<float>(true);
-            image::sanityCheck(w_, h_, data);
-            if (!stbi_write_hdr(outpath.c_str(), w_, h_, 3, data.data())) {
-                return false;
-            }
+        // Save the image and AOV channels
+        if (!save_image(outpath, data_, 3)) {
+            return false;
         }
-        else if (ext == ".pfm") {
-            const auto data = copy<float>(false);
-            image::sanityCheck(w_, h_, data);
-            if (!image::writePfm(outpath, w_, h_, data)) {
+        for (const auto& aov : aovs_) {
+            const auto path = fs::path(outpath).replace_extension(
+                aov.name + fs::path(outpath).extension().string());
+            LM_INFO("Saving AOV [name='{}', file='{}']", aov.name, path.string());
+            if (!save_image(path.string(), aov.data, aov.components)) {
                 return false;
             }
         }
-        else {
-            LM_ERROR("Invalid extension [ext='{}']", ext);
-            return false;
-        }
 
         return true;
     }
 
     virtual FilmBuffer buffer() override {
+        const auto s = normalization();
         data_temp_.clear();
         for (const auto& v : data_) {
-            data_temp_.push_back(v.v_);
+            data_temp_.push_back(v.v_.load() * s);
         }
         return FilmBuffer{ w_, h_, &data_temp_[0].x };
     }
@@ -231,6 +271,16 @@ public:
             const auto v = film->data_[i].v_.load();
             data_[i].add(v);
         }
+        for (auto& aov : aovs_) {
+            const int index = film->aov_index(aov.name);
+            if (index < 0) {
+                continue;
+            }
+            for (int i = 0; i < w_*h_; i++) {
+                aov.data[i].add(film->aovs_[index].data[i].v_.load());
+            }
+        }
+        weight_ += film->weight_;
     }
 
     virtual void splat_pixel(int x, int y, Vec3 v) override {
@@ -242,24 +292,159 @@ public:
     }
 
     virtual void rescale(Float s) override {
-        parallel::foreach(w_ * h_, [&](long long i, int) {
-            data_[i].v_ = data_[i].v_.load() * s;
+        foreach_data([&](Data& data) {
+            parallel::foreach(w_ * h_, [&](long long i, int) {
+                data[i].v_ = data[i].v_.load() * s;
+            });
         });
     }
 
     virtual void clear() override {
-        data_.assign(w_*h_, {});
+        foreach_data([&](Data& data) {
+            clear_data(data);
+        });
+        weight_ = 0;
+    }
+
+    virtual Float weight() const override {
+        return weight_;
+    }
+
+    virtual void add_weight(Float w) override {
+        weight_ += w;
+    }
+
+    virtual int add_aov(const std::string& name, int components) override {
+        if (components != 1 && components != 3) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Invalid number of AOV components [name='{}', components={}]", name, components);
+        }
+        if (const int index = aov_index(name); index >= 0) {
+            if (aovs_[index].components != components) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument,
+                    "AOV already exists with different components [name='{}']", name);
+            }
+            return index;
+        }
+        aovs_.push_back({ name, components, Data(w_*h_), {} });
+        clear_data(aovs_.back().data);
+        return int(aovs_.size()) - 1;
+    }
+
+    virtual int aov_index(const std::string& name) const override {
+        for (int i = 0; i < int(aovs_.size()); i++) {
+            if (aovs_[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    virtual void splat_aov(int index, int x, int y, Vec3 v) override {
+        aovs_[index].data[y*w_ + x].add(v);
+    }
+
+    virtual FilmBuffer aov_buffer(int index) override {
+        const auto s = normalization();
+        auto& aov = aovs_[index];
+        aov.data_temp.clear();
+        for (const auto& p : aov.data) {
+            const auto v = p.v_.load() * s;
+            for (int i = 0; i < aov.components; i++) {
+                aov.data_temp.push_back(v[i]);
+            }
+        }
+        return FilmBuffer{ w_, h_, aov.data_temp.data(), aov.components };
     }
 
 private:
+    // Number of pixels initialized in a range
+    static constexpr long long ClearGrain = 4096;
+
+    // Clear the data.
+    // Falls back to the serial loop if the parallel subsystem is not initialized,
+    // e.g., when the film is loaded without initializing the framework.
+    void clear_data(Data& data) {
+        const auto clear_range = [&](long long begin, long long end) {
+            for (long long i = begin; i < end; i++) {
+                data[i].v_.store(Vec3(0_f), std::memory_order_relaxed);
+            }
+        };
+        if (!parallel::initialized()) {
+            clear_range(0, w_ * h_);
+            return;
+        }
+        parallel::foreach_range(w_ * h_, ClearGrain, [&](long long begin, long long end, int) {
+            clear_range(begin, end);
+        });
+    }
+
+    // Apply the function to the data of the image and AOV channels
+    template <typename Func>
+    void foreach_data(Func&& func) {
+        func(data_);
+        for (auto& aov : aovs_) {
+            func(aov.data);
+        }
+    }
+
+    // Scale applied to the pixel values for output
+    Float normalization() const {
+        return weight_ > 0 ? 1_f / weight_ : 1_f;
+    }
+
+    // Save an image of the data
+    bool save_image(const std::string& outpath, const Data& data, int components) const {
+        // Check extension of the output file
+        const auto ext = fs::path(outpath).extension().string();
+        if (ext == ".png") {
+            const auto pixels = copy<unsigned char>(data, components, true);
+            if (!stbi_write_png(outpath.c_str(), w_, h_, 3, pixels.data(), w_*3)) {
+                return false;
+            }
+        }
+        #if 0
+        else if (ext == ".jpg") {
+            const auto pixels = copy<unsigned char>(data, components, true);
+            if (!stbi_write_jpg(outpath.c_str(), w_, h_, 3, pixels.data(), quality_)) {
+                return false;
+            }
+        }
+        #endif
+        else if (ext == ".hdr") {
+            auto pixels = copy<float>(data, components, true);
+            image::sanityCheck(w_, h_, pixels);
+            if (!stbi_write_hdr(outpath.c_str(), w_, h_, 3, pixels.data())) {
+                return false;
+            }
+        }
+        else if (ext == ".pfm") {
+            const auto pixels = copy<float>(data, components, false);
+            image::sanityCheck(w_, h_, pixels);
+            if (!image::writePfm(outpath, w_, h_, pixels)) {
+                return false;
+            }
+        }
+        else {
+            LM_ERROR("Invalid extension [ext='{}']", ext);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Copy normalized values to RGB image.
+    // The first component is replicated if the data has a single component.
     template <typename T>
-    std::vector<T> copy(bool flip) const {
+    std::vector<T> copy(const Data& data, int components, bool flip) const {
+        const auto s = normalization();
         std::vector<T> v(w_*h_*3, {});
         for (int y = 0; y < h_; y++) {
             const int yy = !flip ? y : h_-y-1;
             for (int x = 0; x < w_; x++) {
+                const auto p = data[y*w_+x].v_.load();
                 for (int i = 0; i < 3; i++) {
-                    const Float t = data_[y*w_+x].v_.load()[i];
+                    const Float t = p[components == 1 ? 0 : i] * s;
                     if constexpr (std::is_same_v<T, float>) {
                         v[3*(yy*w_+x)+i] = T(t);
                     }
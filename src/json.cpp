@@ -0,0 +1,90 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/json.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::json)
+
+namespace {
+
+// Registered buffers. The Json objects refer to the entries by the identifiers.
+class BufferRegistry {
+private:
+    std::mutex mutex_;
+    std::uint64_t next_id_ = 1;
+    std::unordered_map<std::uint64_t, BufferView> buffers_;
+
+public:
+    static BufferRegistry& instance() {
+        static BufferRegistry instance;
+        return instance;
+    }
+
+    std::uint64_t add(const BufferView& b) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto id = next_id_++;
+        buffers_.emplace(id, b);
+        return id;
+    }
+
+    void remove(std::uint64_t id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        buffers_.erase(id);
+    }
+
+    std::optional<BufferView> find(std::uint64_t id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto it = buffers_.find(id);
+        if (it == buffers_.end()) {
+            return {};
+        }
+        return it->second;
+    }
+};
+
+bool supported_buffer_type(const std::string& type) {
+    return type == "float32" || type == "float64"
+        || type == "int32"   || type == "int64"
+        || type == "uint32"  || type == "uint64";
+}
+
+}
+
+LM_PUBLIC_API ScopedBuffer::ScopedBuffer(const std::string& type, const void* data, size_t size) {
+    if (!supported_buffer_type(type)) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Unsupported buffer type [type='{}']", type);
+    }
+    id_ = BufferRegistry::instance().add({ type, data, size });
+}
+
+LM_PUBLIC_API ScopedBuffer::~ScopedBuffer() {
+    BufferRegistry::instance().remove(id_);
+}
+
+LM_PUBLIC_API BufferView buffer_view(const Json& j) {
+    const auto& id = j["buffer_"];
+    if (!id.is_number_unsigned()) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid buffer reference");
+    }
+    const auto b = BufferRegistry::instance().find(id.get<std::uint64_t>());
+    if (!b) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument,
+            "Buffer is not available. Buffers are valid only during the call passing them.");
+    }
+    return *b;
+}
+
+LM_PUBLIC_API Json parse(const std::string& s) {
+    return Json::parse(s, [](int, Json::parse_event_t event, Json& parsed) {
+        if (event == Json::parse_event_t::key && parsed == "buffer_") {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Buffer references are not allowed in Json text");
+        }
+        return true;
+    });
+}
+
+LM_NAMESPACE_END(LM_NAMESPACE::json)
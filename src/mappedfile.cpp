@@ -0,0 +1,69 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/mappedfile.h>
+#if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+LM_PUBLIC_API bool MappedFile::open(const std::string& path) {
+    close();
+    #if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return false;
+    }
+    const auto size = size_t(st.st_size);
+    if (size > 0) {
+        auto* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        handle_ = p;
+        data_ = (const char*)p;
+        size_ = size;
+    }
+    // The mapping is valid after closing the file descriptor
+    ::close(fd);
+    return true;
+    #else
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    auto* buf = new std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    handle_ = buf;
+    data_ = buf->data();
+    size_ = buf->size();
+    return true;
+    #endif
+}
+
+LM_PUBLIC_API void MappedFile::close() {
+    if (handle_) {
+        #if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+        munmap(handle_, size_);
+        #else
+        delete (std::string*)handle_;
+        #endif
+    }
+    handle_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -65,9 +65,13 @@ public:
         return false;
     }
 
+    virtual bool is_textured() const override {
+        return mapKd_ != nullptr;
+    }
+
     virtual std::optional<MaterialDirectionSample> sample(Rng& rng, const PointGeometry& geom, Vec3 wi) const override {
         const auto[n, u, v] = geom.orthonormal_basis(wi);
-        const auto Kd = mapKd_ ? mapKd_->eval(geom.t) : Kd_;
+        const auto Kd = mapKd_ ? mapKd_->eval_filtered(geom.t, geom.t_footprint) : Kd_;
         const auto d = math::sample_cosine_weighted(rng);
         return MaterialDirectionSample{
             u*d.x + v * d.y + n * d.z,
@@ -81,7 +85,7 @@ public:
     }
 
     virtual std::optional<Vec3> reflectance(const PointGeometry& geom, int) const override {
-        return mapKd_ ? mapKd_->eval(geom.t) : Kd_;
+        return mapKd_ ? mapKd_->eval_filtered(geom.t, geom.t_footprint) : Kd_;
     }
 
     virtual Float pdf(const PointGeometry& geom, int, Vec3 wi, Vec3 wo) const override {
@@ -97,7 +101,7 @@ public:
             return {};
         }
         const auto a = (mapKd_ && mapKd_->has_alpha()) ? mapKd_->eval_alpha(geom.t) : 1_f;
-        return (mapKd_ ? mapKd_->eval(geom.t) : Kd_) * (a / Pi);
+        return (mapKd_ ? mapKd_->eval_filtered(geom.t, geom.t_footprint) : Kd_) * (a / Pi);
     }
 };
 
@@ -0,0 +1,302 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/mesh.h>
+#include <lm/mappedfile.h>
+#include <lm/serial.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Header of the binary mesh format.
+// The header is followed by the sections of the positions (float32 x 3),
+// normals (float32 x 3), and texture coordinates (float32 x 2) of the vertices,
+// and the vertex indices of the triangles (uint32 x 3).
+// Each section starts at an offset aligned to 64 bytes. The offset is zero if the section is missing.
+// The values are stored in little endian.
+struct BinaryMeshHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t num_vertices;
+    uint64_t num_triangles;
+    uint64_t offset_ps;
+    uint64_t offset_ns;
+    uint64_t offset_ts;
+    uint64_t offset_fs;
+};
+
+constexpr char BinaryMeshMagic[8] = { 'L', 'M', 'M', 'E', 'S', 'H', '\0', '\0' };
+constexpr uint32_t BinaryMeshVersion = 1;
+constexpr uint64_t BinaryMeshAlignment = 64;
+
+uint64_t align_offset(uint64_t offset) {
+    return (offset + BinaryMeshAlignment - 1) / BinaryMeshAlignment * BinaryMeshAlignment;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: mesh::binary
+
+   Mesh in the binary mesh format.
+
+   :param str path: Path to the mesh file.
+
+   The file is memory-mapped and the mesh queries read the vertices directly from the mapping,
+   so loading a mesh does not depend on the number of triangles.
+   The mapped pages are shared among the processes loading the same file.
+   A mesh can be converted to the format with :cpp:func:`lm::mesh::save_binary`.
+   The file must not be modified while the mesh is in use.
+   On serialization, only the path is saved and the file is mapped again on deserialization.
+\endrst
+*/
+class Mesh_Binary final : public Mesh {
+private:
+    std::string path_;
+    MappedFile file_;
+    const float* ps_ = nullptr;     // Positions
+    const float* ns_ = nullptr;     // Normals. nullptr if missing.
+    const float* ts_ = nullptr;     // Texture coordinates. nullptr if missing.
+    const uint32_t* fs_ = nullptr;  // Vertex indices of the triangles
+    uint64_t num_vertices_ = 0;
+    int num_triangles_ = 0;
+
+public:
+    virtual void save(OutputArchive& ar) override {
+        ar(path_);
+    }
+
+    virtual void load(InputArchive& ar) override {
+        ar(path_);
+        open();
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        path_ = json::value<std::string>(prop, "path");
+        open();
+    }
+
+    virtual void foreach_triangle(const ProcessTriangleFunc& processTriangle) const override {
+        for (int fi = 0; fi < num_triangles_; fi++) {
+            processTriangle(fi, triangle_at(fi));
+        }
+    }
+
+    virtual Tri triangle_at(int face) const override {
+        const auto* f = face_at(face);
+        return {
+            { p(f[0]), n(f[0]), t(f[0]) },
+            { p(f[1]), n(f[1]), t(f[1]) },
+            { p(f[2]), n(f[2]), t(f[2]) }
+        };
+    }
+
+    virtual Point surface_point(int face, Vec2 uv) const override {
+        const auto* f = face_at(face);
+        const auto p1 = p(f[0]);
+        const auto p2 = p(f[1]);
+        const auto p3 = p(f[2]);
+        const auto gn = glm::normalize(glm::cross(p2-p1, p3-p1));
+        // Use geometry normal for the vertices without the attribute,
+        // which are stored as zero if only a part of the vertices have normals.
+        const auto vn = [&](uint32_t i) {
+            const auto v = n(i);
+            return v == Vec3(0_f) ? gn : v;
+        };
+        return {
+            // Position
+            math::mix_barycentric(p1, p2, p3, uv),
+            // Normal. Use geometry normal if the attribute is missing.
+            !ns_ ? gn : glm::normalize(math::mix_barycentric(vn(f[0]), vn(f[1]), vn(f[2]), uv)),
+            // Texture coordinates
+            !ts_ ? Vec2(0) : math::mix_barycentric(t(f[0]), t(f[1]), t(f[2]), uv)
+        };
+    }
+
+    virtual int num_triangles() const override {
+        return num_triangles_;
+    }
+
+private:
+    // Vertex indices of the triangle.
+    // The indices are validated on access instead of on load
+    // so that loading a mesh does not touch all pages of the indices.
+    const uint32_t* face_at(int face) const {
+        const auto* f = &fs_[3*face];
+        if (f[0] >= num_vertices_ || f[1] >= num_vertices_ || f[2] >= num_vertices_) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Invalid vertex index of binary mesh [path='{}', face={}, vertices={}]",
+                path_, face, num_vertices_);
+        }
+        return f;
+    }
+
+    Vec3 p(uint32_t i) const {
+        return Vec3(ps_[3*i], ps_[3*i+1], ps_[3*i+2]);
+    }
+
+    Vec3 n(uint32_t i) const {
+        return ns_ ? Vec3(ns_[3*i], ns_[3*i+1], ns_[3*i+2]) : Vec3();
+    }
+
+    Vec2 t(uint32_t i) const {
+        return ts_ ? Vec2(ts_[2*i], ts_[2*i+1]) : Vec2();
+    }
+
+    // Map the file and locate the sections
+    void open() {
+        LM_INFO("Loading binary mesh [path='{}']", path_);
+        if (!file_.open(path_)) {
+            LM_THROW_EXCEPTION(Error::IOError, "Failed to open binary mesh [path='{}']", path_);
+        }
+        BinaryMeshHeader h;
+        if (file_.size() < sizeof(h)) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid binary mesh [path='{}']", path_);
+        }
+        std::memcpy(&h, file_.data(), sizeof(h));
+        if (std::memcmp(h.magic, BinaryMeshMagic, sizeof(BinaryMeshMagic)) != 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid binary mesh [path='{}']", path_);
+        }
+        if (h.version != BinaryMeshVersion) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Unsupported version of binary mesh [path='{}', version={}]", path_, h.version);
+        }
+        if (h.num_triangles > uint64_t(std::numeric_limits<int>::max()) || h.num_vertices > (uint64_t(1) << 32)) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Too large binary mesh [path='{}']", path_);
+        }
+
+        // Locate a section with the given size
+        const auto section = [&](uint64_t offset, uint64_t size) -> const char* {
+            if (offset == 0) {
+                return nullptr;
+            }
+            const auto file_size = uint64_t(file_.size());
+            if (offset % BinaryMeshAlignment != 0 || offset > file_size || size > file_size - offset) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid section of binary mesh [path='{}']", path_);
+            }
+            return file_.data() + offset;
+        };
+        ps_ = (const float*)section(h.offset_ps, h.num_vertices * 3 * sizeof(float));
+        ns_ = (const float*)section(h.offset_ns, h.num_vertices * 3 * sizeof(float));
+        ts_ = (const float*)section(h.offset_ts, h.num_vertices * 2 * sizeof(float));
+        fs_ = (const uint32_t*)section(h.offset_fs, h.num_triangles * 3 * sizeof(uint32_t));
+        if (!ps_ || !fs_) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Missing section of binary mesh [path='{}']", path_);
+        }
+
+        num_vertices_ = h.num_vertices;
+        num_triangles_ = int(h.num_triangles);
+    }
+};
+
+LM_COMP_REG_IMPL(Mesh_Binary, "mesh::binary");
+
+// ------------------------------------------------------------------------------------------------
+
+LM_NAMESPACE_BEGIN(mesh)
+
+LM_PUBLIC_API void save_binary(const Mesh* mesh, const std::string& path) {
+    // Vertex attributes in the stored precision
+    struct Vertex {
+        float p[3];
+        float n[3];
+        float t[2];
+    };
+    struct VertexHash {
+        size_t operator()(const Vertex& v) const {
+            return std::hash<std::string_view>{}(std::string_view((const char*)&v, sizeof(Vertex)));
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex& a, const Vertex& b) const {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    // Deduplicate the vertices shared among the triangles
+    std::vector<Vertex> vs;
+    std::vector<uint32_t> fs;
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> vertex_index;
+    bool has_ns = false;
+    bool has_ts = false;
+    fs.reserve(size_t(mesh->num_triangles()) * 3);
+    mesh->foreach_triangle([&](int, const Mesh::Tri& tri) {
+        for (const auto* q : { &tri.p1, &tri.p2, &tri.p3 }) {
+            Vertex v{
+                { float(q->p.x), float(q->p.y), float(q->p.z) },
+                { float(q->n.x), float(q->n.y), float(q->n.z) },
+                { float(q->t.x), float(q->t.y) }
+            };
+            has_ns |= q->n != Vec3(0_f);
+            has_ts |= q->t != Vec2(0_f);
+            const auto it = vertex_index.emplace(v, uint32_t(vs.size()));
+            if (it.second) {
+                vs.push_back(v);
+            }
+            fs.push_back(it.first->second);
+        }
+    });
+
+    // Compute the offsets of the sections
+    BinaryMeshHeader h{};
+    std::memcpy(h.magic, BinaryMeshMagic, sizeof(BinaryMeshMagic));
+    h.version = BinaryMeshVersion;
+    h.num_vertices = vs.size();
+    h.num_triangles = fs.size() / 3;
+    uint64_t offset = align_offset(sizeof(h));
+    const auto next_section = [&](uint64_t size) {
+        const auto o = offset;
+        offset = align_offset(offset + size);
+        return o;
+    };
+    h.offset_ps = next_section(h.num_vertices * 3 * sizeof(float));
+    h.offset_ns = has_ns ? next_section(h.num_vertices * 3 * sizeof(float)) : 0;
+    h.offset_ts = has_ts ? next_section(h.num_vertices * 2 * sizeof(float)) : 0;
+    h.offset_fs = next_section(h.num_triangles * 3 * sizeof(uint32_t));
+
+    // Write the file
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out) {
+        LM_THROW_EXCEPTION(Error::IOError, "Failed to open file [path='{}']", path);
+    }
+    const auto write_at = [&](uint64_t at, const void* data, size_t size) {
+        const auto curr = uint64_t(out.tellp());
+        const char zeros[BinaryMeshAlignment] = {};
+        out.write(zeros, std::streamsize(at - curr));
+        out.write((const char*)data, std::streamsize(size));
+    };
+    write_at(0, &h, sizeof(h));
+    const auto write_attribute = [&](uint64_t at, int components, const std::function<const float*(const Vertex&)>& attr) {
+        if (at == 0) {
+            return;
+        }
+        std::vector<float> data;
+        data.reserve(vs.size() * components);
+        for (const auto& v : vs) {
+            const auto* a = attr(v);
+            data.insert(data.end(), a, a + components);
+        }
+        write_at(at, data.data(), data.size() * sizeof(float));
+    };
+    write_attribute(h.offset_ps, 3, [](const Vertex& v) { return v.p; });
+    write_attribute(h.offset_ns, 3, [](const Vertex& v) { return v.n; });
+    write_attribute(h.offset_ts, 2, [](const Vertex& v) { return v.t; });
+    write_at(h.offset_fs, fs.data(), fs.size() * sizeof(uint32_t));
+    if (!out) {
+        LM_THROW_EXCEPTION(Error::IOError, "Failed to write binary mesh [path='{}']", path);
+    }
+    LM_INFO("Saved binary mesh [path='{}', vertices={}, triangles={}]", path, h.num_vertices, h.num_triangles);
+}
+
+LM_NAMESPACE_END(mesh)
+
+LM_NAMESPACE_END(LM_NAMESPACE)
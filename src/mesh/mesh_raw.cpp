@@ -6,6 +6,7 @@
 #include <pch.h>
 #include <lm/core.h>
 #include <lm/mesh.h>
+#include <lm/blob.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -22,10 +23,10 @@ struct MeshFaceIndex {
 
 class Mesh_Raw final : public Mesh {
 private:
-    std::vector<Vec3> ps_;           // Positions
-    std::vector<Vec3> ns_;           // Normals
-    std::vector<Vec2> ts_;           // Texture coordinates
-    std::vector<MeshFaceIndex> fs_;  // Faces
+    Blob<Vec3> ps_;             // Positions
+    Blob<Vec3> ns_;             // Normals
+    Blob<Vec2> ts_;             // Texture coordinates
+    Blob<MeshFaceIndex> fs_;    // Faces
 
 public:
     LM_SERIALIZE_IMPL(ar) {
@@ -34,22 +35,31 @@ public:
 
 public:
     virtual void construct(const Json& prop) override {
+        // The arrays are given either as Json arrays or buffers.
+        // The vertex attributes are copied directly into the storages.
+        static_assert(sizeof(Vec3) == 3*sizeof(Float) && sizeof(Vec2) == 2*sizeof(Float));
+        auto& ps_v = ps_.vec();
         const auto& ps = prop["ps"];
-        for (int i = 0; i < ps.size(); i+=3) {
-            ps_.push_back(Vec3(ps[i],ps[i+1],ps[i+2]));
-        }
+        ps_v.resize(json::array_size(ps) / 3);
+        json::copy_array(ps, (Float*)ps_v.data(), 3*ps_v.size());
+        auto& ns_v = ns_.vec();
         const auto& ns = prop["ns"];
-        for (int i = 0; i < ns.size(); i+=3) {
-            ns_.push_back(Vec3(ns[i],ns[i+1],ns[i+2]));
-        }
+        ns_v.resize(json::array_size(ns) / 3);
+        json::copy_array(ns, (Float*)ns_v.data(), 3*ns_v.size());
+        auto& ts_v = ts_.vec();
         const auto& ts = prop["ts"];
-        for (int i = 0; i < ts.size(); i+=2) {
-            ts_.push_back(Vec2(ts[i],ts[i+1]));
-        }
+        ts_v.resize(json::array_size(ts) / 2);
+        json::copy_array(ts, (Float*)ts_v.data(), 2*ts_v.size());
+        auto& fs_v = fs_.vec();
         const auto& fs = prop["fs"];
-        const int fs_size = int(fs["p"].size());
-        for (int i = 0; i < fs_size; i++) {
-            fs_.push_back(MeshFaceIndex{ fs["p"][i],fs["t"][i],fs["n"][i] });
+        const auto fs_size = json::array_size(fs["p"]);
+        std::vector<int> fp(fs_size), ft(fs_size), fn(fs_size);
+        json::copy_array(fs["p"], fp.data(), fs_size);
+        json::copy_array(fs["t"], ft.data(), fs_size);
+        json::copy_array(fs["n"], fn.data(), fs_size);
+        fs_v.resize(fs_size);
+        for (size_t i = 0; i < fs_size; i++) {
+            fs_v[i] = MeshFaceIndex{ fp[i], ft[i], fn[i] };
         }
     }
 
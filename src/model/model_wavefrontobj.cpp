@@ -13,12 +13,81 @@
 #include <lm/film.h>
 #include <lm/light.h>
 #include <lm/surface.h>
+#include <lm/parallel.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
 using namespace objloader;
 class Mesh_WavefrontObj;
 
+namespace {
+
+// Worker threads processing the tasks pushed while the caller continues other work
+class WorkerPool {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    bool closed_ = false;               // True if no more tasks are pushed
+    std::vector<std::thread> threads_;
+
+public:
+    WorkerPool(int num_threads) {
+        for (int i = 0; i < num_threads; i++) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~WorkerPool() {
+        join();
+    }
+
+    LM_DISABLE_COPY_AND_MOVE(WorkerPool)
+
+public:
+    // Push a task. The task must not throw exceptions.
+    void push(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    // Wait for the completion of all tasks
+    void join() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return closed_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+};
+
+}
+
 class Model_WavefrontObj final : public Model {
 private:
     friend class Mesh_WavefrontObj;
@@ -62,6 +131,45 @@ public:
 
 	virtual void construct(const Json& prop) override {
         const std::string path = json::value<std::string>(prop, "path");
+        const auto texture_impl = json::value<std::string>(prop, "texture", "texture::bitmap");
+
+        // Textures are loaded by the worker threads while parsing the OBJ file.
+        // The materials referring to the textures are created after all textures are loaded.
+        // Each model owns its textures. The texture implementation can share the texels
+        // among the textures loaded from the same file, e.g., texture::bitmap.
+        struct TextureJob {
+            std::string id;             // Identifier of the texture in the model
+            std::string path;           // Path to the texture
+            Component::Ptr<Texture> texture;    // Loaded texture
+            std::string loc;            // Locator of the texture used by the materials
+            std::exception_ptr error;   // Exception thrown while loading the texture
+        };
+        struct MaterialJob {
+            MTLMatParams params;        // Copy of material parameters
+            int texture;                // Index of the texture job. -1 if no texture.
+        };
+        std::deque<TextureJob> texture_jobs;
+        std::unordered_map<std::string, int> texture_job_map;
+        std::deque<MaterialJob> material_jobs;
+        std::vector<std::string> group_materials;   // Material names of the mesh groups
+
+        // Load a texture
+        const auto load_texture = [this, &texture_impl](TextureJob& job) {
+            try {
+                job.loc = make_loc(job.id);
+                job.texture = comp::create<Texture>(texture_impl, job.loc, {
+                    {"path", job.path}
+                });
+                if (!job.texture) {
+                    LM_THROW_EXCEPTION(Error::InvalidArgument, "Failed to create texture [path='{}']", job.path);
+                }
+            }
+            catch (...) {
+                job.error = std::current_exception();
+            }
+        };
+        std::optional<WorkerPool> workers;
+
         bool result = objloader::load(path, geo_,
             // Process mesh
             [&](const OBJMeshFace& fs, const MTLMatParams& m) -> bool {
@@ -97,8 +205,9 @@ public:
                     assets_.push_back(std::move(light));
                 }
 
-                // Create mesh group
-                groups_.push_back({ assets_map_[mesh_name], assets_map_[m.name], light_index });
+                // Create mesh group. The material is resolved after the materials are created.
+                groups_.push_back({ assets_map_[mesh_name], -1, light_index });
+                group_materials.push_back(m.name);
 
                 return true;
             },
@@ -117,49 +226,70 @@ public:
                     return true;
                 }
 
-                // Load texture
-                std::string mapKd_loc;
+                // Start loading texture
+                int texture = -1;
                 if (!m.mapKd.empty()) {
                     // Use texture_<filename> as an identifier
                     const auto id = "texture_" + fs::path(m.mapKd).stem().string();
 
-                    // Check if already loaded
-                    if (auto it = assets_map_.find(id); it == assets_map_.end()) {
-                        // If not loaded, load the texture
-                        const auto textureAssetName = json::value<std::string>(prop, "texture", "texture::bitmap");
-                        auto texture = comp::create<Texture>(textureAssetName, make_loc(id), {
-                            {"path", (fs::path(path).remove_filename()/m.mapKd).string()}
-                        });
-                        if (!texture) {
-                            return false;
+                    // Check if already requested
+                    if (auto it = texture_job_map.find(id); it != texture_job_map.end()) {
+                        texture = it->second;
+                    }
+                    else {
+                        texture = int(texture_jobs.size());
+                        texture_job_map[id] = texture;
+                        auto& job = texture_jobs.emplace_back();
+                        job.id = id;
+                        job.path = (fs::path(path).remove_filename()/m.mapKd).string();
+                        if (!workers) {
+                            workers.emplace(std::max(1, parallel::num_threads()));
                         }
-                        assets_map_[id] = int(assets_.size());
-                        assets_.push_back(std::move(texture));
+                        workers->push([&job, &load_texture] { load_texture(job); });
                     }
-
-                    // Locator of the texture
-                    mapKd_loc = make_loc(id);
                 }
 
-                // Default mixture material
-                auto mat = comp::create<Material>(
-                    "material::wavefrontobj", make_loc(m.name),
-                    json::merge(prop, {
-                        {"matparams_", (const MTLMatParams*)&m},
-                        {"mapKd_", mapKd_loc}
-                    }
-                ));
-                if (!mat) {
-                    return false;
-                }
-                assets_map_[m.name] = int(assets_.size());
-                assets_.push_back(std::move(mat));
+                // Default mixture material is created after the texture is loaded
+                material_jobs.push_back({ m, texture });
 
                 return true;
             });
+        if (workers) {
+            workers->join();
+        }
         if (!result) {
             LM_THROW_EXCEPTION_DEFAULT(Error::IOError);
         }
+
+        // Register loaded textures
+        for (auto& job : texture_jobs) {
+            if (job.error) {
+                std::rethrow_exception(job.error);
+            }
+            assets_map_[job.id] = int(assets_.size());
+            assets_.push_back(std::move(job.texture));
+        }
+
+        // Create default mixture materials
+        for (const auto& job : material_jobs) {
+            auto mat = comp::create<Material>(
+                "material::wavefrontobj", make_loc(job.params.name),
+                json::merge(prop, {
+                    {"matparams_", &job.params},
+                    {"mapKd_", job.texture < 0 ? "" : texture_jobs[job.texture].loc}
+                }
+            ));
+            if (!mat) {
+                LM_THROW_EXCEPTION_DEFAULT(Error::IOError);
+            }
+            assets_map_[job.params.name] = int(assets_.size());
+            assets_.push_back(std::move(mat));
+        }
+
+        // Resolve materials of the mesh groups
+        for (size_t i = 0; i < groups_.size(); i++) {
+            groups_[i].material = assets_map_[group_materials[i]];
+        }
     }
     
     virtual void create_primitives(const CreatePrimitiveFunc& createPrimitive) const override {
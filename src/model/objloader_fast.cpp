@@ -0,0 +1,358 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/objloader.h>
+#include <lm/parallel.h>
+#include <lm/mappedfile.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::objloader)
+
+namespace {
+
+// Calls func(begin, end) for each line in [b,e) excluding the line terminator
+template <typename Func>
+void foreach_line(const char* b, const char* e, Func&& func) {
+    while (b < e) {
+        const auto* p = (const char*)std::memchr(b, '\n', e - b);
+        const auto* l = p ? p : e;
+        func(b, l > b && l[-1] == '\r' ? l - 1 : l);
+        b = p ? p + 1 : e;
+    }
+}
+
+// Checks a character is space-like
+bool whitespace(char c) { return c == ' ' || c == '\t'; }
+
+// Skips spaces
+void skip_spaces(const char*& t, const char* e) { while (t < e && whitespace(*t)) { t++; } }
+
+// Skips the current token
+void skip_token(const char*& t, const char* e) { while (t < e && !whitespace(*t)) { t++; } }
+
+// Checks the token is a command and moves to the next of the command
+bool command(const char*& t, const char* e, const char* c, int n) {
+    if (e - t <= n || std::strncmp(t, c, n) != 0 || !whitespace(t[n])) {
+        return false;
+    }
+    t += n + 1;
+    return true;
+}
+
+// Parses an integer. Unparsable value is treated as zero.
+int next_int(const char*& t, const char* e) {
+    skip_spaces(t, e);
+    bool negative = false;
+    if (t < e && (*t == '+' || *t == '-')) {
+        negative = *t == '-';
+        t++;
+    }
+    int v = 0;
+    while (t < e && '0' <= *t && *t <= '9') {
+        v = v * 10 + (*t - '0');
+        t++;
+    }
+    return negative ? -v : v;
+}
+
+// Parses a floating point value. Unparsable value is treated as zero.
+// The token is copied to a null-terminated buffer for strtod
+// because the lines in the mapped file are not null-terminated.
+Float next_float(const char*& t, const char* e) {
+    skip_spaces(t, e);
+    const auto* start = t;
+    skip_token(t, e);
+    char buf[64];
+    const auto n = std::min(size_t(t - start), sizeof(buf) - 1);
+    std::memcpy(buf, start, n);
+    buf[n] = '\0';
+    char* end;
+    const auto v = std::strtod(buf, &end);
+    return end == buf ? 0_f : Float(v);
+}
+
+// Parses 3d vector
+Vec3 next_vec3(const char*& t, const char* e) {
+    Vec3 v;
+    v.x = next_float(t, e);
+    v.y = next_float(t, e);
+    v.z = next_float(t, e);
+    return v;
+}
+
+// Parses a string
+std::string next_string(const char*& t, const char* e) {
+    skip_spaces(t, e);
+    const auto* start = t;
+    skip_token(t, e);
+    return std::string(start, t);
+}
+
+// Parses vertex index. See specification of obj file for detail.
+int parse_index(int i, long long vn) { return i < 0 ? int(vn + i) : i > 0 ? i - 1 : -1; }
+
+// Statement in a chunk processed in order on merge
+struct Statement {
+    enum class Type {
+        Faces,      // Consecutive faces
+        UseMtl,     // 'usemtl'
+        MtlLib,     // 'mtllib'
+    };
+    Type type;
+    std::string name;
+    std::vector<OBJMeshFaceIndex> faces;
+};
+
+// Line-aligned chunk of an OBJ file parsed in parallel
+struct Chunk {
+    const char* begin;
+    const char* end;
+    long long np = 0;   // Number of positions, normals, and texture coordinates in the chunk
+    long long nn = 0;
+    long long nt = 0;
+    std::vector<Statement> statements;
+};
+
+}
+
+/*
+    Wavefront OBJ/MTL file parser processing the file in parallel.
+
+    The file is memory-mapped and split into line-aligned chunks.
+    The first pass counts the vertex attributes in each chunk and the prefix sums of the counts
+    give the global indices of the attributes at the beginning of each chunk.
+    The second pass parses the chunks in parallel, where the attributes are written directly
+    to the preallocated arrays and the relative (negative) face indices are resolved
+    with the global indices. Finally the statements of the chunks are merged in order
+    to call the callback functions with the same groups as objloader::simple.
+    The MTL files are parsed sequentially.
+*/
+class OBJLoaderContext_Fast : public OBJLoaderContext {
+public:
+    // Material parameters
+    std::vector<MTLMatParams> ms_;
+    std::unordered_map<std::string, int> msmap_;
+
+    // Minimum size of a chunk in bytes
+    long long min_chunk_size_ = 1 << 20;
+
+public:
+    virtual void construct(const Json& prop) override {
+        min_chunk_size_ = json::value(prop, "min_chunk_size", min_chunk_size_);
+    }
+
+    virtual bool load(
+        const std::string& path,
+        OBJSurfaceGeometry& geo,
+        const ProcessMeshFunc& process_mesh,
+        const ProcessMaterialFunc& process_material) override
+    {
+        ms_.clear();
+        msmap_.clear();
+
+        LM_INFO("Loading OBJ file [path='{}']", fs::path(path).filename().string());
+        MappedFile f;
+        if (!f.open(path)) {
+            LM_ERROR("Missing OBJ file [path='{}']", path);
+            return false;
+        }
+
+        // Split the file into line-aligned chunks
+        std::vector<Chunk> chunks;
+        {
+            const auto size = (long long)(f.size());
+            const auto chunk_size = std::max(min_chunk_size_, size / (4LL * parallel::num_threads()) + 1);
+            const auto* b = f.begin();
+            while (b < f.end()) {
+                const auto* e = b + std::min(chunk_size, (long long)(f.end() - b));
+                if (e < f.end()) {
+                    const auto* p = (const char*)std::memchr(e, '\n', f.end() - e);
+                    e = p ? p + 1 : f.end();
+                }
+                chunks.push_back({ b, e });
+                b = e;
+            }
+        }
+
+        // Count vertex attributes in the chunks
+        parallel::foreach(chunks.size(), [&](long long i, int) {
+            auto& chunk = chunks[i];
+            foreach_line(chunk.begin, chunk.end, [&](const char* t, const char* e) {
+                skip_spaces(t, e);
+                if (command(t, e, "v", 1)) {
+                    chunk.np++;
+                } else if (command(t, e, "vn", 2)) {
+                    chunk.nn++;
+                } else if (command(t, e, "vt", 2)) {
+                    chunk.nt++;
+                }
+            });
+        });
+
+        // Global indices of the attributes at the beginning of the chunks.
+        // The indices are offset by the attributes already in geo.
+        std::vector<long long> op(chunks.size()), on(chunks.size()), ot(chunks.size());
+        {
+            long long np = geo.ps.size(), nn = geo.ns.size(), nt = geo.ts.size();
+            for (size_t i = 0; i < chunks.size(); i++) {
+                op[i] = np; np += chunks[i].np;
+                on[i] = nn; nn += chunks[i].nn;
+                ot[i] = nt; nt += chunks[i].nt;
+            }
+            geo.ps.resize(np);
+            geo.ns.resize(nn);
+            geo.ts.resize(nt);
+        }
+
+        // Parse the chunks
+        parallel::foreach(chunks.size(), [&](long long i, int) {
+            auto& chunk = chunks[i];
+            auto np = op[i], nn = on[i], nt = ot[i];
+            std::vector<OBJMeshFaceIndex> is;
+            foreach_line(chunk.begin, chunk.end, [&](const char* t, const char* e) {
+                skip_spaces(t, e);
+                if (command(t, e, "v", 1)) {
+                    geo.ps[np++] = next_vec3(t, e);
+                } else if (command(t, e, "vn", 2)) {
+                    geo.ns[nn++] = next_vec3(t, e);
+                } else if (command(t, e, "vt", 2)) {
+                    const auto u = next_float(t, e);
+                    const auto v = next_float(t, e);
+                    geo.ts[nt++] = Vec2(u, v);
+                } else if (command(t, e, "f", 1)) {
+                    is.clear();
+                    skip_spaces(t, e);
+                    while (t < e) {
+                        const auto* start = t;
+                        OBJMeshFaceIndex fi;
+                        fi.p = parse_index(next_int(t, e), np);
+                        if (t < e && *t == '/') {
+                            t++;
+                            fi.t = parse_index(next_int(t, e), nt);
+                            if (t < e && *t == '/') {
+                                t++;
+                                fi.n = parse_index(next_int(t, e), nn);
+                            }
+                        }
+                        if (t == start) {
+                            skip_token(t, e);
+                        }
+                        is.push_back(fi);
+                        skip_spaces(t, e);
+                    }
+                    if (is.size() < 3) {
+                        return;
+                    }
+                    if (chunk.statements.empty() || chunk.statements.back().type != Statement::Type::Faces) {
+                        chunk.statements.push_back({ Statement::Type::Faces });
+                    }
+                    // Triangulate polygon
+                    auto& faces = chunk.statements.back().faces;
+                    for (size_t k = 1; k + 1 < is.size(); k++) {
+                        faces.insert(faces.end(), { is[0], is[k], is[k+1] });
+                    }
+                } else if (command(t, e, "usemtl", 6)) {
+                    chunk.statements.push_back({ Statement::Type::UseMtl, next_string(t, e) });
+                } else if (command(t, e, "mtllib", 6)) {
+                    chunk.statements.push_back({ Statement::Type::MtlLib, next_string(t, e) });
+                }
+            });
+        });
+
+        // Merge the statements of the chunks in order
+        int currMaterialIdx = -1;
+        std::vector<OBJMeshFaceIndex> currfs;
+        for (auto& chunk : chunks) {
+            for (auto& st : chunk.statements) {
+                if (st.type == Statement::Type::Faces) {
+                    if (ms_.empty()) {
+                        // Process the case where MTL file is missing
+                        ms_.push_back({ "default", -1, Vec3(1) });
+                        if (!process_material(ms_.back())) {
+                            return false;
+                        }
+                        currMaterialIdx = 0;
+                    }
+                    if (currfs.empty()) {
+                        currfs = std::move(st.faces);
+                    }
+                    else {
+                        currfs.insert(currfs.end(), st.faces.begin(), st.faces.end());
+                    }
+                } else if (st.type == Statement::Type::UseMtl) {
+                    if (!currfs.empty()) {
+                        // 'usemtl' indicates end of mesh groups
+                        if (!process_mesh(currfs, ms_.at(currMaterialIdx))) {
+                            return false;
+                        }
+                        currfs.clear();
+                    }
+                    const auto it = msmap_.find(st.name);
+                    if (it == msmap_.end()) {
+                        LM_ERROR("Missing material [name='{}']", st.name);
+                        return false;
+                    }
+                    currMaterialIdx = it->second;
+                } else if (st.type == Statement::Type::MtlLib) {
+                    if (!loadmtl((fs::path(path).remove_filename() / st.name).string(), process_material)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        if (!currfs.empty()) {
+            if (!process_mesh(currfs, ms_.at(currMaterialIdx))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    // Parses .mtl file
+    bool loadmtl(std::string p, const ProcessMaterialFunc& process_material) {
+        LM_INFO("Loading MTL file [path='{}']", fs::path(p).filename().string());
+        MappedFile f;
+        if (!f.open(p)) {
+            LM_ERROR("Missing MLT file [path='{}']", p);
+            return false;
+        }
+        foreach_line(f.begin(), f.end(), [&](const char* t, const char* e) {
+            skip_spaces(t, e);
+            if (command(t, e, "newmtl", 6)) {
+                const auto name = next_string(t, e);
+                msmap_[name] = int(ms_.size());
+                ms_.emplace_back();
+                ms_.back().name = name;
+                return;
+            }
+            if (ms_.empty()) {
+                return;
+            }
+            auto& m = ms_.back();
+            if      (command(t, e, "Kd", 2))     { m.Kd = next_vec3(t, e); }
+            else if (command(t, e, "Ks", 2))     { m.Ks = next_vec3(t, e); }
+            else if (command(t, e, "Ni", 2))     { m.Ni = next_float(t, e); }
+            else if (command(t, e, "Ns", 2))     { m.Ns = next_float(t, e); }
+            else if (command(t, e, "aniso", 5))  { m.an = next_float(t, e); }
+            else if (command(t, e, "Ke", 2))     { m.Ke = next_vec3(t, e); }
+            else if (command(t, e, "illum", 5))  { m.illum = next_int(t, e); }
+            else if (command(t, e, "map_Kd", 6)) { m.mapKd = next_string(t, e); }
+        });
+        // Let the user to process materials
+        for (const auto& m : ms_) {
+            if (!process_material(m)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+LM_COMP_REG_IMPL(OBJLoaderContext_Fast, "objloader::fast");
+
+LM_NAMESPACE_END(LM_NAMESPACE::objloader)
@@ -10,6 +10,18 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE::parallel)
 
 using Instance = comp::detail::ContextInstance<ParallelContext>;
 
+namespace {
+
+// Global cancellation token.
+// Defined outside of the context so that it is accessible from signal handlers.
+CancelToken global_cancel_token_;
+
+}
+
+LM_PUBLIC_API CancelToken& cancel_token() {
+    return global_cancel_token_;
+}
+
 LM_PUBLIC_API void init(const std::string& type, const Json& prop) {
     Instance::init("parallel::" + type, prop);
 }
@@ -18,6 +30,10 @@ LM_PUBLIC_API void shutdown() {
     Instance::shutdown();
 }
 
+LM_PUBLIC_API bool initialized() {
+    return Instance::initialized();
+}
+
 LM_PUBLIC_API int num_threads() {
     return Instance::get().num_threads();
 }
@@ -26,8 +42,24 @@ LM_PUBLIC_API bool main_thread() {
     return Instance::get().main_thread();
 }
 
-LM_PUBLIC_API void foreach(long long num_samples, const ParallelProcessFunc& process_func, const ProgressUpdateFunc& progress_func) {
-	Instance::get().foreach(num_samples, process_func, progress_func);
+LM_PUBLIC_API int num_numa_nodes() {
+    return Instance::get().num_numa_nodes();
+}
+
+LM_PUBLIC_API int numa_node() {
+    return Instance::get().numa_node();
+}
+
+LM_PUBLIC_API void foreach_numa_node(const NumaNodeFunc& func) {
+    Instance::get().foreach_numa_node(func);
+}
+
+LM_PUBLIC_API long long foreach(long long num_samples, const ParallelProcessFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token) {
+	return Instance::get().foreach(num_samples, process_func, progress_func, token);
+}
+
+LM_PUBLIC_API long long foreach_range(long long num_samples, long long grain, const ParallelProcessRangeFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token) {
+    return Instance::get().foreach_range(num_samples, grain, process_func, progress_func, token);
 }
 
 LM_NAMESPACE_END(LM_NAMESPACE::parallel)
@@ -11,13 +11,121 @@
 #if LM_PLATFORM_WINDOWS
 #include <Windows.h>
 #endif
+#if LM_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE::parallel)
 
+namespace {
+
+// Thread affinity mode
+enum class Affinity {
+    None,       // Do not pin threads
+    Compact,    // Fill the cores of a NUMA node before using the next node
+    Scatter,    // Distribute the threads over NUMA nodes in round-robin
+};
+
+// CPU and NUMA node which the current thread is pinned to (-1 if not pinned)
+thread_local int current_cpu = -1;
+thread_local int current_numa_node = 0;
+
+#if LM_PLATFORM_LINUX
+// Parse a list of cpus, e.g., "0-3,8-11"
+std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> cpus;
+    std::stringstream ss(s);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        const auto i = range.find('-');
+        const int b = std::stoi(range.substr(0, i));
+        const int e = i == std::string::npos ? b : std::stoi(range.substr(i + 1));
+        for (int cpu = b; cpu <= e; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Enumerate cpus of each NUMA node
+std::vector<std::vector<int>> numa_topology() {
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    const fs::path dir("/sys/devices/system/node");
+    std::error_code ec;
+    if (fs::exists(dir, ec)) {
+        const std::regex re(R"x(node(\d+))x");
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::smatch match;
+            const auto name = entry.path().filename().string();
+            if (!std::regex_match(name, match, re)) {
+                continue;
+            }
+            std::ifstream f((entry.path() / "cpulist").string());
+            std::string line;
+            if (!f || !std::getline(f, line)) {
+                continue;
+            }
+            auto cpus = parse_cpu_list(line);
+            if (!cpus.empty()) {
+                nodes.emplace_back(std::stoi(match[1]), std::move(cpus));
+            }
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    std::vector<std::vector<int>> result;
+    for (auto& [node, cpus] : nodes) {
+        result.push_back(std::move(cpus));
+    }
+    if (result.empty()) {
+        // Fallback to a single node containing all cpus
+        std::vector<int> cpus(std::thread::hardware_concurrency());
+        std::iota(cpus.begin(), cpus.end(), 0);
+        result.push_back(std::move(cpus));
+    }
+    return result;
+}
+
+// Pin the current thread to the given set of cpus
+bool pin_current_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: parallel::openmp
+
+   OpenMP-based parallel context.
+
+   :param int num_threads: Number of threads. If the value is zero or negative,
+                           the number is relative to the number of logical cores.
+   :param int progress_update_interval: Number of samples per progress update.
+   :param str affinity: Thread affinity mode (Linux only).
+                        ``none`` (default) does not pin the threads.
+                        ``compact`` pins the threads to the cores filling a NUMA node first.
+                        ``scatter`` pins the threads distributing over NUMA nodes.
+\endrst
+*/
 class ParallelContext_OpenMP final : public ParallelContext {
 private:
     long long progress_update_interval_;	// Number of samples per progress update
     int num_threads_;					// Number of threads
+    Affinity affinity_;                 // Thread affinity mode
+    std::vector<std::vector<int>> numa_cpus_;           // CPUs for each NUMA node
+    std::vector<std::pair<int, int>> thread_cpus_;      // Pair of NUMA node and CPU for each thread
 
 public:
     virtual void construct(const Json& prop) override {
@@ -27,6 +135,57 @@ public:
             num_threads_ = std::thread::hardware_concurrency() + num_threads_;
         }
         omp_set_num_threads(num_threads_);
+
+        // Thread affinity
+        const auto affinity = json::value<std::string>(prop, "affinity", "none");
+        if (affinity == "none") {
+            affinity_ = Affinity::None;
+        }
+        else if (affinity == "compact") {
+            affinity_ = Affinity::Compact;
+        }
+        else if (affinity == "scatter") {
+            affinity_ = Affinity::Scatter;
+        }
+        else {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid affinity mode [affinity='{}']", affinity);
+        }
+        #if LM_PLATFORM_LINUX
+        if (affinity_ != Affinity::None) {
+            numa_cpus_ = numa_topology();
+            const int num_nodes = int(numa_cpus_.size());
+            std::vector<std::pair<int, int>> order;
+            if (affinity_ == Affinity::Compact) {
+                for (int node = 0; node < num_nodes; node++) {
+                    for (int cpu : numa_cpus_[node]) {
+                        order.emplace_back(node, cpu);
+                    }
+                }
+            }
+            else {
+                size_t max_cpus = 0;
+                for (const auto& cpus : numa_cpus_) {
+                    max_cpus = std::max(max_cpus, cpus.size());
+                }
+                for (size_t i = 0; i < max_cpus; i++) {
+                    for (int node = 0; node < num_nodes; node++) {
+                        if (i < numa_cpus_[node].size()) {
+                            order.emplace_back(node, numa_cpus_[node][i]);
+                        }
+                    }
+                }
+            }
+            thread_cpus_.resize(num_threads_);
+            for (int i = 0; i < num_threads_; i++) {
+                thread_cpus_[i] = order[i % order.size()];
+            }
+        }
+        #else
+        if (affinity_ != Affinity::None) {
+            LM_WARN("Thread affinity is only supported in Linux [affinity='{}']", affinity);
+            affinity_ = Affinity::None;
+        }
+        #endif
     }
 
     virtual int num_threads() const override {
@@ -37,20 +196,66 @@ public:
         return omp_get_thread_num() == 0;
     }
 
-    virtual void foreach(long long numSamples, const ParallelProcessFunc& processFunc, const ProgressUpdateFunc& progressUpdateFunc) const override {
+    virtual int num_numa_nodes() const override {
+        return numa_cpus_.empty() ? 1 : int(numa_cpus_.size());
+    }
+
+    virtual int numa_node() const override {
+        return current_numa_node;
+    }
+
+    virtual void foreach_numa_node(const NumaNodeFunc& func) const override {
+        if (numa_cpus_.empty()) {
+            func(0);
+            return;
+        }
+        #if LM_PLATFORM_LINUX
+        // Execute the function in a thread pinned to each node
+        std::exception_ptr exp;
+        std::mutex explock;
+        std::vector<std::thread> threads;
+        for (int node = 0; node < int(numa_cpus_.size()); node++) {
+            threads.emplace_back([&, node]() {
+                try {
+                    pin_current_thread(numa_cpus_[node]);
+                    current_numa_node = node;
+                    func(node);
+                }
+                catch (...) {
+                    std::unique_lock<std::mutex> lock(explock);
+                    exp = std::current_exception();
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        if (exp) {
+            std::rethrow_exception(exp);
+        }
+        #endif
+    }
+
+    virtual long long foreach(long long numSamples, const ParallelProcessFunc& processFunc, const ProgressUpdateFunc& progressUpdateFunc, const CancelToken* token) const override {
         // Captured exceptions inside the parallel loop
-        std::atomic<bool> done = false;
+        std::atomic<bool> done = token && token->cancelled();
         std::exception_ptr exp;
         std::mutex explock;
 
-        // Execute parallel loop
+        // Execute parallel loop.
+        // Each thread fetches the next index from the shared counter
+        // so that the threads can leave the loop immediately on cancellation,
+        // instead of spinning over the remaining iterations.
+        ScopedCallerAffinity caller_affinity_(affinity_);
+        std::atomic<long long> next = 0;
         std::atomic<long long> processed = 0;
-        #pragma omp parallel for schedule(dynamic, 1)
-        for (long long i = 0; i < numSamples; i++) {
-            // Spin the loop if cancellation is requested
-            if (done) {
-                continue;
-            }
+        // The number of threads is specified explicitly because omp_set_num_threads() in construct()
+        // only affects the calling thread, and the loop can be dispatched from other threads,
+        // e.g., the thread of the asynchronous rendering.
+        #pragma omp parallel num_threads(num_threads_)
+        {
+            const int thread_id = omp_get_thread_num();
+            long long count = 0;
 
             // OpenMP prohibits to throw exception inside parallel region
             // and to catch in the outer context.
@@ -60,28 +265,30 @@ public:
             // the dynamic extent of the same structured block, and it must be caught by the
             // same thread that threw the exception.
             try {
-                const int thread_id = omp_get_thread_num();
-
-                #if LM_PLATFORM_WINDOWS
-                // Set process group
-                GROUP_AFFINITY mask;
-                if (GetNumaNodeProcessorMaskEx(thread_id % 2, &mask)) {
-                    SetThreadGroupAffinity(GetCurrentThread(), &mask, nullptr);
-                }
-                #endif
+                set_affinity(thread_id);
+                while (!done) {
+                    const long long i = next++;
+                    if (i >= numSamples) {
+                        break;
+                    }
 
-                // Dispatch user-defined process
-                processFunc(i, thread_id);
+                    // Dispatch user-defined process
+                    processFunc(i, thread_id);
 
-                // Update processed number of samples
-                if (thread_local long long count = 0; ++count >= progress_update_interval_) {
-                    processed += count;
-                    count = 0;
-                }
+                    // Update processed number of samples.
+                    // Cancellation is checked with the same granularity.
+                    if (++count >= progress_update_interval_) {
+                        processed += count;
+                        count = 0;
+                        if (token && token->cancelled()) {
+                            done = true;
+                        }
+                    }
 
-                // Update progress
-                if (thread_id == 0) {
-                    progressUpdateFunc(processed);
+                    // Update progress
+                    if (thread_id == 0) {
+                        progressUpdateFunc(processed);
+                    }
                 }
             }
             catch (...) {
@@ -91,13 +298,130 @@ public:
                 exp = std::current_exception();
                 done = true;
             }
+            processed += count;
         }
         
         // Rethrow exception if available
         if (exp) {
             std::rethrow_exception(exp);
         }
+
+        return processed;
     }
+
+    virtual long long foreach_range(long long num_samples, long long grain, const ParallelProcessRangeFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token) const override {
+        grain = std::max(1LL, grain);
+        const long long num_ranges = (num_samples + grain - 1) / grain;
+
+        // Captured exceptions inside the parallel loop
+        std::atomic<bool> done = false;
+        std::exception_ptr exp;
+        std::mutex explock;
+
+        // Execute parallel loop over the ranges
+        ScopedCallerAffinity caller_affinity_(affinity_);
+        std::atomic<long long> next = 0;
+        std::atomic<long long> processed = 0;
+        #pragma omp parallel num_threads(num_threads_)
+        {
+            const int thread_id = omp_get_thread_num();
+            try {
+                set_affinity(thread_id);
+                while (!done) {
+                    // Check cancellation before dispatching each range
+                    if (token && token->cancelled()) {
+                        done = true;
+                        break;
+                    }
+                    const long long range_index = next++;
+                    if (range_index >= num_ranges) {
+                        break;
+                    }
+
+                    // Dispatch user-defined process for the range
+                    const long long begin = range_index * grain;
+                    const long long end = std::min(begin + grain, num_samples);
+                    process_func(begin, end, thread_id);
+
+                    // Each range is large enough to update the counter every time
+                    processed += end - begin;
+                    if (thread_id == 0) {
+                        progress_func(processed);
+                    }
+                }
+            }
+            catch (...) {
+                std::unique_lock<std::mutex> lock(explock);
+                exp = std::current_exception();
+                done = true;
+            }
+        }
+
+        if (exp) {
+            std::rethrow_exception(exp);
+        }
+
+        return processed;
+    }
+
+private:
+    // Set thread affinity of the current thread
+    void set_affinity(int thread_id) const {
+        #if LM_PLATFORM_WINDOWS
+        // Set process group
+        GROUP_AFFINITY mask;
+        if (GetNumaNodeProcessorMaskEx(thread_id % 2, &mask)) {
+            SetThreadGroupAffinity(GetCurrentThread(), &mask, nullptr);
+        }
+        #elif LM_PLATFORM_LINUX
+        if (affinity_ == Affinity::None) {
+            return;
+        }
+        // Pin the thread only when the assignment changes,
+        // because the thread pool is reused among parallel loops.
+        const auto [node, cpu] = thread_cpus_[thread_id % thread_cpus_.size()];
+        if (current_cpu == cpu) {
+            return;
+        }
+        if (pin_current_thread({ cpu })) {
+            current_cpu = cpu;
+            current_numa_node = node;
+        }
+        #else
+        LM_UNUSED(thread_id);
+        #endif
+    }
+
+    // Restores the affinity of the calling thread after the parallel loop.
+    // The calling thread takes part in the loop as the master thread,
+    // and leaving it pinned would restrict the threads it creates afterwards.
+    class ScopedCallerAffinity {
+    private:
+        bool enabled_;
+        #if LM_PLATFORM_LINUX
+        cpu_set_t mask_;
+        #endif
+
+    public:
+        ScopedCallerAffinity(Affinity affinity) {
+            enabled_ = affinity != Affinity::None;
+            #if LM_PLATFORM_LINUX
+            if (enabled_) {
+                enabled_ = pthread_getaffinity_np(pthread_self(), sizeof(mask_), &mask_) == 0;
+            }
+            #endif
+        }
+        ~ScopedCallerAffinity() {
+            #if LM_PLATFORM_LINUX
+            if (enabled_ && current_cpu >= 0) {
+                pthread_setaffinity_np(pthread_self(), sizeof(mask_), &mask_);
+                current_cpu = -1;
+                current_numa_node = 0;
+            }
+            #endif
+        }
+        LM_DISABLE_COPY_AND_MOVE(ScopedCallerAffinity)
+    };
 };
 
 LM_COMP_REG_IMPL(ParallelContext_OpenMP, "parallel::openmp");
@@ -0,0 +1,124 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/parallelcontext.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::parallel)
+
+namespace {
+
+// Index of the current thread in the parallel loop. The calling thread is 0.
+thread_local int current_thread_id = 0;
+
+}
+
+/*
+\rst
+.. function:: parallel::threads
+
+   Parallel context based on the threads of the standard library.
+
+   :param int num_threads: Number of threads. If the value is zero or negative,
+                           the number is relative to the number of logical cores.
+   :param int progress_update_interval: Number of samples per progress update.
+
+   The threads are created for each parallel loop and the calling thread takes part in the loop.
+   Unlike :func:`parallel::openmp`, this context does not depend on the state of a runtime library,
+   so that it can be used in a process forked after the parallel loops of the parent process,
+   e.g., in the workers of :func:`renderer::fork`.
+\endrst
+*/
+class ParallelContext_Threads final : public ParallelContext {
+private:
+    long long progress_update_interval_;    // Number of samples per progress update
+    int num_threads_;                       // Number of threads
+
+public:
+    virtual void construct(const Json& prop) override {
+        progress_update_interval_ = json::value<long long>(prop, "progress_update_interval", 100);
+        num_threads_ = json::value(prop, "num_threads", std::thread::hardware_concurrency());
+        if (num_threads_ <= 0) {
+            num_threads_ = std::thread::hardware_concurrency() + num_threads_;
+        }
+        num_threads_ = std::max(1, num_threads_);
+    }
+
+    virtual int num_threads() const override {
+        return num_threads_;
+    }
+
+    virtual bool main_thread() const override {
+        return current_thread_id == 0;
+    }
+
+    virtual long long foreach(long long num_samples, const ParallelProcessFunc& process_func, const ProgressUpdateFunc& progress_func, const CancelToken* token) const override {
+        // Captured exceptions inside the parallel loop
+        std::atomic<bool> done = token && token->cancelled();
+        std::exception_ptr exp;
+        std::mutex explock;
+
+        // Each thread fetches the next index from the shared counter
+        std::atomic<long long> next = 0;
+        std::atomic<long long> processed = 0;
+        const auto worker = [&](int thread_id) {
+            current_thread_id = thread_id;
+            long long count = 0;
+            try {
+                while (!done) {
+                    const long long i = next++;
+                    if (i >= num_samples) {
+                        break;
+                    }
+                    process_func(i, thread_id);
+
+                    // Update processed number of samples.
+                    // Cancellation is checked with the same granularity.
+                    if (++count >= progress_update_interval_) {
+                        processed += count;
+                        count = 0;
+                        if (token && token->cancelled()) {
+                            done = true;
+                        }
+                    }
+
+                    // Update progress
+                    if (thread_id == 0) {
+                        progress_func(processed);
+                    }
+                }
+            }
+            catch (...) {
+                std::unique_lock<std::mutex> lock(explock);
+                exp = std::current_exception();
+                done = true;
+            }
+            processed += count;
+        };
+
+        // Execute parallel loop
+        std::vector<std::thread> threads;
+        for (int thread_id = 1; thread_id < num_threads_; thread_id++) {
+            threads.emplace_back(worker, thread_id);
+        }
+        worker(0);
+        for (auto& th : threads) {
+            th.join();
+        }
+        current_thread_id = 0;
+
+        // Rethrow exception if available
+        if (exp) {
+            std::rethrow_exception(exp);
+        }
+
+        return processed;
+    }
+};
+
+LM_COMP_REG_IMPL(ParallelContext_Threads, "parallel::threads");
+
+LM_NAMESPACE_END(LM_NAMESPACE::parallel)
@@ -181,6 +181,21 @@ LM_COMP_REG_IMPL(ProgressContext_Default, "progress::default");
 
 using Instance = comp::detail::ContextInstance<ProgressContext>;
 
+namespace {
+
+// State of the latest progress report.
+// Kept independently of the context to query the ratio from other threads.
+struct State {
+    std::atomic<ProgressMode> mode = ProgressMode::Samples;
+    std::atomic<long long> total = 0;
+    std::atomic<long long> processed = 0;
+    std::atomic<double> total_time = 0;
+    std::atomic<double> elapsed = 0;
+};
+State state_;
+
+}
+
 LM_PUBLIC_API void init(const std::string& type, const Json& prop) {
     Instance::init("progress::" + type, prop);
 }
@@ -190,14 +205,21 @@ LM_PUBLIC_API void shutdown() {
 }
 
 LM_PUBLIC_API void start(ProgressMode mode, long long total, double totalTime) {
+    state_.mode = mode;
+    state_.total = total;
+    state_.total_time = totalTime;
+    state_.processed = 0;
+    state_.elapsed = 0;
     Instance::get().start(mode, total, totalTime);
 }
 
 LM_PUBLIC_API void update(long long processed) {
+    state_.processed = processed;
     Instance::get().update(processed);
 }
 
 LM_PUBLIC_API void update_time(Float elapsed) {
+    state_.elapsed = elapsed;
     Instance::get().update_time(elapsed);
 }
 
@@ -205,4 +227,11 @@ LM_PUBLIC_API void end() {
     Instance::get().end();
 }
 
+LM_PUBLIC_API double ratio() {
+    const double r = state_.mode == ProgressMode::Samples
+        ? (state_.total > 0 ? double(state_.processed) / state_.total : 0)
+        : (state_.total_time > 0 ? state_.elapsed / state_.total_time : 0);
+    return std::clamp(r, 0.0, 1.0);
+}
+
 LM_NAMESPACE_END(LM_NAMESPACE::progress)
@@ -79,6 +79,7 @@ static void bind_math(pybind11::module& m) {
     pybind11::class_<Rng>(m, "Rng")
         .def(pybind11::init<>())
         .def(pybind11::init<int>())
+        .def(pybind11::init<unsigned int, long long, long long>())
         .def("u", &Rng::u);
 
     // Helper functions
@@ -115,6 +116,30 @@ static void bind_math(pybind11::module& m) {
 
 // ------------------------------------------------------------------------------------------------
 
+// Bind json.h
+static void bind_json(pybind11::module& m) {
+    // Buffer
+    pybind11::class_<PyBuffer>(m, "Buffer");
+    m.def("buffer", [](pybind11::array a) -> PyBuffer {
+        // Non-contiguous array is copied into a contiguous array
+        a = pybind11::array::ensure(a, pybind11::array::c_style);
+        const auto kind = a.dtype().kind();
+        const auto itemsize = a.itemsize();
+        const auto type = [&]() -> std::string {
+            if (kind == 'f' && itemsize == 4) { return "float32"; }
+            if (kind == 'f' && itemsize == 8) { return "float64"; }
+            if (kind == 'i' && itemsize == 4) { return "int32"; }
+            if (kind == 'i' && itemsize == 8) { return "int64"; }
+            if (kind == 'u' && itemsize == 4) { return "uint32"; }
+            if (kind == 'u' && itemsize == 8) { return "uint64"; }
+            LM_THROW_EXCEPTION(Error::Unsupported, "Unsupported element type of buffer [kind='{}', itemsize={}]", kind, itemsize);
+        }();
+        return { a, type };
+    });
+}
+
+// ------------------------------------------------------------------------------------------------
+
 // Bind component.h
 static void bind_component(pybind11::module& m) {
     class Component_Py final : public Component {
@@ -135,6 +160,8 @@ static void bind_component(pybind11::module& m) {
         .def("save", [](Component* self) -> pybind11::bytes {
             std::ostringstream os;
             {
+                // Release GIL during serialization
+                pybind11::gil_scoped_release release;
                 OutputArchive ar(os);
                 self->save(ar);
             }
@@ -142,13 +169,14 @@ static void bind_component(pybind11::module& m) {
         })
         .def("load", [](Component* self, pybind11::bytes data) {
             std::istringstream is(data);
+            pybind11::gil_scoped_release release;
             InputArchive ar(is);
             self->load(ar);
         })
         .def("save_to_file", [](Component* self, const std::string& path) {
             std::ofstream os(path, std::ios::out | std::ios::binary);
             serial::save_comp_owned(os, self, self->loc());
-        })
+        }, pybind11::call_guard<pybind11::gil_scoped_release>())
         .PYLM_DEF_COMP_BIND(Component);
 
     auto sm = m.def_submodule("comp");
@@ -170,7 +198,8 @@ static void bind_component(pybind11::module& m) {
 		[](const std::string& name, const std::string& impl_key, const Json& prop) -> InterfaceType* { \
 			auto* p = assets()->load_asset(name, fmt::format("{}::{}", #interface_name, impl_key), prop); \
 			return dynamic_cast<InterfaceType*>(p); \
-		}, pybind11::return_value_policy::reference); \
+		}, pybind11::return_value_policy::reference, \
+        pybind11::call_guard<pybind11::gil_scoped_release>()); \
     m.def(fmt::format("get_{}", #interface_name).c_str(), \
         [](const std::string& loc) -> InterfaceType* { \
             return comp::get<InterfaceType>(loc); \
@@ -183,16 +212,20 @@ static void bind_user(pybind11::module& m) {
     m.def("reset", &reset);
     m.def("info", &info);
     m.def("assets", &assets, pybind11::return_value_policy::reference);
-    m.def("save_state_to_file", &save_state_to_file);
-    m.def("load_state_from_file", &load_state_from_file);
+
+    // Release GIL during long-running functions.
+    // Components implemented in Python reacquire GIL when they are called.
+    using release_gil = pybind11::call_guard<pybind11::gil_scoped_release>;
+    m.def("save_state_to_file", &save_state_to_file, release_gil());
+    m.def("load_state_from_file", &load_state_from_file, release_gil());
 
     // Expose some function in comp namespace to lm namespace
     m.def("load", [](const std::string& name, const std::string& impl_key, const Json& prop) -> Component* {
         return assets()->load_asset(name, impl_key, prop);
-    }, pybind11::return_value_policy::reference);
+    }, pybind11::return_value_policy::reference, release_gil());
     m.def("load_serialized", [](const std::string& name, const std::string& path) -> Component* {
         return assets()->load_serialized(name, path);
-    }, pybind11::return_value_policy::reference);
+    }, pybind11::return_value_policy::reference, release_gil());
     m.def("get", [](const std::string& loc) -> Component* {
         return comp::detail::get(loc);
     }, pybind11::return_value_policy::reference);
@@ -212,6 +245,7 @@ static void bind_user(pybind11::module& m) {
     PYLM_DEF_ASSET_CREATE_AND_GET_FUNC(m, Accel, accel);
     PYLM_DEF_ASSET_CREATE_AND_GET_FUNC(m, Scene, scene);
     PYLM_DEF_ASSET_CREATE_AND_GET_FUNC(m, Renderer, renderer);
+    PYLM_DEF_ASSET_CREATE_AND_GET_FUNC(m, Denoiser, denoiser);
 
     // Helper function to visualize the asset tree
     m.def("print_asset_tree", []() {
@@ -248,7 +282,8 @@ static void bind_user(pybind11::module& m) {
         [](AssetGroup& self, const std::string& name, const std::string& impl_key, const Json& prop) -> InterfaceType* { \
             auto* p = self.load_asset(name, fmt::format("{}::{}", #interface_name, impl_key), prop); \
             return dynamic_cast<InterfaceType*>(p); \
-        }, pybind11::return_value_policy::reference)
+        }, pybind11::return_value_policy::reference, \
+        pybind11::call_guard<pybind11::gil_scoped_release>())
 
 // Bind assetgroup.h
 static void bind_asset_group(pybind11::module& m) {
@@ -262,11 +297,21 @@ static void bind_asset_group(pybind11::module& m) {
         virtual Component* load_serialized(const std::string& name, const std::string& path) override {
             PYBIND11_OVERLOAD_PURE(Component*, AssetGroup, load_serialized, name, path);
         }
+        virtual void save_sections(const std::string& path) override {
+            PYBIND11_OVERLOAD_PURE(void, AssetGroup, save_sections, path);
+        }
+        virtual void load_sections(const std::string& path) override {
+            PYBIND11_OVERLOAD_PURE(void, AssetGroup, load_sections, path);
+        }
     };
     pybind11::class_<AssetGroup, AssetGroup_Py, Component, Component::Ptr<AssetGroup>>(m, "AssetGroup")
         .def(pybind11::init<>())
-        .def("load_asset", &AssetGroup::load_asset, pybind11::return_value_policy::reference)
-        .def("load_serialized", &AssetGroup::load_serialized, pybind11::return_value_policy::reference)
+        .def("load_asset", &AssetGroup::load_asset, pybind11::return_value_policy::reference,
+            pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("load_serialized", &AssetGroup::load_serialized, pybind11::return_value_policy::reference,
+            pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("save_sections", &AssetGroup::save_sections, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("load_sections", &AssetGroup::load_sections, pybind11::call_guard<pybind11::gil_scoped_release>())
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Mesh, mesh)
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Texture, texture)
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Material, material)
@@ -280,7 +325,8 @@ static void bind_asset_group(pybind11::module& m) {
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(AssetGroup, asset_group)
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Accel, accel)
         .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Scene, scene)
-        .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Renderer, renderer);
+        .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Renderer, renderer)
+        .PYLM_DEF_ASSET_CREATE_MEMBER_FUNC(Denoiser, denoiser);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -348,6 +394,27 @@ static void bind_parallel(pybind11::module& m) {
             processFunc(index, threadId);
         });
     });
+    sm.def("foreach_range", [](long long num_samples, long long grain, const parallel::ParallelProcessRangeFunc& process_func) {
+        pybind11::gil_scoped_release release;
+        parallel::foreach_range(num_samples, grain, [&](long long begin, long long end, int threadid) {
+            pybind11::gil_scoped_acquire acquire;
+            process_func(begin, end, threadid);
+        });
+    });
+
+    // Global cancellation token
+    sm.def("cancel", []() {
+        parallel::cancel_token().cancel();
+    });
+    sm.def("set_timeout", [](double seconds) {
+        parallel::cancel_token().set_timeout(seconds);
+    });
+    sm.def("reset_cancel", []() {
+        parallel::cancel_token().reset();
+    });
+    sm.def("cancelled", []() {
+        return parallel::cancel_token().cancelled();
+    });
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -444,9 +511,9 @@ static void bind_film(pybind11::module& m) {
                 sizeof(Float),
                 pybind11::format_descriptor<Float>::format(),
                 3,
-                { buf.h, buf.w, 3 },
-                { 3 * buf.w * sizeof(Float),
-                  3 * sizeof(Float),
+                { buf.h, buf.w, buf.c },
+                { buf.c * buf.w * sizeof(Float),
+                  buf.c * sizeof(Float),
                   sizeof(Float) }
             );
         });
@@ -487,6 +554,24 @@ static void bind_film(pybind11::module& m) {
         virtual void clear() override {
             PYBIND11_OVERLOAD_PURE(void, Film, clear);
         }
+        virtual Float weight() const override {
+            PYBIND11_OVERLOAD(Float, Film, weight);
+        }
+        virtual void add_weight(Float w) override {
+            PYBIND11_OVERLOAD(void, Film, add_weight, w);
+        }
+        virtual int add_aov(const std::string& name, int components) override {
+            PYBIND11_OVERLOAD(int, Film, add_aov, name, components);
+        }
+        virtual int aov_index(const std::string& name) const override {
+            PYBIND11_OVERLOAD(int, Film, aov_index, name);
+        }
+        virtual void splat_aov(int index, int x, int y, Vec3 v) override {
+            PYBIND11_OVERLOAD(void, Film, splat_aov, index, x, y, v);
+        }
+        virtual FilmBuffer aov_buffer(int index) override {
+            PYBIND11_OVERLOAD(FilmBuffer, Film, aov_buffer, index);
+        }
     };
     pybind11::class_<Film, Film_Py, Component, Component::Ptr<Film>>(m, "Film")
         .def(pybind11::init<>())
@@ -494,9 +579,16 @@ static void bind_film(pybind11::module& m) {
         .def("size", &Film::size)
         .def("num_pixels", &Film::num_pixels)
         .def("set_pixel", &Film::set_pixel)
-        .def("save", &Film::save)
+        .def("save", &Film::save, pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("aspect_ratio", &Film::aspect_ratio)
         .def("buffer", &Film::buffer)
+        .def("clear", &Film::clear)
+        .def("weight", &Film::weight)
+        .def("add_weight", &Film::add_weight)
+        .def("add_aov", &Film::add_aov)
+        .def("aov_index", &Film::aov_index)
+        .def("splat_aov", (void (Film::*)(int, int, int, Vec3))&Film::splat_aov)
+        .def("aov_buffer", &Film::aov_buffer)
         .PYLM_DEF_COMP_BIND(Film);
 }
 
@@ -514,6 +606,7 @@ static void bind_surface(pybind11::module& m) {
         .def_readwrite("t", &PointGeometry::t)
         .def_readwrite("u", &PointGeometry::u)
         .def_readwrite("v", &PointGeometry::v)
+        .def_readwrite("t_footprint", &PointGeometry::t_footprint)
         .def_static("make_degenerated", &PointGeometry::make_degenerated)
         .def_static("make_infinite", &PointGeometry::make_infinite)
         .def_static("make_on_surface", (PointGeometry(*)(Vec3, Vec3, Vec2))&PointGeometry::make_on_surface)
@@ -626,11 +719,11 @@ static void bind_scene(pybind11::module& m) {
 		virtual bool is_specular(const SceneInteraction& sp, int comp) const override {
 			PYBIND11_OVERLOAD_PURE(bool, Scene, is_specular, sp, comp);
 		}
-		virtual Ray primary_ray(Vec2 rp, Float aspect_ratio) const override {
-			PYBIND11_OVERLOAD_PURE(Ray, Scene, primary_ray, rp, aspect_ratio);
+		virtual Ray primary_ray(Vec2 rp, Float aspect_ratio, int camera) const override {
+			PYBIND11_OVERLOAD_PURE(Ray, Scene, primary_ray, rp, aspect_ratio, camera);
 		}
-		virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio) const override {
-			PYBIND11_OVERLOAD_PURE(std::optional<Vec2>, Scene, raster_position, wo, aspect_ratio);
+		virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio, int camera) const override {
+			PYBIND11_OVERLOAD_PURE(std::optional<Vec2>, Scene, raster_position, wo, aspect_ratio, camera);
 		}
 		virtual std::optional<RaySample> sample_ray(Rng& rng, const SceneInteraction& sp, Vec3 wi) const override {
 			PYBIND11_OVERLOAD_PURE(std::optional<RaySample>, Scene, sample_ray, rng, sp, wi);
@@ -687,12 +780,12 @@ static void bind_scene(pybind11::module& m) {
         .def("traverse_primitive_nodes", &Scene::traverse_primitive_nodes)
 		.def("visit_node", &Scene::visit_node)
 		.def("node_at", &Scene::node_at, pybind11::return_value_policy::reference)
-        .def("build", &Scene::build)
+        .def("build", &Scene::build, pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("intersect", &Scene::intersect, "ray"_a = Ray{}, "tmin"_a = Eps, "tmax"_a = Inf)
         .def("is_light", &Scene::is_light)
         .def("is_specular", &Scene::is_specular)
-        .def("primary_ray", &Scene::primary_ray)
-		.def("raster_position", &Scene::raster_position)
+        .def("primary_ray", &Scene::primary_ray, "rp"_a, "aspect_ratio"_a, "camera"_a = -1)
+		.def("raster_position", &Scene::raster_position, "wo"_a, "aspect_ratio"_a, "camera"_a = -1)
         .def("sample_ray", &Scene::sample_ray)
 		.def("sample_direction_given_comp", &Scene::sample_direction_given_comp)
 		.def("sample_direct_light", &Scene::sample_direct_light)
@@ -731,13 +824,23 @@ static void bind_accel(pybind11::module& m) {
     };
     pybind11::class_<Accel, Accel_Py, Component, Component::Ptr<Accel>>(m, "Accel")
         .def(pybind11::init<>())
-        .def("build", &Accel::build)
+        .def("build", &Accel::build, pybind11::call_guard<pybind11::gil_scoped_release>())
         .def("intersect", &Accel::intersect)
         .PYLM_DEF_COMP_BIND(Accel);
 }
 
 // ------------------------------------------------------------------------------------------------
 
+// Deleter of RenderJob.
+// Destruction waits for the completion of the rendering, which might call Python functions.
+struct RenderJobDeleter {
+    void operator()(RenderJob* p) const {
+        pybind11::gil_scoped_release release;
+        delete p;
+    }
+};
+using RenderJobPtr = std::unique_ptr<RenderJob, RenderJobDeleter>;
+
 // Bind renderer.h
 static void bind_renderer(pybind11::module& m) {
     class Renderer_Py final : public Renderer {
@@ -751,8 +854,40 @@ static void bind_renderer(pybind11::module& m) {
     };
     pybind11::class_<Renderer, Renderer_Py, Component, Component::Ptr<Renderer>>(m, "Renderer")
         .def(pybind11::init<>())
-        .def("render", &Renderer::render)
+        .def("render", &Renderer::render, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("render_async", [](const Renderer* self) {
+            return RenderJobPtr(render_async(self).release());
+        }, pybind11::keep_alive<0, 1>())
         .PYLM_DEF_COMP_BIND(Renderer);
+
+    // Asynchronous rendering
+    pybind11::class_<RenderJob, RenderJobPtr>(m, "RenderJob")
+        .def("wait", &RenderJob::wait, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("poll", &RenderJob::poll)
+        .def("cancel", &RenderJob::cancel)
+        .def("progress", &RenderJob::progress);
+    m.def("render_async", [](const Renderer* renderer) {
+        return RenderJobPtr(render_async(renderer).release());
+    }, pybind11::keep_alive<0, 1>());
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Bind denoiser.h
+static void bind_denoiser(pybind11::module& m) {
+    class Denoiser_Py final : public Denoiser {
+        PYLM_SERIALIZE_IMPL(Denoiser);
+        virtual void construct(const Json& prop) override {
+            PYBIND11_OVERLOAD(void, Denoiser, construct, prop);
+        }
+        virtual void denoise(Film* input, Film* output) const override {
+            PYBIND11_OVERLOAD_PURE(void, Denoiser, denoise, input, output);
+        }
+    };
+    pybind11::class_<Denoiser, Denoiser_Py, Component, Component::Ptr<Denoiser>>(m, "Denoiser")
+        .def(pybind11::init<>())
+        .def("denoise", &Denoiser::denoise, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .PYLM_DEF_COMP_BIND(Denoiser);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -772,6 +907,9 @@ static void bind_texture(pybind11::module& m) {
         virtual Vec3 eval(Vec2 t) const override {
             PYBIND11_OVERLOAD_PURE(Vec3, Texture, eval, t);
         }
+        virtual Vec3 eval_filtered(Vec2 t, Float footprint) const override {
+            PYBIND11_OVERLOAD(Vec3, Texture, eval_filtered, t, footprint);
+        }
         virtual Vec3 eval_by_pixel_coords(int x, int y) const override {
             PYBIND11_OVERLOAD_PURE(Vec3, Texture, eval_by_pixel_coords, x, y);
         }
@@ -780,8 +918,14 @@ static void bind_texture(pybind11::module& m) {
         .def(pybind11::init<>())
         .def("size", &Texture::size)
         .def("eval", &Texture::eval)
+        .def("eval_filtered", &Texture::eval_filtered)
         .def("eval_by_pixel_coords", &Texture::eval_by_pixel_coords)
         .PYLM_DEF_COMP_BIND(Texture);
+
+    auto sm = m.def_submodule("texture");
+    sm.def("save_tiled", &texture::save_tiled, "texture"_a, "path"_a, "tile_size"_a = 64);
+    sm.def("set_tile_cache_budget", &texture::set_tile_cache_budget);
+    sm.def("tile_cache_size", &texture::tile_cache_size);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -822,6 +966,9 @@ static void bind_mesh(pybind11::module& m) {
         .def("surface_point", &Mesh::surface_point)
         .def("num_triangles", &Mesh::num_triangles)
         .PYLM_DEF_COMP_BIND(Mesh);
+
+    auto sm = m.def_submodule("mesh");
+    sm.def("save_binary", &mesh::save_binary);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -1105,6 +1252,7 @@ PYBIND11_MODULE(pylm, m) {
     bind_exception(m);
     bind_version(m);
     bind_math(m);
+    bind_json(m);
     bind_component(m);
     bind_logger(m);
     bind_parallel(m);
@@ -1117,6 +1265,7 @@ PYBIND11_MODULE(pylm, m) {
     bind_scene(m);
     bind_accel(m);
     bind_renderer(m);
+    bind_denoiser(m);
     bind_texture(m);
     bind_mesh(m);
     bind_material(m);
@@ -0,0 +1,93 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/renderer.h>
+#include <lm/parallel.h>
+#include <lm/progress.h>
+#include <lm/exception.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// True if an asynchronous rendering is running
+std::atomic<bool> running_ = false;
+
+// Asynchronous rendering dispatched in a background thread
+class RenderJob_Thread final : public RenderJob {
+private:
+    std::thread thread_;
+    std::atomic<bool> done_ = false;    // True if the rendering is completed
+    std::exception_ptr exp_;            // Exception thrown during the rendering
+
+public:
+    RenderJob_Thread(const Renderer* renderer) {
+        thread_ = std::thread([this, renderer]() {
+            try {
+                renderer->render();
+            }
+            catch (...) {
+                exp_ = std::current_exception();
+            }
+            running_ = false;
+            done_ = true;
+        });
+    }
+
+    ~RenderJob_Thread() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    LM_DISABLE_COPY_AND_MOVE(RenderJob_Thread)
+
+public:
+    virtual void wait() override {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (exp_) {
+            // Rethrow only once
+            auto exp = exp_;
+            exp_ = nullptr;
+            std::rethrow_exception(exp);
+        }
+    }
+
+    virtual bool poll() const override {
+        return done_;
+    }
+
+    virtual void cancel() override {
+        parallel::cancel_token().cancel();
+    }
+
+    virtual double progress() const override {
+        return done_ ? 1 : progress::ratio();
+    }
+};
+
+}
+
+LM_PUBLIC_API std::unique_ptr<RenderJob> render_async(const Renderer* renderer) {
+    if (!renderer) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Renderer is null");
+    }
+    if (running_.exchange(true)) {
+        LM_THROW_EXCEPTION(Error::Unsupported, "Another rendering is running asynchronously");
+    }
+    parallel::cancel_token().reset();
+    try {
+        return std::make_unique<RenderJob_Thread>(renderer);
+    }
+    catch (...) {
+        running_ = false;
+        throw;
+    }
+}
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -0,0 +1,218 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/scheduler.h>
+#include <lm/parallel.h>
+#include <lm/serial.h>
+#if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Header of the shared memory region of a worker
+struct WorkerSlot {
+    int status;         // 0: not finished, 1: succeeded, 2: failed
+    long long size;     // Size of the serialized film
+};
+
+// Serialize the state of the film
+std::string serialize_film(Film* film) {
+    std::ostringstream os;
+    {
+        OutputArchive ar(os, film->loc());
+        film->save(ar);
+    }
+    return os.str();
+}
+
+}
+
+/*
+\rst
+.. function:: renderer::fork
+
+   Multi-process renderer.
+
+   :param str renderer: Locator of the renderer to dispatch.
+   :param str output: Locator of the output film of the renderer.
+   :param int num_processes: Number of worker processes. Default is 2.
+   :param int num_threads: Number of threads per worker.
+                           Default is the number of logical cores divided by the number of workers.
+
+   This renderer dispatches the given renderer in multiple worker processes in a single host
+   for fault isolation (Linux and macOS only).
+   The workers are forked from the calling process on :cpp:func:`lm::Renderer::render`,
+   so the scene must be loaded and built beforehand and the workers share
+   the memory of the scene with copy-on-write.
+   Each worker renders a disjoint partition of the pixels (or of the samples in the image space sample mode)
+   with :cpp:func:`lm::scheduler::set_partition`,
+   and writes the state of the film to a shared memory region.
+   After all workers finished, the results are merged into the output film with :cpp:func:`lm::Film::accum`.
+   The rendered image is the same as the one rendered in a single process up to floating point errors,
+   if the renderer processes the pixels with a sample-based scheduler.
+   Progressive accumulation to the previous result is not supported.
+   Denoising should be applied after the merge, not in the workers.
+   The workers use :func:`parallel::threads` with ``num_threads`` threads,
+   because the OpenMP runtime used by the calling process is not safe to use after fork.
+   If the renderer writes checkpoints, each worker writes to the path suffixed by the partition index.
+\endrst
+*/
+class Renderer_Fork final : public Renderer {
+private:
+    Renderer* renderer_;
+    Film* film_;
+    int num_processes_;
+    int num_threads_;       // Number of threads per worker
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(renderer_, film_, num_processes_, num_threads_);
+    }
+
+    virtual void foreach_underlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, renderer_);
+        comp::visit(visit, film_);
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        renderer_ = json::comp_ref<Renderer>(prop, "renderer");
+        film_ = json::comp_ref<Film>(prop, "output");
+        num_processes_ = json::value(prop, "num_processes", 2);
+        if (num_processes_ <= 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Number of processes must be positive [num_processes={}]", num_processes_);
+        }
+        num_threads_ = json::value(prop, "num_threads",
+            std::max(1, int(std::thread::hardware_concurrency()) / num_processes_));
+    }
+
+    virtual void render() const override {
+        #if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+        if (film_->weight() > 0_f) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Progressive accumulation is not supported with multiple processes");
+        }
+
+        // Allocate shared memory for the results of the workers.
+        // The size of the serialized film is the same for all workers.
+        const auto film_size = serialize_film(film_).size();
+        const auto stride = (sizeof(WorkerSlot) + film_size + 63) / 64 * 64;
+        const auto shm_size = stride * num_processes_;
+        auto* shm = (char*)mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shm == MAP_FAILED) {
+            LM_THROW_EXCEPTION(Error::FailedToRender, "Failed to allocate shared memory [size={}]", shm_size);
+        }
+        const std::unique_ptr<char, std::function<void(char*)>> shm_guard(shm, [shm_size](char* p) {
+            munmap(p, shm_size);
+        });
+
+        LM_INFO("Rendering with multiple processes [num_processes={}, num_threads={}]", num_processes_, num_threads_);
+        LM_INDENT();
+
+        // Fork workers.
+        // Flush the output buffers so that the buffered outputs are not duplicated in the workers.
+        std::cout.flush();
+        std::fflush(nullptr);
+        std::vector<pid_t> pids;
+        for (int i = 0; i < num_processes_; i++) {
+            const auto pid = fork();
+            if (pid < 0) {
+                LM_ERROR("Failed to fork worker [index={}]", i);
+                break;
+            }
+            if (pid == 0) {
+                run_worker(i, shm + stride * i, film_size);
+            }
+            pids.push_back(pid);
+        }
+
+        // Wait for the workers
+        for (auto pid : pids) {
+            int status;
+            waitpid(pid, &status, 0);
+        }
+
+        // Merge the results
+        film_->clear();
+        int failed = num_processes_ - int(pids.size());
+        const auto size = film_->size();
+        for (int i = 0; i < int(pids.size()); i++) {
+            const auto* slot = (const WorkerSlot*)(shm + stride * i);
+            if (slot->status != 1) {
+                LM_ERROR("Worker failed [index={}]", i);
+                failed++;
+                continue;
+            }
+            auto film = comp::create<Film>(film_->key(), make_loc("worker_film"), {
+                {"w", size.w},
+                {"h", size.h}
+            });
+            {
+                std::istringstream is(std::string(shm + stride * i + sizeof(WorkerSlot), slot->size));
+                InputArchive ar(is, film->loc());
+                film->load(ar);
+            }
+            // Normalize the accumulated values of the worker
+            if (film->weight() > 0_f) {
+                film->rescale(1_f / film->weight());
+            }
+            film_->accum(film.get());
+        }
+        if (failed > 0) {
+            LM_THROW_EXCEPTION(Error::FailedToRender, "Failed to render in workers [failed={}/{}]", failed, num_processes_);
+        }
+        #else
+        LM_THROW_EXCEPTION(Error::Unsupported, "Multi-process rendering is not supported in the platform");
+        #endif
+    }
+
+private:
+    #if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+    // Process of a worker. This function does not return.
+    [[noreturn]] void run_worker(int index, char* shm, size_t film_size) const {
+        auto* slot = (WorkerSlot*)shm;
+        slot->status = 2;
+        try {
+            // Threads of the parallel subsystem are not inherited by fork.
+            // The OpenMP runtime is not fork-safe if the parent process has used it,
+            // so the workers use the parallel subsystem independent of the runtime.
+            parallel::init("threads", {
+                {"num_threads", num_threads_}
+            });
+            scheduler::set_partition(index, num_processes_);
+            renderer_->render();
+            const auto data = serialize_film(film_);
+            if (data.size() > film_size) {
+                LM_ERROR("Serialized film exceeds the shared memory [index={}, size={}, expected={}]",
+                    index, data.size(), film_size);
+            }
+            else {
+                std::memcpy(shm + sizeof(WorkerSlot), data.data(), data.size());
+                slot->size = (long long)data.size();
+                slot->status = 1;
+            }
+        }
+        catch (const std::exception& e) {
+            LM_ERROR("Worker failed [index={}, error='{}']", index, e.what());
+        }
+        std::cout.flush();
+        std::fflush(nullptr);
+        _exit(slot->status == 1 ? 0 : 1);
+    }
+    #endif
+};
+
+LM_COMP_REG_IMPL(Renderer_Fork, "renderer::fork");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
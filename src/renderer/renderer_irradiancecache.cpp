@@ -0,0 +1,427 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/renderer.h>
+#include <lm/scene.h>
+#include <lm/mesh.h>
+#include <lm/film.h>
+#include <lm/scheduler.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+void atomic_add(std::atomic<Float>& v, Float x) {
+    auto expected = v.load(std::memory_order_relaxed);
+    while (!v.compare_exchange_weak(expected, expected + x, std::memory_order_relaxed));
+}
+
+// Hash function for 64-bit integers (finalizer of SplitMix64)
+uint64_t hash64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Sparse irradiance cache on a hashed grid.
+// A record is identified by the grid cell and the dominant axis of the normal,
+// and stored in the hash table with open addressing.
+// Records can be added and queried concurrently.
+class IrradianceCache {
+private:
+    static constexpr int MaxProbes = 16;
+    static constexpr int CoordBits = 20;
+
+    struct Entry {
+        std::atomic<uint64_t> key{0};   // Key of the record. 0 if the entry is empty.
+        std::atomic<Float> sum[3] = {}; // Sum of the irradiance estimates
+        std::atomic<Float> count{0};    // Number of the estimates
+    };
+
+    Vec3 min_;
+    Float cell_size_;
+    uint64_t mask_;
+    std::unique_ptr<Entry[]> entries_;
+
+private:
+    // Key of the cell and the normal direction
+    uint64_t key(glm::tvec3<long long> c, Vec3 n) const {
+        const long long max = (1LL << CoordBits) - 1;
+        uint64_t k = 0;
+        for (int i = 0; i < 3; i++) {
+            k |= uint64_t(glm::clamp(c[i], 0LL, max)) << (CoordBits * i);
+        }
+        // Dominant axis and its sign
+        const auto a = glm::abs(n);
+        const int axis = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+        const int dir = 2 * axis + (n[axis] < 0_f ? 1 : 0);
+        return (k | (uint64_t(dir) << (CoordBits * 3))) + 1;
+    }
+
+    // Find the entry of the key. If insert is true, the entry is created if not found.
+    Entry* find(uint64_t k, bool insert) const {
+        auto i = hash64(k) & mask_;
+        for (int probe = 0; probe < MaxProbes; probe++, i = (i + 1) & mask_) {
+            auto& e = entries_[i];
+            auto curr = e.key.load(std::memory_order_acquire);
+            if (curr == k) {
+                return &e;
+            }
+            if (curr == 0) {
+                if (!insert) {
+                    return nullptr;
+                }
+                if (e.key.compare_exchange_strong(curr, k, std::memory_order_acq_rel) || curr == k) {
+                    return &e;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    IrradianceCache(const Bound& bound, Float cell_size, int log2_size)
+        : min_(bound.min - cell_size)
+        , cell_size_(cell_size)
+        , mask_((1ULL << log2_size) - 1)
+        , entries_(new Entry[size_t(1) << log2_size])
+    {}
+
+    // Record an irradiance estimate at the point with the normal
+    void record(Vec3 p, Vec3 n, Vec3 E) {
+        const auto c = glm::tvec3<long long>(glm::floor((p - min_) / cell_size_));
+        auto* e = find(key(c, n), true);
+        if (!e) {
+            // The table is full around the slot
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            atomic_add(e->sum[i], E[i]);
+        }
+        atomic_add(e->count, 1_f);
+    }
+
+    // Query the irradiance interpolated with the records of the neighboring cells.
+    // Returns nullopt if no record is found.
+    std::optional<Vec3> lookup(Vec3 p, Vec3 n) const {
+        const auto t = (p - min_) / cell_size_ - .5_f;
+        const auto c0 = glm::floor(t);
+        const auto f = t - c0;
+        Vec3 sum(0_f);
+        Float weight_sum = 0_f;
+        for (int i = 0; i < 8; i++) {
+            const glm::tvec3<long long> o(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+            const auto* e = find(key(glm::tvec3<long long>(c0) + o, n), false);
+            if (!e) {
+                continue;
+            }
+            const auto count = e->count.load(std::memory_order_relaxed);
+            if (count == 0_f) {
+                continue;
+            }
+            // Trilinear weight
+            const auto w =
+                (o.x ? f.x : 1_f - f.x) *
+                (o.y ? f.y : 1_f - f.y) *
+                (o.z ? f.z : 1_f - f.z);
+            const Vec3 E(e->sum[0].load(), e->sum[1].load(), e->sum[2].load());
+            sum += w * E / count;
+            weight_sum += w;
+        }
+        if (weight_sum <= 0_f) {
+            return {};
+        }
+        return sum / weight_sum;
+    }
+};
+
+// Normal oriented to the side of the incident direction
+Vec3 oriented_normal(const SceneInteraction& sp, Vec3 wi) {
+    return glm::dot(sp.geom.n, wi) < 0_f ? -sp.geom.n : sp.geom.n;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Irradiance cache renderer for fast previews of diffuse interreflection.
+// The renderer first fills a sparse irradiance cache on a hashed grid
+// with short paths traced from the camera, where each non-specular vertex of the paths
+// records an estimate of the irradiance computed from the rest of the path.
+// Then the image is rendered by computing direct illumination at the first
+// non-specular vertex and looking up the cache at the next non-specular vertex,
+// where the cached irradiance is multiplied by the reflectance of the surface.
+// If no record is found, the path continues as the first non-specular vertex.
+// The quality parameter scales both the resolution of the grid and the number of the paths.
+class Renderer_IrradianceCache final : public Renderer {
+private:
+    Scene* scene_;
+    Film* film_;
+    int max_length_;                    // Maximum path length of the rendering
+    int cache_max_length_;              // Maximum path length to fill the cache
+    std::optional<unsigned int> seed_;
+    Float quality_;                     // Quality of the cache
+    std::optional<Float> cell_size_;    // Size of the grid cell. Computed from the scene bound if not specified.
+    int log2_cache_size_;               // Log2 of the number of entries in the cache
+    Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<scheduler::Scheduler> fill_sched_;
+    mutable long long cache_lookups_ = 0;   // Number of the cache lookups in the last rendering
+    mutable long long cache_hits_ = 0;      // Number of the lookups finding a record in the last rendering
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(scene_, film_, max_length_, cache_max_length_, seed_, quality_, cell_size_, log2_cache_size_, sched_, fill_sched_);
+    }
+
+    virtual Json underlying_value(const std::string& query) const override {
+        LM_UNUSED(query);
+        return {
+            {"cache_lookups", cache_lookups_},
+            {"cache_hits", cache_hits_}
+        };
+    }
+
+    virtual void foreach_underlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, scene_);
+        comp::visit(visit, film_);
+        comp::visit(visit, sched_);
+        comp::visit(visit, fill_sched_);
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        scene_ = json::comp_ref<Scene>(prop, "scene");
+        film_ = json::comp_ref<Film>(prop, "output");
+        max_length_ = json::value(prop, "max_length", 8);
+        cache_max_length_ = json::value(prop, "cache_max_length", 4);
+        seed_ = json::value_or_none<unsigned int>(prop, "seed");
+        quality_ = json::value(prop, "quality", 1_f);
+        if (quality_ <= 0_f) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Quality must be positive [quality='{}']", quality_);
+        }
+        cell_size_ = json::value_or_none<Float>(prop, "cell_size");
+        log2_cache_size_ = json::value(prop, "log2_cache_size", 20);
+
+        // Number of samples per pixel to fill the cache.
+        // Doubling the grid resolution requires four times the paths
+        // to keep the number of records per cell on the surfaces.
+        const auto fill_spp = json::value(prop, "cache_spp",
+            std::max(1LL, std::llround(4_f * quality_ * quality_)));
+        fill_sched_ = comp::create<scheduler::Scheduler>(
+            "scheduler::spp::sample", make_loc("fill_scheduler"), {
+                {"spp", fill_spp},
+                {"output", prop["output"]}
+            });
+        sched_ = comp::create<scheduler::Scheduler>(
+            "scheduler::spp::sample", make_loc("scheduler"), {
+                {"spp", json::value(prop, "spp", 1LL)},
+                {"output", prop["output"]}
+            });
+    }
+
+    virtual void render() const override {
+        scene_->require_renderable();
+
+        film_->clear();
+        const auto size = film_->size();
+        const auto seed = seed_ ? *seed_ : math::rng_seed();
+        const auto window = [&](long long pixel_index) -> Vec4 {
+            const int x = int(pixel_index % size.w);
+            const int y = int(pixel_index / size.w);
+            const auto dx = 1_f / size.w;
+            const auto dy = 1_f / size.h;
+            return { dx * x, dy * y, dx, dy };
+        };
+
+        // ----------------------------------------------------------------------------------------
+
+        // Fill the cache
+        const auto bound = scene_bound();
+        const auto cell_size = cell_size_ ? *cell_size_ : glm::length(bound.max - bound.min) / (64_f * quality_);
+        IrradianceCache cache(bound, cell_size, log2_cache_size_);
+        {
+            LM_INFO("Filling irradiance cache [cell_size={}]", cell_size);
+            LM_INDENT();
+            fill_sched_->run([&](long long pixel_index, long long sample_index, int) {
+                Rng rng(seed + 1, pixel_index, sample_index);
+                fill(rng, window(pixel_index), cache);
+            });
+        }
+
+        // ----------------------------------------------------------------------------------------
+
+        // Render the image.
+        // The numbers of the cache lookups and hits are counted per thread.
+        std::vector<long long> lookups(parallel::num_threads(), 0);
+        std::vector<long long> hits(parallel::num_threads(), 0);
+        const auto processed = sched_->run([&](long long pixel_index, long long sample_index, int threadid) {
+            Rng rng(seed, pixel_index, sample_index);
+            Vec3 throughput(1_f);
+            Vec3 wi = {};
+            auto sp = SceneInteraction::make_camera_terminator(window(pixel_index), film_->aspect_ratio());
+            Vec2 raster_pos{};
+            bool gathered = false;      // True if direct illumination is computed
+            for (int length = 0; length < max_length_; length++) {
+                const auto s = scene_->sample_ray(rng, sp, wi);
+                if (!s || math::is_zero(s->weight)) {
+                    break;
+                }
+                if (length == 0) {
+                    raster_pos = *scene_->raster_position(s->wo, film_->aspect_ratio());
+                }
+
+                const bool specular = length == 0 || scene_->is_specular(s->sp, s->comp);
+                if (!specular) {
+                    // Look up the cache at the secondary non-specular vertex.
+                    // The outgoing radiance is approximated by the diffuse reflection of the irradiance.
+                    if (gathered) {
+                        const auto R = scene_->reflectance(s->sp, s->comp);
+                        const auto E = cache.lookup(s->sp.geom.p, oriented_normal(s->sp, wi));
+                        lookups[threadid]++;
+                        if (E) {
+                            hits[threadid]++;
+                        }
+                        if (R && E) {
+                            film_->splat(raster_pos, throughput * *R * *E / Pi);
+                            break;
+                        }
+                    }
+
+                    // Direct illumination
+                    gathered = true;
+                    if (const auto sL = scene_->sample_direct_light(rng, s->sp); sL && scene_->visible(s->sp, sL->sp)) {
+                        const auto fs = scene_->eval_contrb(s->sp, s->comp, wi, -sL->wo);
+                        film_->splat(raster_pos, throughput / scene_->pdf_comp(s->sp, s->comp, wi) * fs * sL->weight);
+                    }
+                }
+
+                const auto hit = scene_->intersect(s->ray());
+                if (!hit) {
+                    break;
+                }
+                throughput *= s->weight;
+
+                // Light hit after specular vertices, which is not handled by direct illumination
+                if (specular && scene_->is_light(*hit)) {
+                    film_->splat(raster_pos, throughput * scene_->eval_contrb_endpoint(*hit, -s->wo));
+                }
+
+                wi = -s->wo;
+                sp = *hit;
+            }
+        });
+
+        cache_lookups_ = std::accumulate(lookups.begin(), lookups.end(), 0LL);
+        cache_hits_ = std::accumulate(hits.begin(), hits.end(), 0LL);
+        LM_INFO("Cache lookups [lookups={}, hits={}]", cache_lookups_, cache_hits_);
+
+        // ----------------------------------------------------------------------------------------
+
+        if (processed == 0) {
+            return;
+        }
+        film_->rescale(1_f / Float(processed));
+    }
+
+private:
+    // Trace a path from the camera and record the irradiance estimates at the non-specular vertices.
+    // The radiance of the light is only accounted by the light sampling,
+    // thus the records contain the irradiance from both direct and indirect illumination.
+    void fill(Rng& rng, Vec4 window, IrradianceCache& cache) const {
+        struct Vertex {
+            Vec3 p;             // Position
+            Vec3 n;             // Oriented normal. Zero if the vertex is not recorded.
+            Vec3 direct_E;      // Irradiance from the light sampling
+            Vec3 direct_L;      // Outgoing radiance from the light sampling
+            Vec3 weight;        // Weight of the sampled direction
+            Float inv_pdf;      // Inverse of the pdf of the sampled direction in projected solid angle measure
+        };
+        std::vector<Vertex> path;
+
+        Vec3 wi = {};
+        auto sp = SceneInteraction::make_camera_terminator(window, film_->aspect_ratio());
+        for (int length = 0; length < cache_max_length_; length++) {
+            const auto s = scene_->sample_ray(rng, sp, wi);
+            if (!s || math::is_zero(s->weight)) {
+                break;
+            }
+            if (length == 0) {
+                wi = -s->wo;
+                const auto hit = scene_->intersect(s->ray());
+                if (!hit) {
+                    break;
+                }
+                sp = *hit;
+                continue;
+            }
+
+            Vertex v{};
+            v.p = s->sp.geom.p;
+            v.weight = s->weight;
+            const auto pdf_comp = scene_->pdf_comp(s->sp, s->comp, wi);
+            if (!scene_->is_specular(s->sp, s->comp)) {
+                const auto n = oriented_normal(s->sp, wi);
+                if (const auto sL = scene_->sample_direct_light(rng, s->sp); sL && scene_->visible(s->sp, sL->sp)) {
+                    const auto wo = -sL->wo;
+                    if (glm::dot(n, wo) > 0_f) {
+                        v.direct_E = sL->weight;
+                    }
+                    v.direct_L = scene_->eval_contrb(s->sp, s->comp, wi, wo) * sL->weight / pdf_comp;
+                }
+                const auto pdf = scene_->pdf(s->sp, s->comp, wi, s->wo) * pdf_comp;
+                if (glm::dot(n, s->wo) > 0_f && pdf > 0_f) {
+                    v.inv_pdf = 1_f / pdf;
+                }
+                v.n = n;
+            }
+            path.push_back(v);
+
+            const auto hit = scene_->intersect(s->ray());
+            if (!hit) {
+                break;
+            }
+            wi = -s->wo;
+            sp = *hit;
+        }
+
+        // Accumulate the outgoing radiance backward along the path
+        Vec3 L(0_f);
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if (it->n != Vec3(0_f)) {
+                cache.record(it->p, it->n, it->direct_E + L * it->inv_pdf);
+            }
+            L = it->direct_L + it->weight * L;
+        }
+    }
+
+    // Bound of the scene in world space
+    Bound scene_bound() const {
+        Bound bound;
+        scene_->traverse_primitive_nodes([&](const SceneNode& node, Mat4 global_transform) {
+            if (node.type != SceneNodeType::Primitive) {
+                return;
+            }
+            if (!node.primitive.mesh) {
+                return;
+            }
+            node.primitive.mesh->foreach_triangle([&](int, const Mesh::Tri& tri) {
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p1.p, 1_f)));
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p2.p, 1_f)));
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p3.p, 1_f)));
+            });
+        });
+        if (bound.min.x > bound.max.x) {
+            bound = merge(merge(bound, Vec3(-1_f)), Vec3(1_f));
+        }
+        return bound;
+    }
+};
+
+LM_COMP_REG_IMPL(Renderer_IrradianceCache, "renderer::irradiancecache");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -7,8 +7,14 @@
 #include <lm/core.h>
 #include <lm/renderer.h>
 #include <lm/scene.h>
+#include <lm/mesh.h>
 #include <lm/film.h>
+#include <lm/camera.h>
 #include <lm/scheduler.h>
+#include <lm/parallel.h>
+#include <lm/sampler.h>
+#include <lm/denoiser.h>
+#include <lm/serial.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -25,33 +31,431 @@ enum class ImageSampleMode {
 
 // ------------------------------------------------------------------------------------------------
 
+// Spatial-directional tree (SD-tree) for path guiding [Muller2017].
+// The spatial component is a binary tree subdividing the scene bound.
+// Each leaf holds a quadtree (D-tree) representing the distribution of
+// the incident radiance over the directions parameterized in [0,1]^2.
+//
+// [Muller2017] T. Muller, M. Gross, and J. Novak.
+//              Practical path guiding for efficient light-transport simulation.
+//              Computer Graphics Forum 36(4), 2017.
+namespace {
+
+// Floating point value updated atomically while recording
+struct AtomicFloat {
+    std::atomic<Float> v{0_f};
+
+    AtomicFloat() = default;
+    AtomicFloat(const AtomicFloat& o)
+        : v(o.v.load()) {}
+    AtomicFloat& operator=(const AtomicFloat& o) {
+        v.store(o.v.load());
+        return *this;
+    }
+
+    Float load() const {
+        return v.load(std::memory_order_relaxed);
+    }
+
+    void add(Float x) {
+        auto expected = v.load(std::memory_order_relaxed);
+        while (!v.compare_exchange_weak(expected, expected + x, std::memory_order_relaxed));
+    }
+};
+
+// Cylindrical mapping between a direction and a point in [0,1]^2.
+// The mapping is area-preserving with the Jacobian 4*pi.
+Vec2 dir_to_canonical(Vec3 d) {
+    const auto cos_theta = glm::clamp(d.z, -1_f, 1_f);
+    auto phi = std::atan2(d.y, d.x);
+    if (phi < 0_f) {
+        phi += 2_f * Pi;
+    }
+    return { (cos_theta + 1_f) * .5_f, phi / (2_f * Pi) };
+}
+
+Vec3 canonical_to_dir(Vec2 p) {
+    const auto cos_theta = 2_f * p.x - 1_f;
+    const auto sin_theta = std::sqrt(std::max(0_f, 1_f - cos_theta * cos_theta));
+    const auto phi = 2_f * Pi * p.y;
+    return { sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta };
+}
+
+// Directional quadtree
+class DTree {
+private:
+    struct Node {
+        AtomicFloat sum[4];     // Recorded energy of the quadrants
+        int child[4] = {};      // Index of the child node. 0 if the quadrant is a leaf.
+    };
+    std::vector<Node> nodes_;
+    AtomicFloat count_;         // Number of records
+
+private:
+    // Select quadrant containing p and remap p to the quadrant
+    static int quadrant(Vec2& p) {
+        int q = 0;
+        for (int i = 0; i < 2; i++) {
+            if (p[i] < .5_f) {
+                p[i] *= 2_f;
+            }
+            else {
+                p[i] = p[i] * 2_f - 1_f;
+                q |= 1 << i;
+            }
+        }
+        return q;
+    }
+
+    Float node_sum(int i) const {
+        const auto& n = nodes_[i];
+        return n.sum[0].load() + n.sum[1].load() + n.sum[2].load() + n.sum[3].load();
+    }
+
+public:
+    DTree() : nodes_(1) {}
+
+    Float count() const { return count_.load(); }
+    Float total() const { return node_sum(0); }
+
+    void halve_count() {
+        count_.v.store(count_.load() * .5_f);
+    }
+
+    // Record energy in the direction
+    void record(Vec3 d, Float v) {
+        count_.add(1_f);
+        auto p = dir_to_canonical(d);
+        int i = 0;
+        while (true) {
+            const int q = quadrant(p);
+            nodes_[i].sum[q].add(v);
+            const int c = nodes_[i].child[q];
+            if (c == 0) {
+                break;
+            }
+            i = c;
+        }
+    }
+
+    // Sample a direction proportional to the recorded energy. Requires total() > 0.
+    Vec3 sample(Rng& rng) const {
+        Vec2 origin(0_f);
+        Float size = 1_f;
+        int i = 0;
+        while (true) {
+            const auto& n = nodes_[i];
+            auto u = rng.u() * node_sum(i);
+            int q = 0;
+            for (; q < 3; q++) {
+                const auto s = n.sum[q].load();
+                if (u < s) {
+                    break;
+                }
+                u -= s;
+            }
+            size *= .5_f;
+            origin += Vec2(q & 1, q >> 1) * size;
+            if (n.child[q] == 0) {
+                return canonical_to_dir(origin + Vec2(rng.u(), rng.u()) * size);
+            }
+            i = n.child[q];
+        }
+    }
+
+    // Evaluate pdf in solid angle measure
+    Float pdf(Vec3 d) const {
+        auto p = dir_to_canonical(d);
+        Float pdf = 1_f / (4_f * Pi);
+        int i = 0;
+        while (true) {
+            const auto total = node_sum(i);
+            if (total <= 0_f) {
+                return 0_f;
+            }
+            const int q = quadrant(p);
+            pdf *= 4_f * nodes_[i].sum[q].load() / total;
+            const int c = nodes_[i].child[q];
+            if (c == 0) {
+                return pdf;
+            }
+            i = c;
+        }
+    }
+
+    // Create a tree for the next iteration where the quadrants with
+    // the energy larger than the threshold relative to the total energy are subdivided.
+    // The energy of the created tree is reset.
+    DTree refined(Float threshold, int max_depth) const {
+        DTree t;
+        const auto total = this->total();
+        if (total <= 0_f) {
+            return t;
+        }
+        // Node of this tree (-1 if the quadrant is a leaf), node of the new tree, energy ratio, depth
+        struct Item { int src; int dst; Float ratio; int depth; };
+        std::vector<Item> stack{ {0, 0, 1_f, 1} };
+        while (!stack.empty()) {
+            const auto it = stack.back();
+            stack.pop_back();
+            for (int q = 0; q < 4; q++) {
+                // Assume uniform distribution inside a leaf
+                const auto ratio = it.src >= 0 ? nodes_[it.src].sum[q].load() / total : it.ratio / 4_f;
+                if (ratio <= threshold || it.depth >= max_depth) {
+                    continue;
+                }
+                const int c = int(t.nodes_.size());
+                t.nodes_.emplace_back();
+                t.nodes_[it.dst].child[q] = c;
+                const int src_child = it.src >= 0 ? nodes_[it.src].child[q] : 0;
+                stack.push_back({ src_child > 0 ? src_child : -1, c, ratio, it.depth + 1 });
+            }
+        }
+        return t;
+    }
+};
+
+// Spatial binary tree
+class STree {
+private:
+    struct Node {
+        int axis = 0;
+        int child[2] = {};      // Index of the child node. 0 if the node is a leaf.
+        int leaf = -1;          // Index of the leaf data
+    };
+    struct Leaf {
+        DTree sampling;         // Distribution used for guiding
+        DTree building;         // Distribution being recorded for the next iteration
+    };
+    Vec3 min_;
+    Float size_;
+    std::vector<Node> nodes_;
+    std::vector<Leaf> leaves_;
+
+private:
+    int leaf_index(Vec3 p) const {
+        auto t = glm::clamp((p - min_) / size_, Vec3(0_f), Vec3(1_f));
+        int i = 0;
+        while (nodes_[i].child[0] != 0) {
+            const int a = nodes_[i].axis;
+            if (t[a] < .5_f) {
+                t[a] *= 2_f;
+                i = nodes_[i].child[0];
+            }
+            else {
+                t[a] = t[a] * 2_f - 1_f;
+                i = nodes_[i].child[1];
+            }
+        }
+        return nodes_[i].leaf;
+    }
+
+public:
+    // Construct with the bound of the scene. The bound is extended to a cube.
+    STree(const Bound& bound) {
+        const auto extent = bound.max - bound.min;
+        size_ = glm::compMax(extent) * 1.01_f + Eps;
+        min_ = bound.center() - Vec3(size_ * .5_f);
+        nodes_.emplace_back();
+        nodes_[0].leaf = 0;
+        leaves_.emplace_back();
+    }
+
+    const DTree& sampling(Vec3 p) const {
+        return leaves_[leaf_index(p)].sampling;
+    }
+
+    void record(Vec3 p, Vec3 d, Float v) {
+        leaves_[leaf_index(p)].building.record(d, v);
+    }
+
+    // Refine the tree after an iteration.
+    // The leaves with the number of records larger than the threshold are subdivided,
+    // and the recorded distributions are used for guiding in the next iteration.
+    void refine(Float spatial_threshold, Float directional_threshold, int max_depth) {
+        for (int i = 0; i < int(nodes_.size()); i++) {
+            if (nodes_[i].child[0] != 0) {
+                continue;
+            }
+            const int l = nodes_[i].leaf;
+            if (leaves_[l].building.count() <= spatial_threshold) {
+                continue;
+            }
+            // Split the leaf into two children. The children share the records of the parent,
+            // assuming the records are evenly distributed.
+            const int axis = nodes_[i].axis;
+            for (int c = 0; c < 2; c++) {
+                Node child;
+                child.axis = (axis + 1) % 3;
+                child.leaf = c == 0 ? l : int(leaves_.size());
+                if (c == 1) {
+                    leaves_.push_back(leaves_[l]);
+                }
+                nodes_[i].child[c] = int(nodes_.size());
+                nodes_.push_back(child);
+            }
+            leaves_[l].building.halve_count();
+            leaves_.back().building.halve_count();
+        }
+        for (auto& leaf : leaves_) {
+            auto next = leaf.building.refined(directional_threshold, max_depth);
+            leaf.sampling = std::move(leaf.building);
+            leaf.building = std::move(next);
+        }
+    }
+};
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
 class Renderer_PT : public Renderer {
+private:
+    // View rendered with a camera in the scene
+    struct View {
+        Film* film;
+        Camera* camera;         // Camera of the view. nullptr to use the camera of the scene.
+        int albedo_aov = -1;    // Indices of the AOV channels of the film. -1 if not used.
+        int normal_aov = -1;
+        int depth_aov = -1;
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(film, camera, albedo_aov, normal_aov, depth_aov);
+        }
+    };
+
 private:
     Scene* scene_;
-    Film* film_;
+    Film* film_;                        // Film of the first view used for scheduling
+    std::vector<View> views_;           // Views rendered in the same scheduling pass
     int max_length_;
     std::optional<unsigned int> seed_;
     PTMode pt_mode_;
     ImageSampleMode image_sample_mode_;
+    bool accumulate_;       // Accumulate samples to the film of the previous rendering
+    mutable long long next_sample_ = 0;     // Index of the first sample in the next accumulated rendering
     Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;   // Sampler for the random numbers. nullptr if not specified.
+    Component::Ptr<Denoiser> denoiser_; // Denoiser executed after rendering. nullptr if not specified.
+    Film* denoised_film_ = nullptr;
+    bool guiding_;                      // Enable path guiding
+    Float guiding_prob_;                // Probability to sample the direction from the guiding distribution
+    Float spatial_threshold_;           // Number of records to subdivide a spatial node in the first iteration
+    Float directional_threshold_;       // Energy ratio to subdivide a directional node
+    std::vector<Component::Ptr<scheduler::Scheduler>> training_scheds_;    // Schedulers of the training iterations
+    std::optional<std::string> checkpoint_;     // Path to the checkpoint file. nullopt if checkpointing is disabled.
+    double checkpoint_interval_;                // Interval of checkpointing in seconds
+    bool resume_;                               // Resume from the checkpoint if exists
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(scene_, film_, max_length_, pt_mode_, sched_);
+        ar(scene_, film_, views_, max_length_, pt_mode_, accumulate_, next_sample_, sched_, sampler_, denoiser_, denoised_film_,
+            guiding_, guiding_prob_, spatial_threshold_, directional_threshold_, training_scheds_,
+            checkpoint_, checkpoint_interval_, resume_);
     }
 
     virtual void foreach_underlying(const ComponentVisitor& visit) override {
         comp::visit(visit, scene_);
         comp::visit(visit, film_);
+        for (auto& view : views_) {
+            comp::visit(visit, view.film);
+            comp::visit(visit, view.camera);
+        }
         comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
+        comp::visit(visit, denoiser_);
+        comp::visit(visit, denoised_film_);
+        for (auto& sched : training_scheds_) {
+            comp::visit(visit, sched);
+        }
     }
 
 public:
     virtual void construct(const Json& prop) override {
         scene_ = json::comp_ref<Scene>(prop, "scene");
-        film_ = json::comp_ref<Film>(prop, "output");
+        // Multiple views rendered in a scheduling pass
+        if (const auto it = prop.find("views"); it != prop.end()) {
+            for (const auto& v : *it) {
+                views_.push_back({
+                    json::comp_ref<Film>(v, "output"),
+                    json::comp_ref<Camera>(v, "camera")
+                });
+            }
+            if (views_.empty()) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument, "Views must not be empty");
+            }
+            for (const auto& view : views_) {
+                const auto size = view.film->size();
+                const auto base_size = views_.front().film->size();
+                if (size.w != base_size.w || size.h != base_size.h) {
+                    LM_THROW_EXCEPTION(Error::InvalidArgument,
+                        "Films of the views must have the same size [film='{}']", view.film->loc());
+                }
+            }
+        }
+        else {
+            views_.push_back({ json::comp_ref<Film>(prop, "output"), nullptr });
+        }
+        film_ = views_.front().film;
+        // The schedulers process the pixels of the film of the first view
+        auto sched_prop = prop;
+        sched_prop["output"] = film_->loc();
         max_length_ = json::value<int>(prop, "max_length");
         seed_ = json::value_or_none<unsigned int>(prop, "seed");
+        accumulate_ = json::value(prop, "accumulate", false);
+        if (const auto sampler_name = json::value_or_none<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *sampler_name, make_loc("sampler"), sched_prop);
+        }
+        // AOV channels filled at the first non-specular vertex
+        for (const auto& name : json::value(prop, "aovs", std::vector<std::string>{})) {
+            for (auto& view : views_) {
+                if (name == "albedo") {
+                    view.albedo_aov = add_aov(view.film, name, 3);
+                }
+                else if (name == "normal") {
+                    view.normal_aov = add_aov(view.film, name, 3);
+                }
+                else if (name == "depth") {
+                    view.depth_aov = add_aov(view.film, name, 1);
+                }
+                else {
+                    LM_THROW_EXCEPTION(Error::InvalidArgument, "Unsupported AOV [name='{}']", name);
+                }
+            }
+        }
+        if (const auto denoiserName = json::value_or_none<std::string>(prop, "denoiser")) {
+            // The denoiser uses the AOVs rendered in the same pass
+            denoiser_ = comp::create<Denoiser>("denoiser::" + *denoiserName, make_loc("denoiser"), prop);
+            denoised_film_ = json::comp_ref_or_nullptr<Film>(prop, "denoised_output");
+            if (!denoised_film_) {
+                // Denoising in place overwrites the accumulated samples
+                if (accumulate_) {
+                    LM_THROW_EXCEPTION(Error::InvalidArgument,
+                        "Denoiser with accumulation requires 'denoised_output'");
+                }
+                denoised_film_ = film_;
+            }
+        }
+        // Checkpointing of the intermediate state of the rendering
+        checkpoint_ = json::value_or_none<std::string>(prop, "checkpoint");
+        checkpoint_interval_ = json::value(prop, "checkpoint_interval", 600.0);
+        resume_ = json::value(prop, "resume", false);
+        // Path guiding with the distributions learned in the training iterations
+        guiding_ = json::value(prop, "guiding", false);
+        guiding_prob_ = json::value(prop, "guiding_prob", .5_f);
+        spatial_threshold_ = json::value(prop, "guiding_spatial_threshold", 12000_f);
+        directional_threshold_ = json::value(prop, "guiding_directional_threshold", .01_f);
+        if (guiding_) {
+            const auto iterations = json::value(prop, "guiding_iterations", 5);
+            for (int iter = 0; iter < iterations; iter++) {
+                // The number of samples is doubled in each iteration
+                auto training_prop = sched_prop;
+                training_prop["spp"] = 1LL << iter;
+                training_scheds_.push_back(comp::create<scheduler::Scheduler>(
+                    "scheduler::spp::sample", make_loc("training_scheduler_" + std::to_string(iter)), training_prop));
+            }
+        }
         {
             const auto s = json::value<std::string>(prop, "mode", "mis");
             if (s == "naive") {
@@ -70,205 +474,562 @@ public:
             if (s == "pixel") {
                 image_sample_mode_ = ImageSampleMode::Pixel;
                 sched_ = comp::create<scheduler::Scheduler>(
-                    "scheduler::spp::" + schedName, make_loc("scheduler"), prop);
+                    "scheduler::spp::" + schedName, make_loc("scheduler"), sched_prop);
             }
             else if (s == "image") {
+                if (checkpoint_) {
+                    LM_THROW_EXCEPTION(Error::InvalidArgument, "Checkpointing is not supported in image sample mode");
+                }
                 image_sample_mode_ = ImageSampleMode::Image;
                 sched_ = comp::create<scheduler::Scheduler>(
-                    "scheduler::spi::" + schedName, make_loc("scheduler"), prop);
+                    "scheduler::spi::" + schedName, make_loc("scheduler"), sched_prop);
             }
         }
+        if (views_.size() > 1 && (denoiser_ || checkpoint_ || guiding_)) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Denoising, checkpointing, and guiding are not supported with multiple views");
+        }
     }
 
     virtual void render() const override {
 		scene_->require_renderable();
 
-        // Clear film
-        film_->clear();
+        // Camera node indices of the views
+        std::vector<int> cameras;
+        for (const auto& view : views_) {
+            cameras.push_back(view.camera ? camera_node(view.camera) : -1);
+        }
+
+        // Clear films unless the samples are accumulated to the previous result
+        bool cleared = true;
+        for (const auto& view : views_) {
+            if (!accumulate_ || view.film->weight() == 0) {
+                view.film->clear();
+            }
+            else {
+                cleared = false;
+            }
+        }
+        if (cleared) {
+            next_sample_ = 0;
+        }
         const auto size = film_->size();
 
+        // Seed of the random number generator and index of the first sample.
+        // When accumulating, the sample indices continue from the previous rendering.
+        auto seed = seed_ ? *seed_ : math::rng_seed();
+
+        // Resume from the checkpoint.
+        // The film is restored to the state after the processed samples in the interrupted rendering.
+        long long resumed = 0;
+        const auto checkpoint = checkpoint_path();
+        if (checkpoint_ && resume_ && fs::exists(checkpoint)) {
+            std::ifstream is(checkpoint, std::ios::in | std::ios::binary);
+            InputArchive ar(is, film_->loc());
+            ar(seed, resumed);
+            film_->load(ar);
+            LM_INFO("Resuming from checkpoint [path='{}', spp={}]", checkpoint, resumed);
+        }
+
+        // Index of the first sample.
+        // The index is tracked separately from the weight of the films
+        // because a cancelled rendering might use more sample indices than the processed samples.
+        const auto sample_offset = next_sample_;
+
+        // Index next to the last sample processed in each thread
+        std::vector<long long> sample_ends(parallel::num_threads(), 0);
+
+        // Window of the pixel in the pixel space sample mode
+        const auto pixel_window = [&](long long pixel_index) -> Vec4 {
+            const int x = int(pixel_index % size.w);
+            const int y = int(pixel_index / size.w);
+            const auto dx = 1_f / size.w;
+            const auto dy = 1_f / size.h;
+            return { dx * x, dy * y, dx, dy };
+        };
+
+        // ----------------------------------------------------------------------------------------
+
+        // Learn the guiding distributions.
+        // The number of samples is doubled in each iteration and
+        // the distributions learned in an iteration are used for guiding in the next iteration.
+        std::optional<STree> stree;
+        if (guiding_) {
+            stree.emplace(scene_bound());
+            LM_INFO("Training guiding distributions [iterations={}]", training_scheds_.size());
+            LM_INDENT();
+            for (int iter = 0; iter < int(training_scheds_.size()); iter++) {
+                LM_INFO("Iteration {} [spp={}]", iter, 1 << iter);
+                training_scheds_[iter]->run([&](long long pixel_index, long long sample_index, int) {
+                    // The training samples do not use the sampler, which ignores the seed,
+                    // so that the distributions are not fitted to the sample points of the final rendering.
+                    Rng rng(seed + iter + 1, pixel_index, sample_index);
+                    trace(rng, pixel_window(pixel_index), views_.front(), cameras.front(), &*stree, true);
+                });
+                stree->refine(spatial_threshold_ * std::sqrt(Float(1 << iter)), directional_threshold_, 20);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+
         // Dispatch rendering
-        const auto processed = sched_->run([&](long long pixel_index, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rng_seed());
+        const auto process = [&](long long pixel_index, long long sample_index, int threadid) {
+            if (sample_index >= sample_ends[threadid]) {
+                sample_ends[threadid] = sample_index + 1;
+            }
+            const auto window = image_sample_mode_ == ImageSampleMode::Pixel
+                ? pixel_window(pixel_index)
+                : Vec4(0_f, 0_f, 1_f, 1_f);
+            // The views are interleaved per sample so that the views share
+            // the acceleration structure and textures warmed up in the caches.
+            for (size_t i = 0; i < views_.size(); i++) {
+                // Random number generator for the sample.
+                // The random numbers are determined by the pixel and sample indices
+                // independently of the thread processing the sample and of the other views.
+                Rng rng(seed, pixel_index, sample_offset + sample_index, sampler_.get());
+                trace(rng, window, views_[i], cameras[i], stree ? &*stree : nullptr, false);
+            }
+        };
+        const auto processed = checkpoint_
+            ? render_with_checkpoint(process, seed, resumed)
+            : sched_->run(process);
+        next_sample_ = sample_offset + *std::max_element(sample_ends.begin(), sample_ends.end());
 
-            // ------------------------------------------------------------------------------------
+        // ----------------------------------------------------------------------------------------
+        
+        // Rescale film.
+        // The number of processed samples can be zero if the rendering is cancelled.
+        if (processed == 0) {
+            return;
+        }
+        // Weight of the samples in the number of samples per pixel
+        const auto weight = image_sample_mode_ == ImageSampleMode::Pixel
+            ? Float(processed)
+            : Float(processed) / (size.w * size.h);
+        for (const auto& view : views_) {
+            if (accumulate_) {
+                // Keep unnormalized sum in the film
+                view.film->add_weight(weight);
+            }
+            else {
+                view.film->rescale(1_f / weight);
+            }
+        }
 
-            // Sample window
-            const auto window = [&]() -> Vec4 {
-                if (image_sample_mode_ == ImageSampleMode::Pixel) {
-                    const int x = int(pixel_index % size.w);
-                    const int y = int(pixel_index / size.w);
-                    const auto dx = 1_f / size.w;
-                    const auto dy = 1_f / size.h;
-                    return { dx * x, dy * y, dx, dy };
+        // Denoise the rendered image
+        if (denoiser_) {
+            denoiser_->denoise(film_, denoised_film_);
+        }
+    }
+
+private:
+    // Path to the checkpoint file.
+    // When the rendering is distributed to multiple processes, e.g., with renderer::fork,
+    // the index of the partition is appended so that the processes do not overwrite the files each other.
+    std::string checkpoint_path() const {
+        if (!checkpoint_) {
+            return {};
+        }
+        if (scheduler::partition_count() > 1) {
+            return fmt::format("{}.{}", *checkpoint_, scheduler::partition_index());
+        }
+        return *checkpoint_;
+    }
+
+    // Dispatch rendering in passes and save the state of the film to the checkpoint file
+    // between the passes at the interval.
+    // The film is copied to a snapshot at the pass boundary before the next pass starts,
+    // and the snapshot is written to the file in background while the workers process the next pass.
+    long long render_with_checkpoint(const scheduler::Scheduler::ProcessFunc& process, unsigned int seed, long long resumed) const {
+        std::thread writer;
+        const auto checkpoint = checkpoint_path();
+        auto last = std::chrono::high_resolution_clock::now();
+        const auto processed = sched_->run_passes([&](long long pixel_begin, long long pixel_end, long long sample_begin, long long sample_end, int threadid) {
+            for (long long pixel_index = pixel_begin; pixel_index < pixel_end; pixel_index++) {
+                for (long long sample_index = sample_begin; sample_index < sample_end; sample_index++) {
+                    process(pixel_index, sample_index, threadid);
                 }
-                else {
-                    return { 0_f, 0_f, 1_f, 1_f };
+            }
+        }, [&](long long spp) {
+            const auto curr = std::chrono::high_resolution_clock::now();
+            if (std::chrono::duration<double>(curr - last).count() < checkpoint_interval_) {
+                return;
+            }
+            last = curr;
+
+            // Take snapshot of the state.
+            // No worker is running here, so the film contains exactly spp samples.
+            std::string snapshot;
+            {
+                std::ostringstream os;
+                {
+                    OutputArchive ar(os, film_->loc());
+                    ar(seed, spp);
+                    film_->save(ar);
                 }
-            }();
+                snapshot = os.str();
+            }
+            LM_INFO("Saving checkpoint [path='{}', spp={}]", checkpoint, spp);
 
-            // ------------------------------------------------------------------------------------
+            // Write to a temporary file and replace the checkpoint
+            // so that the checkpoint is not broken if the process is killed while writing.
+            if (writer.joinable()) {
+                writer.join();
+            }
+            writer = std::thread([path = checkpoint, data = std::move(snapshot)]() {
+                const auto temp = path + ".tmp";
+                std::error_code ec;
+                {
+                    // Keep the last checkpoint if the file is not completely written,
+                    // e.g., due to a full disk.
+                    std::ofstream out(temp, std::ios::out | std::ios::binary);
+                    out.write(data.data(), data.size());
+                    out.close();
+                    if (!out) {
+                        LM_WARN("Failed to write checkpoint [path='{}']", temp);
+                        fs::remove(temp, ec);
+                        return;
+                    }
+                }
+                fs::rename(temp, path, ec);
+                if (ec) {
+                    LM_WARN("Failed to write checkpoint [path='{}', error='{}']", path, ec.message());
+                }
+            });
+        }, resumed);
+        if (writer.joinable()) {
+            writer.join();
+        }
+
+        // Remove the checkpoint of the completed rendering
+        // so that the following rendering with resume option does not pick up the stale state.
+        // The checkpoint of the cancelled rendering is kept for resuming.
+        if (!parallel::cancel_token().cancelled()) {
+            std::error_code ec;
+            fs::remove(checkpoint, ec);
+        }
+        return processed;
+    }
+
+    // Trace a path from the camera of the view and accumulate the contributions to the film.
+    // camera is the node index of the camera, or -1 to use the camera of the scene.
+    // stree is the SD-tree used for guiding, or nullptr if guiding is disabled.
+    // In the training mode, the incident radiance is recorded to the SD-tree
+    // instead of the film.
+    void trace(Rng& rng, Vec4 window, const View& view, int camera, STree* stree, bool training) const {
+        // Path throughput
+        Vec3 throughput(1_f);
 
-            // Path throughput
-            Vec3 throughput(1_f);
+        // Incident direction and current surface point
+        Vec3 wi = {};
+        auto sp = SceneInteraction::make_camera_terminator(window, view.film->aspect_ratio(), camera);
 
-            // Incident direction and current surface point
-            Vec3 wi = {};
-            auto sp = SceneInteraction::make_camera_terminator(window, film_->aspect_ratio());
+        // Raster position
+        Vec2 raster_pos{};
 
-            // Raster position
-            Vec2 raster_pos{};
+        // Position of the camera and flag to record the AOVs once per path
+        Vec3 camera_pos{};
+        bool aovs_written = training;
+
+        // Ray cone approximating the footprint of the path used for texture filtering.
+        // The spread angle is the angle subtended by a pixel of the film from the camera,
+        // and the width grows linearly with the distance traveled along the path.
+        // The cone is not widened at the scattering, thus the footprint is conservative.
+        Float cone_spread = 0_f;
+        Float cone_width = 0_f;
+
+        // Vertices of the path recorded for training guiding distributions
+        struct GuidingVertex {
+            Vec3 p;             // Position
+            Vec3 wo;            // Sampled direction
+            Float pdf;          // Pdf of wo in solid angle measure
+            Vec3 throughput;    // Path throughput up to the vertex including wo
+            Vec3 radiance;      // Estimated incident radiance from wo
+        };
+        std::vector<GuidingVertex> vertices;
+
+        // Accumulate contribution C to the path
+        const auto accumulate = [&](Vec2 rp, Vec3 C) {
+            if (!training) {
+                view.film->splat(rp, C);
+                return;
+            }
+            for (auto& v : vertices) {
+                for (int i = 0; i < 3; i++) {
+                    if (v.throughput[i] > 0_f) {
+                        v.radiance[i] += C[i] / v.throughput[i];
+                    }
+                }
+            }
+        };
+
+        // Perform random walk
+        for (int length = 0; length < max_length_; length++) {
+            // Sample a ray
+            auto s = scene_->sample_ray(rng, sp, wi);
+            if (!s || math::is_zero(s->weight)) {
+                break;
+            }
+            // Compute raster position for the primary ray
+            if (length == 0) {
+                raster_pos = *scene_->raster_position(s->wo, view.film->aspect_ratio(), camera);
+                camera_pos = s->sp.geom.p;
+                const auto d = scene_->primary_ray(
+                    raster_pos + Vec2(1_f / view.film->size().w, 0_f), view.film->aspect_ratio(), camera).d;
+                cone_spread = std::acos(glm::clamp(glm::dot(d, s->wo), -1_f, 1_f));
+            }
+
+            // Record AOVs at the first non-specular vertex
+            if (length > 0 && !aovs_written && !scene_->is_specular(s->sp, s->comp)) {
+                aovs_written = true;
+                if (view.albedo_aov >= 0) {
+                    view.film->splat_aov(view.albedo_aov, raster_pos, scene_->reflectance(s->sp, s->comp).value_or(Vec3(0_f)));
+                }
+                if (view.normal_aov >= 0) {
+                    view.film->splat_aov(view.normal_aov, raster_pos, s->sp.geom.n);
+                }
+                if (view.depth_aov >= 0) {
+                    view.film->splat_aov(view.depth_aov, raster_pos, Vec3(glm::distance(camera_pos, s->sp.geom.p)));
+                }
+            }
+
+            // --------------------------------------------------------------------------------
+
+            // Guiding distribution of the current vertex. nullptr if the vertex is not guided.
+            // Only surface vertices are guided because the pdf in projected solid angle measure
+            // is not defined for the vertices in media, where the normal is zero.
+            const bool guidable = stree && length > 0 && !s->sp.geom.degenerated && !scene_->is_specular(s->sp, s->comp);
+            const auto* dtree = [&]() -> const DTree* {
+                if (!guidable) {
+                    return nullptr;
+                }
+                const auto& t = stree->sampling(s->sp.geom.p);
+                return t.total() > 0_f ? &t : nullptr;
+            }();
+
+            // Pdf of sampling the direction in projected solid angle measure.
+            // The guiding distribution and BSDF sampling are combined with one-sample MIS.
+            const auto pdf_dir = [&](Vec3 wo) -> Float {
+                const auto pdf_bsdf = scene_->pdf(s->sp, s->comp, wi, wo);
+                if (!dtree) {
+                    return pdf_bsdf;
+                }
+                const auto cos = std::abs(glm::dot(s->sp.geom.n, wo));
+                const auto pdf_guide = cos > 0_f ? dtree->pdf(wo) / cos : 0_f;
+                return guiding_prob_ * pdf_guide + (1_f - guiding_prob_) * pdf_bsdf;
+            };
 
-            // Perform random walk
-            for (int length = 0; length < max_length_; length++) {
-                // Sample a ray
-                const auto s = scene_->sample_ray(rng, sp, wi);
-                if (!s || math::is_zero(s->weight)) {
+            // Sample a direction from the guiding distribution
+            if (dtree) {
+                if (rng.u() < guiding_prob_) {
+                    s->wo = dtree->sample(rng);
+                }
+                const auto pdf = pdf_dir(s->wo);
+                s->weight = pdf > 0_f
+                    ? scene_->eval_contrb(s->sp, s->comp, wi, s->wo) / (pdf * scene_->pdf_comp(s->sp, s->comp, wi))
+                    : Vec3(0_f);
+                if (math::is_zero(s->weight)) {
                     break;
                 }
-                // Compute raster position for the primary ray
-                if (length == 0) {
-                    raster_pos = *scene_->raster_position(s->wo, film_->aspect_ratio());
+            }
+
+            // --------------------------------------------------------------------------------
+
+            // Sample a NEE edge
+            const bool nee = [&]() {
+                // Ignore NEE edge with naive direct sampling mode
+                if (pt_mode_ == PTMode::Naive) {
+                    return false;
+                }
+                // NEE edge can be samplable if current direction sampler
+                // (according to BSDF / phase) doesn't contain delta component.
+                if (image_sample_mode_ == ImageSampleMode::Pixel) {
+                    // Primary ray is not samplable via NEE in the pixel space sample mode
+                    return length > 0 && !scene_->is_specular(s->sp, s->comp);
+                }
+                else {
+                    // Primary ray is samplable via NEE in the image space sample mode
+                    return !scene_->is_specular(s->sp, s->comp);
+                }
+            }();
+            if (nee) [&] {
+                // Sample a light
+                const auto sL = scene_->sample_direct_light(rng, s->sp);
+                if (!sL) {
+                    return;
+                }
+                if (!scene_->visible(s->sp, sL->sp)) {
+                    return;
                 }
 
-                // --------------------------------------------------------------------------------
+                // Recompute raster position for the primary edge
+                const auto rp = [&]() -> std::optional<Vec2> {
+                    if (length == 0)
+                        return scene_->raster_position(-sL->wo, view.film->aspect_ratio(), camera);
+                    else
+                        return raster_pos;
+                }();
+                if (!rp) {
+                    return;
+                }
 
-                // Sample a NEE edge
-                const bool nee = [&]() {
-                    // Ignore NEE edge with naive direct sampling mode
-                    if (pt_mode_ == PTMode::Naive) {
-                        return false;
-                    }
-                    // NEE edge can be samplable if current direction sampler
-                    // (according to BSDF / phase) doesn't contain delta component.
-                    if (image_sample_mode_ == ImageSampleMode::Pixel) {
-                        // Primary ray is not samplable via NEE in the pixel space sample mode
-                        return length > 0 && !scene_->is_specular(s->sp, s->comp);
+                // This light is not samplable by direct strategy
+                // if the light contain delta component or degenerated.
+                const bool directL = !scene_->is_specular(sL->sp, sL->comp) && !sL->sp.geom.degenerated;
+
+                // Evaluate and accumulate contribution
+                const auto wo = -sL->wo;
+                const auto fs = scene_->eval_contrb(s->sp, s->comp, wi, wo);
+                const auto pdf_sel = scene_->pdf_comp(s->sp, s->comp, wi);
+                const auto misw = [&]() -> Float {
+                    if (pt_mode_ == PTMode::NEE) {
+                        return 1_f;
                     }
-                    else {
-                        // Primary ray is samplable via NEE in the image space sample mode
-                        return !scene_->is_specular(s->sp, s->comp);
+                    if (!directL) {
+                        return 1_f;
                     }
+                    // Compute MIS weight only when wo can be sampled with both strategies.
+                    return math::balance_heuristic(
+                        scene_->pdf_direct_light(s->sp, sL->sp, sL->comp, sL->wo), 
+                        pdf_dir(wo));
                 }();
-                if (nee) [&] {
-                    // Sample a light
-                    const auto sL = scene_->sample_direct_light(rng, s->sp);
-                    if (!sL) {
-                        return;
-                    }
-                    if (!scene_->visible(s->sp, sL->sp)) {
-                        return;
-                    }
-
-                    // Recompute raster position for the primary edge
-                    const auto rp = [&]() -> std::optional<Vec2> {
-                        if (length == 0)
-                            return scene_->raster_position(-sL->wo, film_->aspect_ratio());
-                        else
-                            return raster_pos;
-                    }();
-                    if (!rp) {
-                        return;
-                    }
+                const auto C = throughput / pdf_sel * fs * sL->weight * misw;
+                accumulate(*rp, C);
+            }();
 
-                    // This light is not samplable by direct strategy
-                    // if the light contain delta component or degenerated.
-                    const bool directL = !scene_->is_specular(sL->sp, sL->comp) && !sL->sp.geom.degenerated;
-
-                    // Evaluate and accumulate contribution
-                    const auto wo = -sL->wo;
-                    const auto fs = scene_->eval_contrb(s->sp, s->comp, wi, wo);
-                    const auto pdf_sel = scene_->pdf_comp(s->sp, s->comp, wi);
-                    const auto misw = [&]() -> Float {
-                        if (pt_mode_ == PTMode::NEE) {
-                            return 1_f;
-                        }
-                        if (!directL) {
-                            return 1_f;
-                        }
-                        // Compute MIS weight only when wo can be sampled with both strategies.
-                        return math::balance_heuristic(
-                            scene_->pdf_direct_light(s->sp, sL->sp, sL->comp, sL->wo), 
-                            scene_->pdf(s->sp, s->comp, wi, wo));
-                    }();
-                    const auto C = throughput / pdf_sel * fs * sL->weight * misw;
-                    film_->splat(*rp, C);
-                }();
+            // --------------------------------------------------------------------------------
 
-                // --------------------------------------------------------------------------------
+            // Intersection to next surface
+            auto hit = scene_->intersect(s->ray());
+            if (!hit) {
+                break;
+            }
 
-                // Intersection to next surface
-                const auto hit = scene_->intersect(s->ray());
-                if (!hit) {
-                    break;
+            // Footprint of the texture lookup at the next surface.
+            // The cone is projected onto the surface and converted to the length in texture space.
+            // The texture density is zero unless the material of the surface is textured.
+            if (!hit->geom.infinite) {
+                cone_width += cone_spread * glm::distance(s->sp.geom.p, hit->geom.p);
+                if (const auto density = scene_->texture_density(*hit); density > 0_f) {
+                    const auto cos = std::max(.1_f, std::abs(glm::dot(hit->geom.n, s->wo)));
+                    hit->geom.t_footprint = cone_width * density / cos;
                 }
+            }
 
-                // --------------------------------------------------------------------------------
+            // --------------------------------------------------------------------------------
 
-                // Update throughput
-                throughput *= s->weight;
+            // Update throughput
+            throughput *= s->weight;
 
-                // --------------------------------------------------------------------------------
+            // Record the vertex for training
+            if (training && guidable) {
+                const auto pdf = pdf_dir(s->wo) * std::abs(glm::dot(s->sp.geom.n, s->wo));
+                vertices.push_back({ s->sp.geom.p, s->wo, pdf, throughput, Vec3(0_f) });
+            }
 
-                // Accumulate contribution from light
-                const bool direct = [&]() -> bool {
-                    // Direct strategy is samplable if the ray hit with light
-                    if (pt_mode_ == PTMode::NEE) {
-                        // In NEE mode, use direct strategy only when a NEE edge cannot be sampled.
-                        return !nee && scene_->is_light(*hit);
+            // --------------------------------------------------------------------------------
+
+            // Accumulate contribution from light
+            const bool direct = [&]() -> bool {
+                // Direct strategy is samplable if the ray hit with light
+                if (pt_mode_ == PTMode::NEE) {
+                    // In NEE mode, use direct strategy only when a NEE edge cannot be sampled.
+                    return !nee && scene_->is_light(*hit);
+                }
+                else {
+                    return scene_->is_light(*hit);
+                }
+            }();
+            if (direct) {
+                const auto woL = -s->wo;
+                const auto fs = scene_->eval_contrb_endpoint(*hit, woL);
+                const auto misw = [&]() -> Float {
+                    if (pt_mode_ == PTMode::Naive) {
+                        return 1_f;
                     }
-                    else {
-                        return scene_->is_light(*hit);
+                    if (!nee) {
+                        return 1_f;
                     }
+                    // The continuation edge can be sampled via both direct and NEE
+                    return math::balance_heuristic(
+                        pdf_dir(s->wo),
+                        scene_->pdf_direct_light(s->sp, *hit, -1, woL));
                 }();
-                if (direct) {
-                    const auto woL = -s->wo;
-                    const auto fs = scene_->eval_contrb_endpoint(*hit, woL);
-                    const auto misw = [&]() -> Float {
-                        if (pt_mode_ == PTMode::Naive) {
-                            return 1_f;
-                        }
-                        if (!nee) {
-                            return 1_f;
-                        }
-                        // The continuation edge can be sampled via both direct and NEE
-                        return math::balance_heuristic(
-                            scene_->pdf(s->sp, s->comp, wi, s->wo),
-                            scene_->pdf_direct_light(s->sp, *hit, -1, woL));
-                    }();
-                    const auto C = throughput * fs * misw;
-                    film_->splat(raster_pos, C);
-                }
-
-                // --------------------------------------------------------------------------------
-
-                // Russian roulette
-                if (length > 3) {
-                    const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
-                    if (rng.u() < q) {
-                        break;
-                    }
-                    throughput /= 1_f - q;
+                const auto C = throughput * fs * misw;
+                accumulate(raster_pos, C);
+            }
+
+            // --------------------------------------------------------------------------------
+
+            // Russian roulette
+            if (length > 3) {
+                const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
+                if (rng.u() < q) {
+                    break;
                 }
+                throughput /= 1_f - q;
+            }
+
+            // --------------------------------------------------------------------------------
 
-                // --------------------------------------------------------------------------------
+            // Update
+            wi = -s->wo;
+            sp = *hit;
+        }
 
-                // Update
-                wi = -s->wo;
-                sp = *hit;
+        // Record the incident radiance estimated for the vertices.
+        // The distributions are proportional to the sum of radiance divided by the pdf.
+        for (const auto& v : vertices) {
+            if (v.pdf > 0_f) {
+                stree->record(v.p, v.wo, (v.radiance.x + v.radiance.y + v.radiance.z) / (3_f * v.pdf));
             }
+        }
+    }
+
+    // Bound of the scene in world space
+    Bound scene_bound() const {
+        Bound bound;
+        scene_->traverse_primitive_nodes([&](const SceneNode& node, Mat4 global_transform) {
+            if (node.type != SceneNodeType::Primitive) {
+                return;
+            }
+            if (!node.primitive.mesh) {
+                return;
+            }
+            node.primitive.mesh->foreach_triangle([&](int, const Mesh::Tri& tri) {
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p1.p, 1_f)));
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p2.p, 1_f)));
+                bound = merge(bound, Vec3(global_transform * Vec4(tri.p3.p, 1_f)));
+            });
         });
+        if (bound.min.x > bound.max.x) {
+            bound = merge(merge(bound, Vec3(-1_f)), Vec3(1_f));
+        }
+        return bound;
+    }
 
-        // ----------------------------------------------------------------------------------------
-        
-        // Rescale film
-        if (image_sample_mode_ == ImageSampleMode::Pixel) {
-            film_->rescale(1_f / processed);
+    // Find the node index of the camera in the scene
+    int camera_node(const Camera* camera) const {
+        int index = -1;
+        scene_->traverse_primitive_nodes([&](const SceneNode& node, Mat4) {
+            if (node.type == SceneNodeType::Primitive && node.primitive.camera == camera) {
+                index = node.index;
+            }
+        });
+        if (index < 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument,
+                "Camera is not a primitive of the scene [camera='{}']", camera->loc());
         }
-        else {
-            film_->rescale(Float(size.w * size.h) / processed);
+        return index;
+    }
+
+    // Add AOV channel to the film
+    int add_aov(Film* film, const std::string& name, int components) {
+        const int index = film->add_aov(name, components);
+        if (index < 0) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Film does not support AOVs [name='{}']", name);
         }
+        return index;
     }
 };
 
@@ -21,11 +21,12 @@ private:
     bool use_constant_color_;
     bool visualize_normal_;
     std::optional<Vec3> color_;
+    bool accumulate_;       // Accumulate samples to the film of the previous rendering
     Component::Ptr<scheduler::Scheduler> sched_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(scene_, film_, bg_color_, use_constant_color_, visualize_normal_, sched_);
+        ar(scene_, film_, bg_color_, use_constant_color_, visualize_normal_, accumulate_, sched_);
     }
 
     virtual void foreach_underlying(const ComponentVisitor& visit) override {
@@ -48,6 +49,7 @@ public:
         use_constant_color_ = json::value(prop, "use_constant_color", false);
         visualize_normal_ = json::value(prop, "visualize_normal", false);
         color_ = json::value_or_none<Vec3>(prop, "color");
+        accumulate_ = json::value(prop, "accumulate", false);
         film_ = json::comp_ref<Film>(prop, "output");
         sched_ = comp::create<scheduler::Scheduler>(
             "scheduler::spp::sample", make_loc("scheduler"), {
@@ -61,19 +63,31 @@ public:
 		scene_->require_accel();
 		scene_->require_camera();
 
-        film_->clear();
+        // Clear film unless the samples are accumulated to the previous result
+        if (!accumulate_ || film_->weight() == 0) {
+            film_->clear();
+        }
         const auto size = film_->size();
-        sched_->run([&](long long index, long long, int) {
+        const auto aspect_ratio = film_->aspect_ratio();
+        const auto write_pixel = [&](int x, int y, Vec3 C) {
+            if (accumulate_) {
+                film_->splat_pixel(x, y, C);
+            }
+            else {
+                film_->set_pixel(x, y, C);
+            }
+        };
+        const auto process_pixel = [&](long long index) {
             const int x = int(index % size.w);
             const int y = int(index / size.w);
-            const auto ray = scene_->primary_ray({(x+.5_f)/size.w, (y+.5_f)/size.h}, film_->aspect_ratio());
+            const auto ray = scene_->primary_ray({(x+.5_f)/size.w, (y+.5_f)/size.h}, aspect_ratio);
             const auto sp = scene_->intersect(ray);
             if (!sp) {
-                film_->set_pixel(x, y, bg_color_);
+                write_pixel(x, y, bg_color_);
                 return;
             }
             if (visualize_normal_) {
-                film_->set_pixel(x, y, glm::abs(sp->geom.n));
+                write_pixel(x, y, glm::abs(sp->geom.n));
             }
             else {
                 const auto R = color_ ? *color_ : scene_->reflectance(*sp, -1);
@@ -81,9 +95,17 @@ public:
                 if (!use_constant_color_) {
                     C *= .2_f + .8_f*glm::abs(glm::dot(sp->geom.n, -ray.d));
                 }
-                film_->set_pixel(x, y, C);
+                write_pixel(x, y, C);
+            }
+        };
+        const auto processed = sched_->run_range([&](long long pixel_begin, long long pixel_end, long long, long long, int) {
+            for (long long index = pixel_begin; index < pixel_end; index++) {
+                process_pixel(index);
             }
         });
+        if (accumulate_) {
+            film_->add_weight(Float(processed));
+        }
     }
 };
 
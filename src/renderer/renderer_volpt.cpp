@@ -9,6 +9,8 @@
 #include <lm/scene.h>
 #include <lm/film.h>
 #include <lm/scheduler.h>
+#include <lm/parallel.h>
+#include <lm/sampler.h>
 
 #define VOLPT_DEBUG_VIS 0
 #define VOLPT_IMAGE_SAMPLNG 0
@@ -22,7 +24,10 @@ private:
     int max_length_;
     Float rr_prob_;
     std::optional<unsigned int> seed_;
+    bool accumulate_;       // Accumulate samples to the film of the previous rendering
+    mutable long long next_sample_ = 0;     // Index of the first sample in the next accumulated rendering
     Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;   // Sampler for the random numbers. nullptr if not specified.
 
     #if VOLPT_DEBUG_VIS
     mutable std::vector<Ray> sampledRays_;
@@ -30,7 +35,7 @@ private:
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(scene_, film_, max_length_, rr_prob_, sched_);
+        ar(scene_, film_, max_length_, rr_prob_, accumulate_, next_sample_, sched_, sampler_);
         #if VOLPT_DEBUG_VIS
         ar(sampledRays_);
         #endif
@@ -40,6 +45,7 @@ public:
         comp::visit(visit, scene_);
         comp::visit(visit, film_);
         comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
     }
 
     #if VOLPT_DEBUG_VIS
@@ -58,6 +64,10 @@ public:
         max_length_ = json::value<int>(prop, "max_length");
         seed_ = json::value_or_none<unsigned int>(prop, "seed");
         rr_prob_ = json::value<Float>(prop, "rr_prob", .2_f);
+        accumulate_ = json::value(prop, "accumulate", false);
+        if (const auto sampler_name = json::value_or_none<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *sampler_name, make_loc("sampler"), prop);
+        }
         const auto sched_name = json::value<std::string>(prop, "scheduler");
         #if VOLPT_IMAGE_SAMPLNG
         sched_ = comp::create<scheduler::Scheduler>(
@@ -71,11 +81,31 @@ public:
     virtual void render() const override {
 		scene_->require_renderable();
 
-        film_->clear();
+        // Clear film unless the samples are accumulated to the previous result
+        if (!accumulate_ || film_->weight() == 0) {
+            film_->clear();
+            next_sample_ = 0;
+        }
         const auto size = film_->size();
-        const auto processed = sched_->run([&](long long pixel_index, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rng_seed());
+        // Seed of the random number generator and index of the first sample.
+        // When accumulating, the sample indices continue from the previous rendering.
+        // The index is tracked separately from the weight of the film
+        // because a cancelled rendering might use more sample indices than the processed samples.
+        const auto seed = seed_ ? *seed_ : math::rng_seed();
+        const auto sample_offset = next_sample_;
+
+        // Index next to the last sample processed in each thread
+        std::vector<long long> sample_ends(parallel::num_threads(), 0);
+
+        const auto processed = sched_->run([&](long long pixel_index, long long sample_index, int threadid) {
+            if (sample_index >= sample_ends[threadid]) {
+                sample_ends[threadid] = sample_index + 1;
+            }
+
+            // Random number generator for the sample.
+            // The random numbers are determined by the pixel and sample indices
+            // independently of the thread processing the sample.
+            Rng rng(seed, pixel_index, sample_offset + sample_index, sampler_.get());
 
             #if VOLPT_IMAGE_SAMPLNG
             LM_UNUSED(pixelIndex);
@@ -180,11 +210,25 @@ public:
             }
         });
 
+        next_sample_ = sample_offset + *std::max_element(sample_ends.begin(), sample_ends.end());
+
+        // Rescale film.
+        // The number of processed samples can be zero if the rendering is cancelled.
+        if (processed == 0) {
+            return;
+        }
         #if VOLPT_IMAGE_SAMPLNG
-        film_->rescale(Float(size.w* size.h) / processed);
+        const auto weight = Float(processed) / (size.w* size.h);
         #else
-        film_->rescale(1_f / processed);
+        const auto weight = Float(processed);
         #endif
+        if (accumulate_) {
+            // Keep unnormalized sum in the film
+            film_->add_weight(weight);
+        }
+        else {
+            film_->rescale(1_f / weight);
+        }
     }
 };
 
@@ -9,6 +9,7 @@
 #include <lm/scene.h>
 #include <lm/film.h>
 #include <lm/scheduler.h>
+#include <lm/parallel.h>
 #include <lm/debug.h>
 
 #define VOLPT_IMAGE_SAMPLNG 0
@@ -22,11 +23,13 @@ private:
     int max_length_;
     Float rr_prob_;
     std::optional<unsigned int> seed_;
+    bool accumulate_;       // Accumulate samples to the film of the previous rendering
+    mutable long long next_sample_ = 0;     // Index of the first sample in the next accumulated rendering
     Component::Ptr<scheduler::Scheduler> sched_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(scene_, film_, max_length_, rr_prob_, sched_);
+        ar(scene_, film_, max_length_, rr_prob_, accumulate_, next_sample_, sched_);
     }
 
     virtual void foreach_underlying(const ComponentVisitor& visit) override {
@@ -41,6 +44,7 @@ public:
         film_ = json::comp_ref<Film>(prop, "output");
         max_length_ = json::value<int>(prop, "max_length");
         rr_prob_ = json::value<Float>(prop, "rr_prob", .2_f);
+        accumulate_ = json::value(prop, "accumulate", false);
         const auto sched_name = json::value<std::string>(prop, "scheduler");
         seed_ = json::value_or_none<unsigned int>(prop, "seed");
         #if VOLPT_IMAGE_SAMPLNG
@@ -55,11 +59,31 @@ public:
     virtual void render() const override {
 		scene_->require_renderable();
 
-        film_->clear();
+        // Clear film unless the samples are accumulated to the previous result
+        if (!accumulate_ || film_->weight() == 0) {
+            film_->clear();
+            next_sample_ = 0;
+        }
         const auto size = film_->size();
-        const auto processed = sched_->run([&](long long pixel_index, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rng_seed());
+        // Seed of the random number generator and index of the first sample.
+        // When accumulating, the sample indices continue from the previous rendering.
+        // The index is tracked separately from the weight of the film
+        // because a cancelled rendering might use more sample indices than the processed samples.
+        const auto seed = seed_ ? *seed_ : math::rng_seed();
+        const auto sample_offset = next_sample_;
+
+        // Index next to the last sample processed in each thread
+        std::vector<long long> sample_ends(parallel::num_threads(), 0);
+
+        const auto processed = sched_->run([&](long long pixel_index, long long sample_index, int threadid) {
+            if (sample_index >= sample_ends[threadid]) {
+                sample_ends[threadid] = sample_index + 1;
+            }
+
+            // Random number generator for the sample.
+            // The random numbers are determined by the pixel and sample indices
+            // independently of the thread processing the sample.
+            Rng rng(seed, pixel_index, sample_offset + sample_index);
 
             #if VOLPT_IMAGE_SAMPLNG
             LM_UNUSED(pixelIndex);
@@ -128,11 +152,25 @@ public:
             film_->splat(rasterPos, L);
         });
 
+        next_sample_ = sample_offset + *std::max_element(sample_ends.begin(), sample_ends.end());
+
+        // Rescale film.
+        // The number of processed samples can be zero if the rendering is cancelled.
+        if (processed == 0) {
+            return;
+        }
         #if VOLPT_IMAGE_SAMPLNG
-        film_->rescale(Float(size.w * size.h) / processed);
+        const auto weight = Float(processed) / (size.w * size.h);
         #else
-        film_->rescale(1_f / processed);
+        const auto weight = Float(processed);
         #endif
+        if (accumulate_) {
+            // Keep unnormalized sum in the film
+            film_->add_weight(weight);
+        }
+        else {
+            film_->rescale(1_f / weight);
+        }
     }
 };
 
@@ -0,0 +1,15 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/sampler.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::detail)
+
+LM_PUBLIC_API Float sampler_u(const Sampler* sampler, long long pixel_index, long long sample_index, int dim) {
+    return sampler->u(pixel_index, sample_index, dim);
+}
+
+LM_NAMESPACE_END(LM_NAMESPACE::detail)
@@ -0,0 +1,294 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/sampler.h>
+#include <lm/film.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Hash function for 64-bit integers (finalizer of SplitMix64)
+uint64_t hash64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint32_t reverse_bits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// First two dimensions of Sobol sequence.
+// The first dimension is van der Corput sequence.
+uint32_t sobol(uint32_t index, int dim) {
+    if (dim == 0) {
+        return reverse_bits(index);
+    }
+    uint32_t v = 1u << 31;
+    uint32_t result = 0;
+    for (; index; index >>= 1, v ^= v >> 1) {
+        if (index & 1) {
+            result ^= v;
+        }
+    }
+    return result;
+}
+
+// Hash-based Owen scrambling [Burley2020].
+// This function is equivalent to nested uniform scrambling
+// where the flip of each bit depends on the higher bits.
+uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+// Padded Owen-scrambled Sobol sequence [Burley2020].
+// Dimensions are grouped into pairs of the 2D Sobol sequence
+// and the pairs are decorrelated by scrambling the sample index with different seeds.
+uint32_t owen_scrambled_sobol(uint32_t sample_index, int dim, uint64_t seed) {
+    const auto pair_seed = hash64(seed ^ hash64(uint64_t(dim / 2)));
+    const auto index = nested_uniform_scramble(sample_index, uint32_t(pair_seed));
+    return nested_uniform_scramble(sobol(index, dim % 2), uint32_t(pair_seed >> 32) + uint32_t(dim % 2));
+}
+
+// Convert 32-bit integer to a floating point value in [0,1)
+Float to_float(uint32_t x) {
+    if constexpr (std::is_same_v<Float, float>) {
+        return float(x >> 8) * 0x1p-24f;
+    }
+    else {
+        return Float(x) * Float(0x1p-32);
+    }
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: sampler::sobol
+
+   Owen-scrambled Sobol sampler.
+
+   :param int seed: Seed of the scrambling. Default is 0.
+
+   This component generates the padded Owen-scrambled Sobol sequence [Burley2020]_.
+   Each pair of dimensions forms a 2D Sobol sequence scrambled by nested uniform scrambling,
+   so that the samples of a pixel are stratified in every pair of dimensions
+   for any number of samples.
+   The scrambling is randomized per pixel.
+
+   .. [Burley2020] B. Burley. Practical hash-based Owen scrambling.
+                   Journal of Computer Graphics Techniques, 9(4), 2020.
+
+.. function:: sampler::sobol_bluenoise
+
+   Owen-scrambled Sobol sampler with blue noise dithering.
+
+   :param int seed: Seed of the scrambling and the dither mask. Default is 0.
+   :param str output: Locator of the film to obtain the pixel coordinates.
+
+   This component distributes the error between neighboring pixels as blue noise,
+   which is perceptually less visible than white noise at low sample counts.
+   All pixels share the same Owen-scrambled Sobol sequence as :func:`sampler::sobol`
+   and each pixel shifts the sequence with the value of a blue noise dither mask
+   (Cranley-Patterson rotation) [Georgiev2016]_.
+   The dither mask of 64x64 pixels is generated by void-and-cluster method [Ulichney1993]_
+   on construction, and tiled over the film with a different offset per dimension.
+
+   .. [Georgiev2016] I. Georgiev and M. Fajardo. Blue-noise dithered sampling.
+                     ACM SIGGRAPH 2016 Talks, 2016.
+   .. [Ulichney1993] R. Ulichney. Void-and-cluster method for dither array generation.
+                     Proc. SPIE 1913, 1993.
+\endrst
+*/
+class Sampler_Sobol final : public Sampler {
+private:
+    uint64_t seed_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_);
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        seed_ = json::value<uint64_t>(prop, "seed", 0);
+    }
+
+    virtual Float u(long long pixel_index, long long sample_index, int dim) const override {
+        const auto seed = hash64(seed_ ^ hash64(uint64_t(pixel_index)));
+        return to_float(owen_scrambled_sobol(uint32_t(sample_index), dim, seed));
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_Sobol, "sampler::sobol");
+
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+
+// Generate blue noise dither mask with void-and-cluster method [Ulichney1993].
+// Returns the ranks of the pixels in [0,size*size) arranged in the tile of size*size.
+std::vector<int> void_and_cluster(int size, uint64_t seed) {
+    const int n = size * size;
+    const Float sigma = 1.5_f;
+
+    // Gaussian filter on the torus
+    std::vector<Float> kernel(n);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const int dx = std::min(x, size - x);
+            const int dy = std::min(y, size - y);
+            kernel[y*size + x] = std::exp(-Float(dx*dx + dy*dy) / (2_f*sigma*sigma));
+        }
+    }
+
+    // Energy of the binary pattern, i.e., the pattern filtered by the Gaussian
+    std::vector<Float> energy(n, 0_f);
+    std::vector<bool> on(n, false);
+    const auto toggle = [&](int i) {
+        on[i] = !on[i];
+        const Float sign = on[i] ? 1_f : -1_f;
+        const int x0 = i % size;
+        const int y0 = i / size;
+        for (int y = 0; y < size; y++) {
+            const int ky = (y - y0 + size) % size;
+            for (int x = 0; x < size; x++) {
+                energy[y*size + x] += sign * kernel[ky*size + (x - x0 + size) % size];
+            }
+        }
+    };
+    const auto tightest_cluster = [&]() {
+        int result = -1;
+        for (int i = 0; i < n; i++) {
+            if (on[i] && (result < 0 || energy[i] > energy[result])) {
+                result = i;
+            }
+        }
+        return result;
+    };
+    const auto largest_void = [&]() {
+        int result = -1;
+        for (int i = 0; i < n; i++) {
+            if (!on[i] && (result < 0 || energy[i] < energy[result])) {
+                result = i;
+            }
+        }
+        return result;
+    };
+
+    // Initial binary pattern with randomly placed points
+    const int num_initial = n / 10;
+    Rng rng(int(seed & 0x7fffffff));
+    for (int count = 0; count < num_initial;) {
+        const int i = std::min(int(rng.u() * n), n - 1);
+        if (!on[i]) {
+            toggle(i);
+            count++;
+        }
+    }
+
+    // Distribute the initial points uniformly by moving
+    // the point in the tightest cluster to the largest void
+    for (int iter = 0; iter < n; iter++) {
+        const int c = tightest_cluster();
+        toggle(c);
+        const int v = largest_void();
+        toggle(v);
+        if (c == v) {
+            break;
+        }
+    }
+
+    std::vector<int> rank(n);
+
+    // Phase 1. Rank the initial points by removing the tightest clusters
+    {
+        const auto on_initial = on;
+        const auto energy_initial = energy;
+        for (int r = num_initial - 1; r >= 0; r--) {
+            const int c = tightest_cluster();
+            toggle(c);
+            rank[c] = r;
+        }
+        on = on_initial;
+        energy = energy_initial;
+    }
+
+    // Phase 2 and 3. Rank the remaining points by filling the largest voids
+    for (int r = num_initial; r < n; r++) {
+        const int v = largest_void();
+        toggle(v);
+        rank[v] = r;
+    }
+
+    return rank;
+}
+
+}
+
+// Owen-scrambled Sobol sampler with blue noise dithering.
+// See the documentation of sampler::sobol.
+class Sampler_SobolBlueNoise final : public Sampler {
+private:
+    static constexpr int MaskSize = 64;
+
+private:
+    uint64_t seed_;
+    Film* film_;
+    std::vector<uint32_t> mask_;    // Dither mask in 32-bit fixed point
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_, film_, mask_);
+    }
+
+    virtual void foreach_underlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, film_);
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        seed_ = json::value<uint64_t>(prop, "seed", 0);
+        film_ = json::comp_ref<Film>(prop, "output");
+        const auto rank = void_and_cluster(MaskSize, seed_);
+        mask_.resize(rank.size());
+        for (size_t i = 0; i < rank.size(); i++) {
+            // Map rank to the center of the stratum
+            mask_[i] = uint32_t((uint64_t(2*rank[i] + 1) << 32) / (2*rank.size()));
+        }
+    }
+
+    virtual Float u(long long pixel_index, long long sample_index, int dim) const override {
+        // Offset of the tile for the dimension
+        const auto h = hash64(seed_ ^ hash64(uint64_t(dim) + 1));
+        const int w = film_->size().w;
+        const int x = int((pixel_index % w + (h & 0xffff)) % MaskSize);
+        const int y = int((pixel_index / w + ((h >> 16) & 0xffff)) % MaskSize);
+
+        // Rotate the sample by the value of the mask, where the addition wraps around in [0,1)
+        const auto v = owen_scrambled_sobol(uint32_t(sample_index), dim, seed_);
+        return to_float(v + mask_[y*MaskSize + x]);
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_SobolBlueNoise, "sampler::sobol_bluenoise");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
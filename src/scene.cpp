@@ -306,7 +306,7 @@ public:
         const auto [t, uv, global_transform, primitiveIndex, faceIndex] = *hit;
         const auto& primitive = nodes_.at(primitiveIndex).primitive;
         const auto p = primitive.mesh->surface_point(faceIndex, uv);
-        return SceneInteraction::make_surface_interaction(
+        auto si = SceneInteraction::make_surface_interaction(
             primitiveIndex,
             PointGeometry::make_on_surface(
                 global_transform.M * Vec4(p.p, 1_f),
@@ -314,6 +314,31 @@ public:
                 p.t
             )
         );
+        si.face = faceIndex;
+        si.face_M = Mat3(global_transform.M);
+        return si;
+    }
+
+    // Ratio between the lengths in texture space and in world space of the triangle,
+    // computed from the square root of the ratio of the areas.
+    virtual Float texture_density(const SceneInteraction& sp) const override {
+        if (sp.face < 0 || sp.medium || sp.endpoint) {
+            return 0_f;
+        }
+        const auto& primitive = nodes_.at(sp.primitive).primitive;
+        if (!primitive.material || !primitive.material->is_textured()) {
+            return 0_f;
+        }
+        const auto tri = primitive.mesh->triangle_at(sp.face);
+        const auto& M = sp.face_M;
+        const auto world_area = glm::length(glm::cross(M * (tri.p2.p - tri.p1.p), M * (tri.p3.p - tri.p1.p)));
+        if (world_area == 0_f) {
+            return 0_f;
+        }
+        const auto t1 = tri.p2.t - tri.p1.t;
+        const auto t2 = tri.p3.t - tri.p1.t;
+        const auto texture_area = std::abs(t1.x*t2.y - t1.y*t2.x);
+        return std::sqrt(texture_area / world_area);
     }
 
     // --------------------------------------------------------------------------------------------
@@ -344,8 +369,8 @@ public:
 
     // --------------------------------------------------------------------------------------------
 
-    virtual Ray primary_ray(Vec2 rp, Float aspect_ratio) const {
-        return nodes_.at(*camera_).primitive.camera->primary_ray(rp, aspect_ratio);
+    virtual Ray primary_ray(Vec2 rp, Float aspect_ratio, int camera) const override {
+        return camera_at(camera)->primary_ray(rp, aspect_ratio);
     }
 
     virtual std::optional<RaySample> sample_ray(Rng& rng, const SceneInteraction& sp, Vec3 wi) const override {
@@ -364,15 +389,16 @@ public:
             };
         }
         else if (sp.terminator && sp.terminator == TerminatorType::Camera) {
-            // Endpoint
-            const auto* camera = nodes_.at(*camera_).primitive.camera;
+            // Endpoint. The camera is specified by the primitive index of the terminator.
+            const int index = sp.primitive >= 0 ? sp.primitive : *camera_;
+            const auto* camera = camera_at(index);
             const auto s = camera->sample_primary_ray(rng, sp.cameraCond.window, sp.cameraCond.aspect_ratio);
             if (!s) {
                 return {};
             }
             return RaySample{
                 SceneInteraction::make_camera_endpoint(
-                    *camera_,
+                    index,
                     s->geom,
                     sp.cameraCond.window,
                     sp.cameraCond.aspect_ratio
@@ -430,9 +456,8 @@ public:
         }
     }
 
-    virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio) const override {
-        const auto* camera = nodes_.at(*camera_).primitive.camera;
-        return camera->raster_position(wo, aspect_ratio);
+    virtual std::optional<Vec2> raster_position(Vec3 wo, Float aspect_ratio, int camera) const override {
+        return camera_at(camera)->raster_position(wo, aspect_ratio);
     }
 
     virtual std::optional<RaySample> sample_direct_light(Rng& rng, const SceneInteraction& sp) const override {
@@ -573,6 +598,16 @@ public:
         }
         return primitive.material->reflectance(sp.geom, comp);
     }
+
+private:
+    // Get camera of the node. -1 to use the camera of the scene.
+    const Camera* camera_at(int index) const {
+        const auto* camera = nodes_.at(index >= 0 ? index : *camera_).primitive.camera;
+        if (!camera) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Node is not a camera [index={}]", index);
+        }
+        return camera;
+    }
 };
 
 LM_COMP_REG_IMPL(Scene_, "scene::default");
@@ -6,6 +6,7 @@
 #include <pch.h>
 #include <lm/scheduler.h>
 #include <lm/json.h>
+#include <lm/logger.h>
 #include <lm/parallel.h>
 #include <lm/progress.h>
 #include <lm/serial.h>
@@ -13,15 +14,62 @@
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE::scheduler)
 
-// Sample-based SPPScheduler
+namespace {
+
+// Partition of the work processed in this process
+int partition_index_ = 0;
+int partition_count_ = 1;
+
+// Check if the range starting from begin is assigned to the partition
+bool in_partition(long long begin, long long grain) {
+    return partition_count_ == 1 || (begin / grain) % partition_count_ == partition_index_;
+}
+
+// Dispatch per-sample callback using range-based loop of the scheduler
+long long run_per_sample(const Scheduler& sched, const Scheduler::ProcessFunc& process) {
+    return sched.run_range([&](long long pixel_begin, long long pixel_end, long long sample_begin, long long sample_end, int threadid) {
+        for (long long pixel_index = pixel_begin; pixel_index < pixel_end; pixel_index++) {
+            for (long long sample_index = sample_begin; sample_index < sample_end; sample_index++) {
+                process(pixel_index, sample_index, threadid);
+            }
+        }
+    });
+}
+
+// Number of pixels in a range processing the given number of samples per pixel.
+// The range contains about grain pixel samples so that the number of ranges
+// does not decrease as the number of samples per pixel increases.
+long long pixel_grain(long long grain, long long samples) {
+    return std::max(1LL, grain / std::max(1LL, samples));
+}
+
+// Elapsed time from the given time point in seconds
+double elapsed_since(std::chrono::high_resolution_clock::time_point start) {
+    using namespace std::chrono;
+    const auto curr = high_resolution_clock::now();
+    return (double)(duration_cast<milliseconds>(curr - start).count()) / 1000.0;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Sample-based SPPScheduler.
+// The scheduler processes the samples in passes, where each pass processes
+// pass_spp samples for all pixels, and cancellation is checked between the passes
+// to keep the same number of samples for all pixels.
+// Unless pass_spp is specified, an ordinary rendering is processed in a single pass
+// keeping the samples of a pixel together, and run_passes() processes a sample per pixel in a pass.
 class Scheduler_SPP_Sample : public Scheduler {
 private:
     long long spp_;
+    long long grain_;       // Number of pixel samples processed in a range
+    long long pass_spp_;    // Number of samples per pixel in a pass. 0 if not specified.
     Film* film_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(spp_, film_);
+        ar(spp_, grain_, pass_spp_, film_);
     }
 
     virtual void foreach_underlying(const ComponentVisitor& visit) override {
@@ -31,21 +79,57 @@ public:
 public:
     virtual void construct(const Json& prop) override {
         spp_ = json::value<long long>(prop, "spp");
+        grain_ = json::value<long long>(prop, "grain", 64);
+        pass_spp_ = json::value<long long>(prop, "pass_spp", 0);
         film_ = json::comp_ref<Film>(prop, "output");
     }
 
     virtual long long run(const ProcessFunc& process) const override {
-        const auto numPixels = film_->num_pixels();
-        progress::ScopedReport progress_ctx_(numPixels * spp_);
-        
-        // Parallel loop for each pixel
-        parallel::foreach(numPixels * spp_, [&](long long index, int threadid) {
-            process(index / spp_, index % spp_, threadid);
-        }, [&](long long processed) {
-            progress::update(processed);
-        });
+        return run_per_sample(*this, process);
+    }
 
-        return spp_;
+    virtual long long run_passes(const ProcessRangeFunc& process, const PassFunc& on_pass, long long processed) const override {
+        return run_in_passes(process, on_pass, processed, pass_spp_ > 0 ? pass_spp_ : 1);
+    }
+
+    virtual long long run_range(const ProcessRangeFunc& process) const override {
+        // Dispatch in passes so that the returned number of samples is exact for all pixels
+        // even if the rendering is cancelled.
+        return run_in_passes(process, {}, 0, pass_spp_ > 0 ? pass_spp_ : spp_);
+    }
+
+private:
+    long long run_in_passes(const ProcessRangeFunc& process, const PassFunc& on_pass, long long processed, long long pass_spp) const {
+        const auto num_pixels = film_->num_pixels();
+        progress::ScopedReport progress_ctx_(num_pixels * spp_);
+        progress::update(num_pixels * std::min(processed, spp_));
+
+        while (processed < spp_) {
+            // Check cancellation.
+            // A pass is never interrupted because its samples are already recorded in the film.
+            if (parallel::cancel_token().cancelled()) {
+                LM_WARN("Rendering is cancelled [spp={}]", processed);
+                break;
+            }
+
+            // Parallel loop for each range of pixels
+            const auto sample_end = std::min(processed + pass_spp, spp_);
+            const auto grain = pixel_grain(grain_, sample_end - processed);
+            parallel::foreach_range(num_pixels, grain, [&](long long begin, long long end, int threadid) {
+                if (in_partition(begin, grain)) {
+                    process(begin, end, processed, sample_end, threadid);
+                }
+            }, [&](long long processed_pixels) {
+                progress::update(num_pixels * processed + processed_pixels * (sample_end - processed));
+            });
+
+            processed = sample_end;
+            if (on_pass) {
+                on_pass(processed);
+            }
+        }
+
+        return processed;
     }
 };
 
@@ -53,15 +137,19 @@ LM_COMP_REG_IMPL(Scheduler_SPP_Sample, "scheduler::spp::sample");
 
 // ------------------------------------------------------------------------------------------------
 
-// Time-based SPPScheduler
+// Time-based SPPScheduler.
+// Cancellation is checked between the passes
+// to keep the same number of samples for all pixels.
+// When resumed from a previous run, the render time is measured from the start of the run.
 class Scheduler_SPP_Time : public Scheduler {
 private:
     double render_time_;
+    long long grain_;   // Number of pixels processed in a range
     Film* film_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(render_time_, film_);
+        ar(render_time_, grain_, film_);
     }
 
     virtual void foreach_underlying(const ComponentVisitor& visit) override {
@@ -71,33 +159,48 @@ public:
 public:
     virtual void construct(const Json& prop) override {
         render_time_ = json::value<Float>(prop, "render_time");
+        grain_ = json::value<long long>(prop, "grain", 64);
         film_ = json::comp_ref<Film>(prop, "output");
     }
     
     virtual long long run(const ProcessFunc& process) const override {
-        const auto numPixels = film_->num_pixels();
+        return run_per_sample(*this, process);
+    }
+
+    virtual long long run_range(const ProcessRangeFunc& process) const override {
+        return run_passes(process, {}, 0);
+    }
+
+    virtual long long run_passes(const ProcessRangeFunc& process, const PassFunc& on_pass, long long processed) const override {
+        const auto num_pixels = film_->num_pixels();
         progress::ScopedTimeReport progress_ctx_(render_time_);
-        
+
         const auto start = std::chrono::high_resolution_clock::now();
-        long long spp = 0;
+        long long spp = processed;
         while (true) {
-            // Parallel loop for each pixel
-            parallel::foreach(numPixels, [&](long long index, int threadid) {
-                process(index, spp, threadid);
+            // Check cancellation
+            if (parallel::cancel_token().cancelled()) {
+                LM_WARN("Rendering is cancelled [spp={}]", spp);
+                break;
+            }
+
+            // Parallel loop for each range of pixels
+            parallel::foreach_range(num_pixels, grain_, [&](long long begin, long long end, int threadid) {
+                if (in_partition(begin, grain_)) {
+                    process(begin, end, spp, spp + 1, threadid);
+                }
             }, [&](long long) {
-                using namespace std::chrono;
-                const auto now = high_resolution_clock::now();
-                const auto elapsed = duration_cast<milliseconds>(now - start).count() / 1000.0;
-                progress::update_time(elapsed);
+                progress::update_time(elapsed_since(start));
             });
 
             // Update processed spp
             spp++;
+            if (on_pass) {
+                on_pass(spp);
+            }
 
             // Check termination
-            const auto curr = std::chrono::high_resolution_clock::now();
-            const double elapsed = (double)(std::chrono::duration_cast<std::chrono::milliseconds>(curr - start).count()) / 1000.0;
-            if (elapsed > render_time_) {
+            if (elapsed_since(start) > render_time_) {
                 break;
             }
         }
@@ -114,26 +217,39 @@ LM_COMP_REG_IMPL(Scheduler_SPP_Time, "scheduler::spp::time");
 class Scheduler_SPI_Sample : public Scheduler {
 private:
     long long num_samples_;
+    long long grain_;   // Number of samples processed in a range
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(num_samples_);
+        ar(num_samples_, grain_);
     }
   
 public:
     virtual void construct(const Json& prop) override {
         num_samples_ = json::value<long long>(prop, "num_samples");
+        grain_ = json::value<long long>(prop, "grain", 1024);
     }
 
     virtual long long run(const ProcessFunc& process) const override {
+        return run_per_sample(*this, process);
+    }
+
+    virtual long long run_range(const ProcessRangeFunc& process) const override {
         progress::ScopedReport progress_ctx_(num_samples_);
-        parallel::foreach(num_samples_, [&](long long index, int threadid) {
-            process(0, index, threadid);
+        const auto processed_samples = parallel::foreach_range(num_samples_, grain_, [&](long long begin, long long end, int threadid) {
+            if (in_partition(begin, grain_)) {
+                process(0, 1, begin, end, threadid);
+            }
         }, [&](long long processed) {
             progress::update(processed);
-        });
+        }, &parallel::cancel_token());
+        if (processed_samples < num_samples_) {
+            LM_WARN("Rendering is cancelled [processed={}/{}]", processed_samples, num_samples_);
+        }
 
-        return num_samples_;
+        // Sample indices in the completed ranges are not contiguous on cancellation,
+        // but the number of processed samples is exact.
+        return processed_samples;
     }
 };
 
@@ -146,40 +262,49 @@ class Scheduler_SPI_Time : public Scheduler {
 private:
     double render_time_;
     long long samples_per_iter_;
+    long long grain_;   // Number of samples processed in a range
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(render_time_, samples_per_iter_);
+        ar(render_time_, samples_per_iter_, grain_);
     }
 
 public:
     virtual void construct(const Json& prop) override {
         render_time_ = json::value<Float>(prop, "render_time");
         samples_per_iter_ = json::value<long long>(prop, "samples_per_iter", 1000000);
+        grain_ = json::value<long long>(prop, "grain", 1024);
     }
 
     virtual long long run(const ProcessFunc& process) const override {
+        return run_per_sample(*this, process);
+    }
+
+    virtual long long run_range(const ProcessRangeFunc& process) const override {
         progress::ScopedTimeReport progress_ctx_(render_time_);
         const auto start = std::chrono::high_resolution_clock::now();
         long long processed = 0;
         while (true) {
-            // Parallel loop
-            parallel::foreach(samples_per_iter_, [&](long long index, int threadid) {
-                process(0, processed + index, threadid);
+            // Parallel loop for each range of samples
+            const auto processed_iter = parallel::foreach_range(samples_per_iter_, grain_, [&](long long begin, long long end, int threadid) {
+                if (in_partition(begin, grain_)) {
+                    process(0, 1, processed + begin, processed + end, threadid);
+                }
             }, [&](long long) {
-                using namespace std::chrono;
-                const auto now = high_resolution_clock::now();
-                const auto elapsed = duration_cast<milliseconds>(now - start).count() / 1000.0;
-                progress::update_time(elapsed);
-            });
+                progress::update_time(elapsed_since(start));
+            }, &parallel::cancel_token());
 
             // Update processed samples
-            processed += samples_per_iter_;
+            processed += processed_iter;
+
+            // Check cancellation
+            if (processed_iter < samples_per_iter_) {
+                LM_WARN("Rendering is cancelled [processed={}]", processed);
+                break;
+            }
 
             // Check termination
-            const auto curr = std::chrono::high_resolution_clock::now();
-            const double elapsed = (double)(std::chrono::duration_cast<std::chrono::milliseconds>(curr - start).count()) / 1000.0;
-            if (elapsed > render_time_) {
+            if (elapsed_since(start) > render_time_) {
                 break;
             }
         }
@@ -189,4 +314,22 @@ public:
 
 LM_COMP_REG_IMPL(Scheduler_SPI_Time, "scheduler::spi::time");
 
+// ------------------------------------------------------------------------------------------------
+
+LM_PUBLIC_API void set_partition(int index, int count) {
+    if (count <= 0 || index < 0 || index >= count) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid partition [index={}, count={}]", index, count);
+    }
+    partition_index_ = index;
+    partition_count_ = count;
+}
+
+LM_PUBLIC_API int partition_index() {
+    return partition_index_;
+}
+
+LM_PUBLIC_API int partition_count() {
+    return partition_count_;
+}
+
 LM_NAMESPACE_END(LM_NAMESPACE::scheduler)
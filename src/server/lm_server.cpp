@@ -0,0 +1,387 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <lm/lm.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <list>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+    Persistent render server keeping the scenes resident between render jobs.
+
+    The server loads scenes into named slots and processes the requests
+    received over a Unix domain socket. Each request and response is a JSON object
+    in a line. If a response contains the ``size`` field, the binary payload
+    of the given number of bytes follows the line.
+    The requests modifying the assets or rendering images are queued
+    and processed in order by a dispatcher thread, where each job uses all threads
+    of the parallel subsystem.
+
+    Requests:
+    - {"cmd": "load", "slot": <str>, "assets": [{"name", "type", "prop"}, ...],
+       "scene": <str>, "primitives": [<prop>, ...], "build": <bool>}
+      Load assets into the slot. The slot is created if it does not exist, otherwise
+      the assets are added to the slot replacing the assets with the same names.
+      The assets in the slot are accessible with the locator ``$.assets.<slot>.<name>``.
+      If "primitives" is given, the primitives are added to the scene named "scene" in the slot
+      and the scene is built. "build" forces to rebuild the scene.
+    - {"cmd": "render", "slot": <str>, "renderer": <str>, "prop": <obj>, "output": <str>, "path": <str>}
+      Render an image with the renderer of the given type and properties,
+      where "output" is the name of the film in the slot.
+      If "path" is given, the film is saved to the path. Otherwise the buffer of the film
+      is returned as a payload of float32 values with "w", "h", and "c" fields.
+    - {"cmd": "status"}
+      Get the list of slots and the number of queued jobs. Processed immediately.
+    - {"cmd": "shutdown"}
+      Shutdown the server after the queued jobs.
+
+    Usage:
+    $ ./lm_server <socket path> [<number of threads>]
+*/
+
+namespace {
+
+// Response and binary payload
+using Response = std::pair<lm::Json, std::string>;
+
+// Queued job
+struct Job {
+    lm::Json request;
+    std::promise<Response> response;
+};
+
+// Connection to a client processed in a thread
+struct Connection {
+    int fd;
+    std::thread thread;
+    std::atomic<bool> done = false;     // True if the connection is closed
+};
+
+class Server {
+private:
+    int listen_fd_ = -1;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Job>> queue_;
+    bool stop_ = false;
+    std::vector<std::string> slots_;        // Names of loaded slots
+    std::mutex connections_mutex_;          // Guards closing the sockets of the connections
+    std::list<Connection> connections_;     // Connections. Accessed only from the thread of run().
+
+public:
+    // Listen to the socket and process requests until shutdown
+    void run(const std::string& path) {
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            LM_THROW_EXCEPTION(lm::Error::IOError, "Failed to create socket");
+        }
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Socket path is too long [path='{}']", path);
+        }
+        std::strcpy(addr.sun_path, path.c_str());
+        unlink(path.c_str());
+        if (bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 16) < 0) {
+            LM_THROW_EXCEPTION(lm::Error::IOError, "Failed to listen to socket [path='{}']", path);
+        }
+        LM_INFO("Listening [path='{}']", path);
+
+        // Dispatcher thread processing the queued jobs
+        std::thread dispatcher([this] { dispatch(); });
+
+        // Accept connections until shutdown
+        while (true) {
+            const int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                break;
+            }
+            // Join the threads of the closed connections
+            for (auto it = connections_.begin(); it != connections_.end();) {
+                if (it->done) {
+                    it->thread.join();
+                    it = connections_.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+            auto& connection = connections_.emplace_back();
+            connection.fd = fd;
+            connection.thread = std::thread([this, &connection] { handle_connection(connection); });
+        }
+
+        // Wait for the queued jobs, and then for the connections.
+        // The responses of the queued jobs are sent before the connections are closed,
+        // because shutting down the receiving side only stops reading further requests.
+        dispatcher.join();
+        {
+            std::unique_lock<std::mutex> lock(connections_mutex_);
+            for (auto& connection : connections_) {
+                if (!connection.done) {
+                    shutdown(connection.fd, SHUT_RD);
+                }
+            }
+        }
+        for (auto& connection : connections_) {
+            connection.thread.join();
+        }
+        connections_.clear();
+
+        close(listen_fd_);
+        unlink(path.c_str());
+    }
+
+private:
+    // Process requests from a client
+    void handle_connection(Connection& connection) {
+        const int fd = connection.fd;
+        std::string buf;
+        char chunk[4096];
+        while (true) {
+            // Read a line
+            const auto pos = buf.find('\n');
+            if (pos == std::string::npos) {
+                const auto n = read(fd, chunk, sizeof(chunk));
+                if (n <= 0) {
+                    break;
+                }
+                buf.append(chunk, n);
+                continue;
+            }
+            const auto line = buf.substr(0, pos);
+            buf.erase(0, pos + 1);
+
+            // Process the request
+            Response response;
+            try {
+                auto request = lm::json::parse(line);
+                const auto cmd = lm::json::value<std::string>(request, "cmd");
+                if (cmd == "status") {
+                    response.first = status();
+                }
+                else {
+                    auto job = std::make_shared<Job>();
+                    job->request = std::move(request);
+                    auto future = job->response.get_future();
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        if (stop_) {
+                            LM_THROW_EXCEPTION(lm::Error::Unsupported, "Server is shutting down");
+                        }
+                        queue_.push_back(job);
+                    }
+                    cv_.notify_one();
+                    response = future.get();
+                }
+            }
+            catch (const std::exception& e) {
+                response = { { {"status", "error"}, {"message", e.what()} }, {} };
+            }
+
+            // Send the response
+            if (!response.first.count("status")) {
+                response.first["status"] = "ok";
+            }
+            if (!response.second.empty()) {
+                response.first["size"] = response.second.size();
+            }
+            const auto header = response.first.dump() + "\n";
+            if (!write_all(fd, header.data(), header.size()) ||
+                !write_all(fd, response.second.data(), response.second.size())) {
+                break;
+            }
+        }
+
+        // Close the socket while the server does not shut down the socket
+        std::unique_lock<std::mutex> lock(connections_mutex_);
+        close(fd);
+        connection.done = true;
+    }
+
+    bool write_all(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            const auto n = write(fd, data, size);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    lm::Json status() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return {
+            {"slots", slots_},
+            {"queued", queue_.size()}
+        };
+    }
+
+    // Process the queued jobs in order
+    void dispatch() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return !queue_.empty() || stop_; });
+                if (queue_.empty()) {
+                    break;
+                }
+                job = queue_.front();
+                queue_.pop_front();
+            }
+            try {
+                job->response.set_value(process(job->request));
+            }
+            catch (const std::exception& e) {
+                LM_ERROR("Failed to process request [error='{}']", e.what());
+                job->response.set_value({ { {"status", "error"}, {"message", e.what()} }, {} });
+            }
+        }
+    }
+
+    // Process a request
+    Response process(const lm::Json& request) {
+        const auto cmd = lm::json::value<std::string>(request, "cmd");
+        if (cmd == "load") {
+            return { load(request), {} };
+        }
+        if (cmd == "render") {
+            return render(request);
+        }
+        if (cmd == "shutdown") {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+            shutdown(listen_fd_, SHUT_RDWR);
+            return {};
+        }
+        LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Invalid command [cmd='{}']", cmd);
+    }
+
+    lm::AssetGroup* slot(const std::string& name) const {
+        auto* group = lm::comp::get<lm::AssetGroup>(lm::assets()->loc() + "." + name);
+        if (!group) {
+            LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Slot is not loaded [slot='{}']", name);
+        }
+        return group;
+    }
+
+    lm::Json load(const lm::Json& request) {
+        const auto name = lm::json::value<std::string>(request, "slot");
+        LM_INFO("Loading slot [slot='{}']", name);
+        LM_INDENT();
+
+        // Create slot
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (std::find(slots_.begin(), slots_.end(), name) == slots_.end()) {
+                if (!lm::assets()->load_asset(name, "asset_group::default", {})) {
+                    LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Failed to create slot [slot='{}']", name);
+                }
+                slots_.push_back(name);
+            }
+        }
+        auto* group = slot(name);
+
+        // Load assets
+        for (const auto& asset : lm::json::value(request, "assets", lm::Json::array())) {
+            const auto asset_name = lm::json::value<std::string>(asset, "name");
+            const auto type = lm::json::value<std::string>(asset, "type");
+            if (!group->load_asset(asset_name, type, lm::json::value(asset, "prop", lm::Json::object()))) {
+                LM_THROW_EXCEPTION(lm::Error::InvalidArgument,
+                    "Failed to load asset [name='{}', type='{}']", asset_name, type);
+            }
+        }
+
+        // Build scene
+        const auto primitives = lm::json::value(request, "primitives", lm::Json::array());
+        if (!primitives.empty() || lm::json::value(request, "build", false)) {
+            const auto scene_name = lm::json::value<std::string>(request, "scene", "scene");
+            auto* scene = lm::comp::get<lm::Scene>(group->loc() + "." + scene_name);
+            if (!scene) {
+                LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Scene is not found [scene='{}']", scene_name);
+            }
+            for (const auto& primitive : primitives) {
+                scene->add_primitive(primitive);
+            }
+            scene->build();
+        }
+
+        return { {"loc", group->loc()} };
+    }
+
+    Response render(const lm::Json& request) {
+        auto* group = slot(lm::json::value<std::string>(request, "slot"));
+        const auto type = lm::json::value<std::string>(request, "renderer");
+        LM_INFO("Rendering [slot='{}', renderer='{}']", group->loc(), type);
+        LM_INDENT();
+
+        // Create renderer in the slot
+        auto* renderer = dynamic_cast<lm::Renderer*>(
+            group->load_asset("renderer", type, lm::json::value(request, "prop", lm::Json::object())));
+        if (!renderer) {
+            LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Failed to create renderer [renderer='{}']", type);
+        }
+        auto* film = lm::comp::get<lm::Film>(group->loc() + "." + lm::json::value<std::string>(request, "output"));
+        if (!film) {
+            LM_THROW_EXCEPTION(lm::Error::InvalidArgument, "Film is not found");
+        }
+
+        lm::parallel::cancel_token().reset();
+        renderer->render();
+
+        // Save the film
+        if (const auto path = lm::json::value_or_none<std::string>(request, "path")) {
+            if (!film->save(*path)) {
+                LM_THROW_EXCEPTION(lm::Error::IOError, "Failed to save film [path='{}']", *path);
+            }
+            return { { {"path", *path} }, {} };
+        }
+
+        // Return the buffer of the film
+        const auto buf = film->buffer();
+        const size_t n = size_t(buf.w) * buf.h * buf.c;
+        std::vector<float> data(buf.data, buf.data + n);
+        return {
+            { {"w", buf.w}, {"h", buf.h}, {"c", buf.c} },
+            std::string((const char*)data.data(), n * sizeof(float))
+        };
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc < 2) {
+            std::cerr << "Usage: lm_server <socket path> [<number of threads>]" << std::endl;
+            return 1;
+        }
+
+        lm::init();
+        lm::parallel::init(lm::parallel::DefaultType, {
+            {"num_threads", argc > 2 ? std::stoi(argv[2]) : 0}
+        });
+        lm::info();
+
+        Server server;
+        server.run(argv[1]);
+
+        lm::shutdown();
+    }
+    catch (const std::exception& e) {
+        LM_ERROR("Runtime error: {}", e.what());
+        return 1;
+    }
+
+    return 0;
+}
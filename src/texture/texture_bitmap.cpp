@@ -6,6 +6,8 @@
 #include <pch.h>
 #include <lm/core.h>
 #include <lm/texture.h>
+#include <lm/blob.h>
+#include <glm/gtc/packing.hpp>
 #pragma warning(push)
 #pragma warning(disable:4244) // possible loss of data
 #define STB_IMAGE_IMPLEMENTATION
@@ -19,16 +21,253 @@ std::string sanitize_directory_separator(std::string p) {
     return p;
 }
 
+namespace {
+
+// Conversion between sRGB and linear values
+float srgb_to_linear(float v) {
+    return v <= .04045f ? v / 12.92f : std::pow((v + .055f) / 1.055f, 2.4f);
+}
+
+float linear_to_srgb(float v) {
+    return v <= .0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - .055f;
+}
+
+// Table to convert 8-bit sRGB values to linear values
+const std::array<float, 256>& srgb_table() {
+    static const auto table = [] {
+        std::array<float, 256> t;
+        for (int i = 0; i < 256; i++) {
+            t[i] = srgb_to_linear(float(i) / 255.f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Image decoded by stb_image
+struct StbImage {
+    int w;
+    int h;
+    int c;
+    int bits;                   // Bits per component. 8, 16, or 32 for floating point values.
+    std::vector<uint8_t> data;  // Components of the pixels
+};
+
+// Decode the image from the contents of the file.
+// stb_image keeps the failure reason and the flip option in global variables
+// unless they are thread-local (STBI_THREAD_LOCAL is defined since v2.26).
+// The textures can be loaded concurrently, e.g., by model::wavefrontobj,
+// so the calls are serialized with the older versions.
+// The global flip option is never changed and the caller flips the image.
+StbImage stb_decode(const std::string& contents, const std::string& path) {
+    #ifndef STBI_THREAD_LOCAL
+    static std::mutex mutex;
+    std::unique_lock<std::mutex> lock(mutex);
+    #endif
+    const auto* buf = (const stbi_uc*)contents.data();
+    const auto len = int(contents.size());
+    StbImage image{};
+    void* data = nullptr;
+    if (stbi_is_hdr_from_memory(buf, len)) {
+        image.bits = 32;
+        data = stbi_loadf_from_memory(buf, len, &image.w, &image.h, &image.c, 0);
+    }
+    else if (stbi_is_16_bit_from_memory(buf, len)) {
+        image.bits = 16;
+        data = stbi_load_16_from_memory(buf, len, &image.w, &image.h, &image.c, 0);
+    }
+    else {
+        image.bits = 8;
+        data = stbi_load_from_memory(buf, len, &image.w, &image.h, &image.c, 0);
+    }
+    if (data == nullptr) {
+        LM_ERROR("Failed to load image: {} [path='{}']", stbi_failure_reason(), path);
+        LM_THROW_EXCEPTION_DEFAULT(Error::IOError);
+    }
+    const auto* p = (const uint8_t*)data;
+    image.data.assign(p, p + size_t(image.w)*image.h*image.c*(image.bits/8));
+    stbi_image_free(data);
+    return image;
+}
+
+// Flip the rows of the image
+void flip_vertically(StbImage& image) {
+    const size_t row = size_t(image.w)*image.c*(image.bits/8);
+    auto* data = image.data.data();
+    for (int y = 0; y < image.h/2; y++) {
+        std::swap_ranges(data + y*row, data + (y+1)*row, data + (image.h-1-y)*row);
+    }
+}
+
+// 128-bit digest of the contents of a file with the size of the contents
+struct Digest {
+    uint64_t h1;
+    uint64_t h2;
+    size_t size;
+
+    bool operator==(const Digest& o) const {
+        return h1 == o.h1 && h2 == o.h2 && size == o.size;
+    }
+};
+
+// Compute the digest with MurmurHash3 (x64, 128-bit variant)
+Digest digest(const std::string& contents) {
+    const auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    const auto fmix = [](uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    };
+    const auto read = [](const unsigned char* p, size_t n) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < n; i++) {
+            v |= uint64_t(p[i]) << (8*i);
+        }
+        return v;
+    };
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    const auto* data = reinterpret_cast<const unsigned char*>(contents.data());
+    const size_t len = contents.size();
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    // Body
+    const size_t num_blocks = len / 16;
+    for (size_t i = 0; i < num_blocks; i++) {
+        auto k1 = read(data + 16*i, 8);
+        auto k2 = read(data + 16*i + 8, 8);
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl(h1, 27); h1 += h2; h1 = h1*5 + 0x52dce729;
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl(h2, 31); h2 += h1; h2 = h2*5 + 0x38495ab5;
+    }
+
+    // Tail
+    const auto* tail = data + 16*num_blocks;
+    const size_t rem = len % 16;
+    if (rem > 8) {
+        auto k2 = read(tail + 8, rem - 8);
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if (rem > 0) {
+        auto k1 = read(tail, std::min<size_t>(rem, 8));
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    // Finalization
+    h1 ^= uint64_t(len);
+    h2 ^= uint64_t(len);
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    return { h1, h2, len };
+}
+
+}
+
+/*
+\rst
+.. function:: texture::bitmap
+
+   Bitmap texture loaded from an image file.
+
+   :param str path: Path to the image file.
+   :param bool flip: Flip the image vertically on load. Default: ``true``.
+   :param str filter: Texture filtering.
+                      ``nearest`` for nearest-neighbor lookup,
+                      ``bilinear`` for bilinear interpolation of the full-resolution image,
+                      or ``trilinear`` for bilinear interpolation of the mip levels
+                      selected from the footprint of the lookup.
+                      Default: ``trilinear``.
+   :param str storage: Storage format of the texels.
+                       ``uint8`` for 8-bit sRGB values,
+                       ``half`` for 16-bit floating point values,
+                       ``float`` for 32-bit floating point values,
+                       or ``auto`` to select ``uint8`` for 8-bit LDR images and ``half`` otherwise.
+                       Default: ``auto``.
+
+   The texels are kept in the storage format and converted to linear values on lookup.
+   The color components of 8-bit and 16-bit LDR images are interpreted as sRGB values,
+   and the conversion of 8-bit values uses a precomputed table.
+   The alpha component is interpreted as linear value.
+   The texture coordinates outside of :math:`[0,1]^2` are wrapped around.
+   With ``trilinear`` filtering, the mip pyramid of the image is generated on load
+   by averaging 2x2 texels of the finer level, which requires 1/3 of the memory of the image in addition.
+   The mip level is selected by :cpp:func:`lm::Texture::eval_filtered` from the footprint
+   given by the renderers propagating ray footprints, e.g., ``renderer::pt``.
+   The lookup with zero footprint uses the full-resolution image.
+   Filtered lookups reduce aliasing of minified textures and improve the cache locality of the texel reads.
+   :cpp:func:`lm::Texture::buffer` returns the linear values of the full-resolution image
+   converted to 32-bit floating point values on the first call.
+   The textures loaded from the files with the same contents and the same options
+   share the texels in memory, e.g., the textures referred by multiple OBJ models.
+   The shared texels are released when the last texture referring to them is destroyed.
+\endrst
+*/
 class Texture_Bitmap final : public Texture {
+private:
+    // Storage format of the texels
+    enum class Storage {
+        UInt8,      // 8-bit sRGB color and linear alpha
+        Half,       // 16-bit floating point
+        Float,      // 32-bit floating point
+    };
+
+    // Mip level. The first level is the full-resolution image.
+    struct MipLevel {
+        int w;
+        int h;
+        Blob<uint8_t> data;         // Texels in the storage format
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(w, h, data);
+        }
+    };
+
+    // Texels decoded from an image file, shared among the textures loaded from the same contents.
+    // The contents are identified by the digest instead of keeping them in memory.
+    struct SharedImage {
+        Digest digest;                  // Digest of the contents of the file
+        bool flip;                      // Options of the texture
+        std::string storage;
+        texture::Filter filter;
+        int w;
+        int h;
+        int c;
+        Storage resolved_storage;       // Storage format selected for the image
+        std::vector<MipLevel> levels;   // Mip levels owning the texels
+    };
+
+    // Shared images indexed by the digest of the contents of the file
+    struct SharedImageCache {
+        std::mutex mutex;
+        std::unordered_multimap<uint64_t, std::weak_ptr<const SharedImage>> images;
+    };
+    static SharedImageCache& shared_images() {
+        static SharedImageCache cache;
+        return cache;
+    }
+
 private:
     int w_;     // Width of the image
     int h_;     // Height of the image
     int c_;     // Number of components
-    std::vector<float> data_;
+    Storage storage_;
+    texture::Filter filter_;
+    std::vector<MipLevel> levels_;  // Mip levels. Only the full-resolution image unless trilinear filtering.
+    std::vector<float> buffer_;     // Linear values of the full-resolution image. Empty until requested.
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(w_, h_, c_, data_);
+        ar(w_, h_, c_, storage_, filter_, levels_);
     }
 
 public:
@@ -41,41 +280,86 @@ public:
         const std::string path = sanitize_directory_separator(json::value<std::string>(prop, "path"));
         LM_INFO("Loading texture [path='{}']", fs::path(path).filename().string());
 
-        // Load as HDR image
-        // LDR image is internally converted to HDR
+        // Options
         const bool flip = json::value<bool>(prop, "flip", true);
-        stbi_set_flip_vertically_on_load(flip);
-        float* data = stbi_loadf(path.c_str(), &w_, &h_, &c_, 0);
-        if (data == nullptr) {
-            LM_ERROR("Failed to load image: {} [path='{}']", stbi_failure_reason(), path);
-            LM_THROW_EXCEPTION_DEFAULT(Error::IOError);
+        const auto storage = json::value<std::string>(prop, "storage", "auto");
+        const auto filter = texture::filter_from_name(json::value<std::string>(prop, "filter", "trilinear"));
+
+        // Read the file
+        std::ifstream f(path, std::ios::in | std::ios::binary);
+        if (!f) {
+            LM_THROW_EXCEPTION(Error::IOError, "Failed to open image [path='{}']", path);
+        }
+        std::string contents{ std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>() };
+        const auto dg = digest(contents);
+
+        // Find the image loaded from the same contents with the same options.
+        // The whole digest is compared because the key of the cache might collide.
+        auto& cache = shared_images();
+        const auto find_shared = [&]() -> std::shared_ptr<const SharedImage> {
+            const auto [begin, end] = cache.images.equal_range(dg.h1);
+            for (auto it = begin; it != end; ++it) {
+                auto image = it->second.lock();
+                if (image && image->flip == flip && image->storage == storage &&
+                    image->filter == filter && image->digest == dg) {
+                    return image;
+                }
+            }
+            return {};
+        };
+        std::shared_ptr<const SharedImage> image;
+        {
+            std::unique_lock<std::mutex> lock(cache.mutex);
+            image = find_shared();
+        }
+        if (image) {
+            LM_INFO("Sharing texels with the texture loaded before");
+        }
+        else {
+            // Decode the image without holding the lock.
+            // The image is registered only after the decoding succeeded,
+            // unless the same image is registered by another thread in the meantime.
+            auto loaded = load(contents, path, flip, storage, filter);
+            std::unique_lock<std::mutex> lock(cache.mutex);
+            image = find_shared();
+            if (!image) {
+                for (auto it = cache.images.begin(); it != cache.images.end();) {
+                    it = it->second.expired() ? cache.images.erase(it) : std::next(it);
+                }
+                loaded->digest = dg;
+                image = loaded;
+                cache.images.emplace(dg.h1, image);
+            }
+        }
+
+        // Refer to the shared texels
+        w_ = image->w;
+        h_ = image->h;
+        c_ = image->c;
+        storage_ = image->resolved_storage;
+        filter_ = image->filter;
+        levels_.clear();
+        for (const auto& l : image->levels) {
+            MipLevel level{ l.w, l.h, {} };
+            level.data.map(l.data.data(), l.data.size(), image);
+            levels_.push_back(std::move(level));
         }
-        // Allocate and copy the data
-        data_.assign(data, data + (w_*h_*c_));
-        stbi_image_free(data);
     }
 
     virtual Vec3 eval(Vec2 t) const override {
-        const auto u = t.x - floor(t.x);
-        const auto v = t.y - floor(t.y);
-        const int x = std::clamp(int(u * w_), 0, w_ - 1);
-        const int y = std::clamp(int(v * h_), 0, h_ - 1);
-        const int i = w_ * y + x;
-        return Vec3(data_[c_*i], data_[c_*i+1], data_[c_*i+2]);
+        return Vec3(lookup(t, 0_f));
+    }
+
+    virtual Vec3 eval_filtered(Vec2 t, Float footprint) const override {
+        return Vec3(lookup(t, footprint));
     }
 
     virtual Vec3 eval_by_pixel_coords(int x, int y) const override {
-        const int i = w_*y + x;
-        return Vec3(data_[c_*i], data_[c_*i+1], data_[c_*i+2]);
+        return Vec3(texel(0, x, y));
     }
 
     virtual Float eval_alpha(Vec2 t) const override {
-        const auto u = t.x - floor(t.x);
-        const auto v = t.y - floor(t.y);
-        const int x = std::clamp(int(u * w_), 0, w_ - 1);
-        const int y = std::clamp(int(v * h_), 0, h_ - 1);
-        const int i = w_ * y + x;
-        return data_[c_*i+3];
+        return lookup(t, 0_f).w;
     }
 
     virtual bool has_alpha() const override {
@@ -83,7 +367,196 @@ public:
     }
 
     virtual TextureBuffer buffer() override {
-        return { w_, h_, c_, data_.data() };
+        if (buffer_.empty()) {
+            buffer_ = decode(levels_.front(), storage_);
+        }
+        return { w_, h_, c_, buffer_.data() };
+    }
+
+private:
+    // Decode the image and convert the texels to the storage format
+    std::shared_ptr<SharedImage> load(const std::string& contents, const std::string& path, bool flip, const std::string& storage, texture::Filter filter) {
+        auto image = stb_decode(contents, path);
+        if (flip) {
+            flip_vertically(image);
+        }
+        w_ = image.w;
+        h_ = image.h;
+        c_ = image.c;
+        filter_ = filter;
+
+        // Storage format
+        const bool ldr = image.bits == 8;
+        if (storage == "auto") {
+            storage_ = ldr ? Storage::UInt8 : Storage::Half;
+        }
+        else if (storage == "uint8") {
+            storage_ = Storage::UInt8;
+        }
+        else if (storage == "half") {
+            storage_ = Storage::Half;
+        }
+        else if (storage == "float") {
+            storage_ = Storage::Float;
+        }
+        else {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid texture storage [storage='{}']", storage);
+        }
+
+        // The values of 8-bit LDR images are kept as they are if stored in 8-bit,
+        // otherwise the image is converted to linear values and then to the storage format.
+        // 16-bit LDR images are decoded with the same sRGB curve as 8-bit images.
+        levels_.clear();
+        MipLevel level{ w_, h_, {} };
+        const size_t n = size_t(w_)*h_*c_;
+        if (ldr) {
+            level.data = std::move(image.data);
+            if (storage_ != Storage::UInt8) {
+                const auto values = decode(level, Storage::UInt8);
+                encode(level, values);
+            }
+        }
+        else if (image.bits == 16) {
+            std::vector<float> values(n);
+            for (size_t i = 0; i < n; i++) {
+                uint16_t u;
+                std::memcpy(&u, image.data.data() + 2*i, sizeof(u));
+                const auto v = float(u) / 65535.f;
+                values[i] = is_alpha(int(i % c_)) ? v : srgb_to_linear(v);
+            }
+            encode(level, values);
+        }
+        else {
+            std::vector<float> values(n);
+            std::memcpy(values.data(), image.data.data(), n * sizeof(float));
+            encode(level, values);
+        }
+        levels_.push_back(std::move(level));
+
+        // Texture filtering
+        if (filter_ == texture::Filter::Trilinear) {
+            build_mips();
+        }
+
+        auto shared = std::make_shared<SharedImage>();
+        shared->flip = flip;
+        shared->storage = storage;
+        shared->filter = filter;
+        shared->w = w_;
+        shared->h = h_;
+        shared->c = c_;
+        shared->resolved_storage = storage_;
+        shared->levels = std::move(levels_);
+        return shared;
+    }
+
+    // True if the k-th component is alpha
+    bool is_alpha(int k) const {
+        return (c_ == 2 && k == 1) || (c_ == 4 && k == 3);
+    }
+
+    // Get linear value of the i-th component of the texels in the storage format
+    float value(const uint8_t* data, size_t i, Storage storage) const {
+        switch (storage) {
+            case Storage::UInt8: {
+                return is_alpha(int(i % c_)) ? float(data[i]) / 255.f : srgb_table()[data[i]];
+            }
+            case Storage::Half: {
+                uint16_t v;
+                std::memcpy(&v, data + 2*i, sizeof(v));
+                return glm::unpackHalf1x16(v);
+            }
+            case Storage::Float: {
+                float v;
+                std::memcpy(&v, data + 4*i, sizeof(v));
+                return v;
+            }
+        }
+        LM_UNREACHABLE_RETURN();
+    }
+
+    // Convert the texels of the level to linear values
+    std::vector<float> decode(const MipLevel& level, Storage storage) const {
+        const size_t n = size_t(level.w) * level.h * c_;
+        std::vector<float> values(n);
+        for (size_t i = 0; i < n; i++) {
+            values[i] = value(level.data.data(), i, storage);
+        }
+        return values;
+    }
+
+    // Convert the linear values to the storage format
+    void encode(MipLevel& level, const std::vector<float>& values) const {
+        const size_t n = values.size();
+        auto& data = level.data.vec();
+        switch (storage_) {
+            case Storage::UInt8: {
+                data.resize(n);
+                for (size_t i = 0; i < n; i++) {
+                    const auto v = glm::clamp(values[i], 0.f, 1.f);
+                    data[i] = uint8_t(std::lround((is_alpha(int(i % c_)) ? v : linear_to_srgb(v)) * 255.f));
+                }
+                break;
+            }
+            case Storage::Half: {
+                data.resize(n * 2);
+                for (size_t i = 0; i < n; i++) {
+                    const uint16_t v = glm::packHalf1x16(values[i]);
+                    std::memcpy(data.data() + 2*i, &v, sizeof(v));
+                }
+                break;
+            }
+            case Storage::Float: {
+                data.resize(n * 4);
+                std::memcpy(data.data(), values.data(), n * 4);
+                break;
+            }
+        }
+    }
+
+    // Generate the mip pyramid down to 1x1.
+    // The texels are averaged in linear values.
+    void build_mips() {
+        TextureSize size{ w_, h_ };
+        auto values = decode(levels_.front(), storage_);
+        while (size.w > 1 || size.h > 1) {
+            std::vector<float> next;
+            size = texture::downsample(size, c_, values.data(), next);
+            MipLevel level;
+            level.w = size.w;
+            level.h = size.h;
+            encode(level, next);
+            levels_.push_back(std::move(level));
+            values = std::move(next);
+        }
+    }
+
+    // Fetch a texel of the mip level.
+    // Returns RGBA where the grayscale is broadcasted to the color components.
+    Vec4 texel(int level, int x, int y) const {
+        const auto& l = levels_[level];
+        const size_t i = c_*(size_t(l.w)*y+x);
+        const auto* data = l.data.data();
+        if (c_ < 3) {
+            const auto g = value(data, i, storage_);
+            return Vec4(g, g, g, c_ == 2 ? value(data, i+1, storage_) : 1.f);
+        }
+        return Vec4(
+            value(data, i, storage_),
+            value(data, i+1, storage_),
+            value(data, i+2, storage_),
+            c_ == 4 ? value(data, i+3, storage_) : 1.f);
+    }
+
+    // Lookup the texture with the footprint in texture coordinates
+    Vec4 lookup(Vec2 t, Float footprint) const {
+        const auto level_size = [&](int level) -> TextureSize {
+            return { levels_[level].w, levels_[level].h };
+        };
+        const auto fetch = [&](int level, int x, int y) {
+            return texel(level, x, y);
+        };
+        return texture::filtered_lookup(filter_, int(levels_.size()), level_size, fetch, t, footprint);
     }
 };
 
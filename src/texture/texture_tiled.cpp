@@ -0,0 +1,553 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/texture.h>
+#include <list>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Header of the tiled texture format.
+// The header is followed by the table of the mip levels and the tiles of the levels.
+// Each tile stores tile_size x tile_size texels with the components in float32 in row-major order.
+// The tiles on the right and bottom boundaries of the levels are padded with zeros.
+// The tiles of a level are stored in row-major order from the offset of the level.
+// The values are stored in little endian. The fields of the header and the table are encoded
+// by write_header() and write_level() irrespective of the platform.
+struct TiledTextureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t num_levels;
+};
+
+// Entry of the table of the mip levels
+struct TiledTextureLevel {
+    uint32_t w;
+    uint32_t h;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint64_t offset;
+};
+
+constexpr char TiledTextureMagic[8] = { 'L', 'M', 'T', 'E', 'X', '\0', '\0', '\0' };
+constexpr uint32_t TiledTextureVersion = 1;
+constexpr uint64_t TiledTextureAlignment = 64;
+constexpr size_t DefaultTileCacheBudget = size_t(1) << 30;
+
+// Key of a tile in the cache
+struct TileKey {
+    uint64_t texture;   // Identifier of the texture
+    int level;          // Mip level
+    int index;          // Index of the tile in the level
+
+    bool operator==(const TileKey& o) const {
+        return texture == o.texture && level == o.level && index == o.index;
+    }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& k) const {
+        return std::hash<uint64_t>{}((k.texture * 31 + uint64_t(k.level)) * 0x9e3779b97f4a7c15ull + uint64_t(k.index));
+    }
+};
+
+using Tile = std::vector<float>;
+using TilePtr = std::shared_ptr<const Tile>;
+
+// Cache of the tiles shared among the textures.
+// The least recently used tiles are evicted when the total size exceeds the budget.
+// The tiles are reference counted, so an evicted tile is alive while a thread is using it.
+class TileCache {
+private:
+    struct Entry {
+        TilePtr tile;
+        std::list<TileKey>::iterator lru;
+    };
+
+    std::mutex mutex_;
+    size_t budget_ = DefaultTileCacheBudget;
+    size_t size_ = 0;                   // Total size of the cached tiles in bytes
+    std::list<TileKey> lru_;            // Keys of the tiles from the most recently used
+    std::unordered_map<TileKey, Entry, TileKeyHash> entries_;
+
+public:
+    static TileCache& instance() {
+        static TileCache cache;
+        return cache;
+    }
+
+    // Get a tile. On miss, the tile is loaded by load() without holding the lock.
+    template <typename LoadFunc>
+    TilePtr get(const TileKey& key, const LoadFunc& load) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto tile = find(key)) {
+                return tile;
+            }
+        }
+        auto tile = std::make_shared<const Tile>(load());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto loaded = find(key)) {
+            // Loaded by another thread in the meantime
+            return loaded;
+        }
+        lru_.push_front(key);
+        entries_.emplace(key, Entry{ tile, lru_.begin() });
+        size_ += tile->size() * sizeof(float);
+        evict();
+        return tile;
+    }
+
+    // Remove the tiles of the texture
+    void remove(uint64_t texture) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = lru_.begin(); it != lru_.end();) {
+            if (it->texture != texture) {
+                ++it;
+                continue;
+            }
+            const auto entry = entries_.find(*it);
+            size_ -= entry->second.tile->size() * sizeof(float);
+            entries_.erase(entry);
+            it = lru_.erase(it);
+        }
+    }
+
+    void set_budget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = bytes;
+        evict();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+private:
+    // Find a tile and mark it as the most recently used
+    TilePtr find(const TileKey& key) {
+        const auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return it->second.tile;
+    }
+
+    // Evict the least recently used tiles until the total size fits in the budget
+    void evict() {
+        while (size_ > budget_ && !lru_.empty()) {
+            const auto entry = entries_.find(lru_.back());
+            size_ -= entry->second.tile->size() * sizeof(float);
+            entries_.erase(entry);
+            lru_.pop_back();
+        }
+    }
+};
+
+// Handles of the tiles recently used by the current thread, indexed by the hash of the key.
+// The lookups hitting the handles neither take the lock nor touch the reference counts.
+struct TileHandle {
+    TileKey key{ 0, -1, -1 };
+    TilePtr tile;
+};
+constexpr size_t NumTileHandles = 64;
+thread_local std::array<TileHandle, NumTileHandles> tile_handles;
+
+// Identifier of the next texture. The identifiers are not reused.
+std::atomic<uint64_t> next_texture_id = 1;
+
+uint64_t align_offset(uint64_t offset) {
+    return (offset + TiledTextureAlignment - 1) / TiledTextureAlignment * TiledTextureAlignment;
+}
+
+// True if the platform is little endian
+bool native_little_endian() {
+    const uint16_t v = 1;
+    uint8_t b;
+    std::memcpy(&b, &v, 1);
+    return b == 1;
+}
+
+// Convert the byte order of the 32-bit values between little endian and the native byte order
+void swap_bytes_if_big_endian(void* data, size_t n) {
+    if (native_little_endian()) {
+        return;
+    }
+    auto* p = (char*)data;
+    for (size_t i = 0; i < n; i++) {
+        std::reverse(p + 4*i, p + 4*i + 4);
+    }
+}
+
+// Encode an unsigned integer in little endian
+template <typename T>
+void put_le(std::string& buf, T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf.push_back(char((uint64_t(v) >> (8*i)) & 0xff));
+    }
+}
+
+// Decode an unsigned integer in little endian
+template <typename T>
+T get_le(const char*& p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(uint8_t(p[i])) << (8*i);
+    }
+    p += sizeof(T);
+    return T(v);
+}
+
+// Encoded sizes of the header and an entry of the table of the mip levels
+constexpr size_t TiledTextureHeaderSize = 8 + 4 * 6;
+constexpr size_t TiledTextureLevelSize = 4 * 4 + 8;
+
+std::string write_header(const TiledTextureHeader& h) {
+    std::string buf(h.magic, sizeof(h.magic));
+    put_le(buf, h.version);
+    put_le(buf, h.channels);
+    put_le(buf, h.width);
+    put_le(buf, h.height);
+    put_le(buf, h.tile_size);
+    put_le(buf, h.num_levels);
+    return buf;
+}
+
+TiledTextureHeader read_header(const char* p) {
+    TiledTextureHeader h;
+    std::memcpy(h.magic, p, sizeof(h.magic));
+    p += sizeof(h.magic);
+    h.version = get_le<uint32_t>(p);
+    h.channels = get_le<uint32_t>(p);
+    h.width = get_le<uint32_t>(p);
+    h.height = get_le<uint32_t>(p);
+    h.tile_size = get_le<uint32_t>(p);
+    h.num_levels = get_le<uint32_t>(p);
+    return h;
+}
+
+std::string write_level(const TiledTextureLevel& l) {
+    std::string buf;
+    put_le(buf, l.w);
+    put_le(buf, l.h);
+    put_le(buf, l.tiles_x);
+    put_le(buf, l.tiles_y);
+    put_le(buf, l.offset);
+    return buf;
+}
+
+TiledTextureLevel read_level(const char* p) {
+    TiledTextureLevel l;
+    l.w = get_le<uint32_t>(p);
+    l.h = get_le<uint32_t>(p);
+    l.tiles_x = get_le<uint32_t>(p);
+    l.tiles_y = get_le<uint32_t>(p);
+    l.offset = get_le<uint64_t>(p);
+    return l;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: texture::tiled
+
+   Texture in the tiled texture format loaded on demand.
+
+   :param str path: Path to the texture file.
+   :param str filter: Texture filtering. See ``texture::bitmap``. Default: ``trilinear``.
+
+   The texture file stores the mip levels split into square tiles.
+   The tiles are loaded on first access into the tile cache shared among all textures,
+   and the least recently used tiles are evicted when the total size exceeds the budget
+   configured by :cpp:func:`lm::texture::set_tile_cache_budget`.
+   Each thread keeps the handles of the recently used tiles,
+   so the lookups hitting the handles are lock-free.
+   The tiles referenced by the handles are kept in memory after eviction
+   until the handles are replaced.
+   A texture can be converted to the format with :cpp:func:`lm::texture::save_tiled`.
+   The texture does not provide :cpp:func:`lm::Texture::buffer`.
+   On serialization, only the path is saved and the file is opened again on deserialization.
+\endrst
+*/
+class Texture_Tiled final : public Texture {
+private:
+    std::string path_;
+    texture::Filter filter_;
+    uint64_t id_ = 0;                           // Identifier of the texture in the tile cache
+    int c_ = 0;                                 // Number of components
+    int tile_size_ = 0;                         // Width and height of the tiles
+    std::vector<TiledTextureLevel> levels_;     // Mip levels
+    mutable std::ifstream file_;
+    mutable std::mutex file_mutex_;             // Mutex for reading tiles from the file
+
+public:
+    ~Texture_Tiled() {
+        if (id_ != 0) {
+            TileCache::instance().remove(id_);
+        }
+    }
+
+public:
+    virtual void save(OutputArchive& ar) override {
+        ar(path_, filter_);
+    }
+
+    virtual void load(InputArchive& ar) override {
+        ar(path_, filter_);
+        open();
+    }
+
+public:
+    virtual void construct(const Json& prop) override {
+        path_ = json::value<std::string>(prop, "path");
+        filter_ = texture::filter_from_name(json::value<std::string>(prop, "filter", "trilinear"));
+        open();
+    }
+
+    virtual TextureSize size() const override {
+        return { int(levels_[0].w), int(levels_[0].h) };
+    }
+
+    virtual Vec3 eval(Vec2 t) const override {
+        return Vec3(lookup(t, 0_f));
+    }
+
+    virtual Vec3 eval_filtered(Vec2 t, Float footprint) const override {
+        return Vec3(lookup(t, footprint));
+    }
+
+    virtual Vec3 eval_by_pixel_coords(int x, int y) const override {
+        return Vec3(texel(0, x, y));
+    }
+
+    virtual Float eval_alpha(Vec2 t) const override {
+        return lookup(t, 0_f).w;
+    }
+
+    virtual bool has_alpha() const override {
+        return c_ == 4;
+    }
+
+private:
+    // Get a tile of the mip level via the handles of the current thread
+    const Tile& tile(int level, int index) const {
+        const TileKey key{ id_, level, index };
+        auto& handle = tile_handles[TileKeyHash{}(key) % NumTileHandles];
+        if (!(handle.key == key)) {
+            handle.tile = TileCache::instance().get(key, [&] { return load_tile(level, index); });
+            handle.key = key;
+        }
+        return *handle.tile;
+    }
+
+    // Fetch a texel of the mip level.
+    // Returns RGBA where the grayscale is broadcasted to the color components.
+    Vec4 texel(int level, int x, int y) const {
+        const auto& l = levels_[level];
+        const auto& t = tile(level, int(l.tiles_x) * (y / tile_size_) + x / tile_size_);
+        const float* p = &t[c_*(tile_size_*(y % tile_size_) + x % tile_size_)];
+        if (c_ < 3) {
+            return Vec4(p[0], p[0], p[0], c_ == 2 ? p[1] : 1.f);
+        }
+        return Vec4(p[0], p[1], p[2], c_ == 4 ? p[3] : 1.f);
+    }
+
+    // Lookup the texture with the footprint in texture coordinates
+    Vec4 lookup(Vec2 t, Float footprint) const {
+        const auto level_size = [&](int level) -> TextureSize {
+            return { int(levels_[level].w), int(levels_[level].h) };
+        };
+        const auto fetch = [&](int level, int x, int y) {
+            return texel(level, x, y);
+        };
+        return texture::filtered_lookup(filter_, int(levels_.size()), level_size, fetch, t, footprint);
+    }
+
+    // Read a tile from the file
+    Tile load_tile(int level, int index) const {
+        const size_t tile_bytes = size_t(tile_size_) * tile_size_ * c_ * sizeof(float);
+        Tile tile(size_t(tile_size_) * tile_size_ * c_);
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        file_.seekg(std::streamoff(levels_[level].offset + index * tile_bytes));
+        file_.read((char*)tile.data(), std::streamsize(tile_bytes));
+        if (!file_) {
+            LM_THROW_EXCEPTION(Error::IOError, "Failed to read tile [path='{}', level={}, index={}]", path_, level, index);
+        }
+        swap_bytes_if_big_endian(tile.data(), tile.size());
+        return tile;
+    }
+
+    // Open the file and read the table of the mip levels
+    void open() {
+        LM_INFO("Loading tiled texture [path='{}']", path_);
+        if (id_ != 0) {
+            TileCache::instance().remove(id_);
+        }
+        id_ = next_texture_id++;
+        file_ = std::ifstream(path_, std::ios::in | std::ios::binary);
+        if (!file_) {
+            LM_THROW_EXCEPTION(Error::IOError, "Failed to open tiled texture [path='{}']", path_);
+        }
+        file_.seekg(0, std::ios::end);
+        const auto file_size = uint64_t(file_.tellg());
+        file_.seekg(0, std::ios::beg);
+        char header_buf[TiledTextureHeaderSize];
+        if (file_size < TiledTextureHeaderSize || !file_.read(header_buf, TiledTextureHeaderSize)) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        const auto h = read_header(header_buf);
+        if (std::memcmp(h.magic, TiledTextureMagic, sizeof(TiledTextureMagic)) != 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        if (h.version != TiledTextureVersion) {
+            LM_THROW_EXCEPTION(Error::Unsupported, "Unsupported version of tiled texture [path='{}', version={}]", path_, h.version);
+        }
+        if (h.channels < 1 || h.channels > 4 || h.tile_size == 0 || h.num_levels == 0) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        // The table must fit in the file before allocating the levels
+        if (uint64_t(h.num_levels) > (file_size - TiledTextureHeaderSize) / TiledTextureLevelSize) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        c_ = int(h.channels);
+        tile_size_ = int(h.tile_size);
+        std::string table(size_t(h.num_levels) * TiledTextureLevelSize, '\0');
+        if (!file_.read(table.data(), std::streamsize(table.size()))) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        levels_.clear();
+        for (uint32_t i = 0; i < h.num_levels; i++) {
+            levels_.push_back(read_level(table.data() + i * TiledTextureLevelSize));
+        }
+        // The checks are ordered so that the sizes do not overflow
+        if (uint64_t(tile_size_) * tile_size_ > file_size) {
+            LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tiled texture [path='{}']", path_);
+        }
+        const uint64_t tile_bytes = uint64_t(tile_size_) * tile_size_ * c_ * sizeof(float);
+        for (const auto& l : levels_) {
+            const uint64_t num_tiles = uint64_t(l.tiles_x) * l.tiles_y;
+            if (l.w == 0 || l.h == 0 ||
+                uint64_t(l.tiles_x) * tile_size_ < l.w || uint64_t(l.tiles_y) * tile_size_ < l.h ||
+                num_tiles > file_size / tile_bytes || l.offset > file_size - num_tiles * tile_bytes) {
+                LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid level of tiled texture [path='{}']", path_);
+            }
+        }
+    }
+};
+
+LM_COMP_REG_IMPL(Texture_Tiled, "texture::tiled");
+
+// ------------------------------------------------------------------------------------------------
+
+LM_NAMESPACE_BEGIN(texture)
+
+LM_PUBLIC_API void save_tiled(Texture* texture, const std::string& path, int tile_size) {
+    const auto buf = texture->buffer();
+    if (!buf.data) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Texture does not provide buffer [name='{}']", texture->name());
+    }
+    if (tile_size <= 0) {
+        LM_THROW_EXCEPTION(Error::InvalidArgument, "Invalid tile size [tile_size={}]", tile_size);
+    }
+    const int c = buf.c;
+
+    // Generate the mip levels
+    std::vector<TextureSize> sizes{ { buf.w, buf.h } };
+    std::vector<std::vector<float>> mips;
+    while (sizes.back().w > 1 || sizes.back().h > 1) {
+        const float* src = mips.empty() ? buf.data : mips.back().data();
+        std::vector<float> dst;
+        sizes.push_back(downsample(sizes.back(), c, src, dst));
+        mips.push_back(std::move(dst));
+    }
+    const auto level_data = [&](size_t level) {
+        return level == 0 ? buf.data : mips[level-1].data();
+    };
+
+    // Compute the table of the mip levels
+    const uint64_t tile_bytes = uint64_t(tile_size) * tile_size * c * sizeof(float);
+    TiledTextureHeader header{};
+    std::memcpy(header.magic, TiledTextureMagic, sizeof(TiledTextureMagic));
+    header.version = TiledTextureVersion;
+    header.channels = uint32_t(c);
+    header.width = uint32_t(buf.w);
+    header.height = uint32_t(buf.h);
+    header.tile_size = uint32_t(tile_size);
+    header.num_levels = uint32_t(sizes.size());
+    std::vector<TiledTextureLevel> levels;
+    uint64_t offset = align_offset(TiledTextureHeaderSize + sizes.size() * TiledTextureLevelSize);
+    for (const auto [w, h] : sizes) {
+        TiledTextureLevel l;
+        l.w = uint32_t(w);
+        l.h = uint32_t(h);
+        l.tiles_x = uint32_t((w + tile_size - 1) / tile_size);
+        l.tiles_y = uint32_t((h + tile_size - 1) / tile_size);
+        l.offset = offset;
+        offset += uint64_t(l.tiles_x) * l.tiles_y * tile_bytes;
+        levels.push_back(l);
+    }
+
+    // Write the file
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out) {
+        LM_THROW_EXCEPTION(Error::IOError, "Failed to open file [path='{}']", path);
+    }
+    std::string table = write_header(header);
+    for (const auto& l : levels) {
+        table += write_level(l);
+    }
+    out.write(table.data(), std::streamsize(table.size()));
+    const char zeros[TiledTextureAlignment] = {};
+    out.write(zeros, std::streamsize(levels.front().offset - uint64_t(out.tellp())));
+    std::vector<float> tile(size_t(tile_size) * tile_size * c);
+    for (size_t level = 0; level < levels.size(); level++) {
+        const auto& l = levels[level];
+        const float* data = level_data(level);
+        for (uint32_t ty = 0; ty < l.tiles_y; ty++) {
+            for (uint32_t tx = 0; tx < l.tiles_x; tx++) {
+                std::fill(tile.begin(), tile.end(), 0.f);
+                for (int y = 0; y < tile_size; y++) {
+                    const auto sy = ty * tile_size + y;
+                    if (sy >= l.h) {
+                        break;
+                    }
+                    const auto sx = tx * tile_size;
+                    const auto n = std::min<uint32_t>(tile_size, l.w - sx);
+                    std::copy_n(&data[c*(size_t(l.w)*sy + sx)], n * c, &tile[c*size_t(tile_size)*y]);
+                }
+                swap_bytes_if_big_endian(tile.data(), tile.size());
+                out.write((const char*)tile.data(), std::streamsize(tile_bytes));
+            }
+        }
+    }
+    if (!out) {
+        LM_THROW_EXCEPTION(Error::IOError, "Failed to write tiled texture [path='{}']", path);
+    }
+    LM_INFO("Saved tiled texture [path='{}', w={}, h={}, levels={}]", path, buf.w, buf.h, levels.size());
+}
+
+LM_PUBLIC_API void set_tile_cache_budget(size_t bytes) {
+    TileCache::instance().set_budget(bytes);
+}
+
+LM_PUBLIC_API size_t tile_cache_size() {
+    return TileCache::instance().size();
+}
+
+LM_NAMESPACE_END(texture)
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -102,13 +102,12 @@ public:
     }
 
     void save_state_to_file(const std::string& path) {
-        std::ofstream os(path, std::ios::out | std::ios::binary);
-        serial::save_comp(os, root_assets_, root_assets_->loc());
+        root_assets_->save_sections(path);
     }
 
     void load_state_from_file(const std::string& path) {
-        std::ifstream is(path, std::ios::in | std::ios::binary);
-        serial::load_comp(is, root_assets_, root_assets_->loc());
+        reset();
+        root_assets_->load_sections(path);
     }
 };
 
@@ -6,6 +6,8 @@
 #include <pch.h>
 #include "test_common.h"
 #include <lm/assetgroup.h>
+#include <lm/serial.h>
+#include <lm/parallel.h>
 
 LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
 
@@ -18,6 +20,10 @@ struct TestAsset : public lm::Component {
 struct TestAsset_Simple final : public TestAsset {
     int v = -1;
 
+    LM_SERIALIZE_IMPL(ar) {
+        ar(v);
+    }
+
     virtual void construct(const lm::Json& prop) override {
         if (prop.count("v")) {
             v = prop["v"];
@@ -32,6 +38,10 @@ struct TestAsset_Simple final : public TestAsset {
 struct TestAsset_Dependent final : public TestAsset {
     TestAsset* other;
 
+    LM_SERIALIZE_IMPL(ar) {
+        ar(other);
+    }
+
     virtual void construct(const lm::Json& prop) override {
         // In this test an instance of Assets are registered as root component
         // thus we can access the underlying component via lm::comp::get function.
@@ -118,6 +128,25 @@ TEST_CASE("AssetGroup") {
             CHECK(a->f() == 2);
         }
     }
+
+    SUBCASE("Save and load sections") {
+        lm::parallel::ScopedInit parallel_init;
+        const auto path = (fs::temp_directory_path() / "lm_test_assets.serialized").string();
+        CHECK(assets->load_asset("asset1", "testasset::simple", { {"v", 42} }));
+        CHECK(assets->load_asset("asset2", "testasset::dependent", {}));
+        assets->save_sections(path);
+
+        // Loading replaces the assets. The weak reference refers to the loaded asset.
+        assets->load_sections(path);
+        auto* a1 = lm::comp::get<TestAsset>("$.asset1");
+        auto* a2 = lm::comp::get<TestAsset_Dependent>("$.asset2");
+        REQUIRE(a1);
+        REQUIRE(a2);
+        CHECK(a2->other == a1);
+        CHECK(a2->f() == 43);
+
+        fs::remove(path);
+    }
 }
 
 LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,67 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/film.h>
+#include <lm/denoiser.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Denoiser") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    const int w = 16;
+    const int h = 16;
+    auto film = lm::comp::create<lm::Film>("film::bitmap", "", { {"w", w}, {"h", h} });
+    auto output = lm::comp::create<lm::Film>("film::bitmap", "", { {"w", w}, {"h", h} });
+    auto denoiser = lm::comp::create<lm::Denoiser>("denoiser::atrous", "", {
+        {"iterations", 3}
+    });
+    REQUIRE(film);
+    REQUIRE(output);
+    REQUIRE(denoiser);
+
+    SUBCASE("Constant image is preserved") {
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                film->set_pixel(x, y, lm::Vec3(.5));
+            }
+        }
+        denoiser->denoise(film.get(), output.get());
+        const auto buf = output->buffer();
+        for (int i = 0; i < w*h*3; i++) {
+            CHECK(buf.data[i] == doctest::Approx(.5));
+        }
+    }
+
+    SUBCASE("Noise is reduced") {
+        lm::Rng rng(42);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                film->set_pixel(x, y, lm::Vec3(.5 + (rng.u() - .5) * .2));
+            }
+        }
+        const auto variance = [&](lm::Film* f) {
+            const auto buf = f->buffer();
+            lm::Float sum = 0;
+            for (int i = 0; i < w*h*3; i++) {
+                sum += (buf.data[i] - .5) * (buf.data[i] - .5);
+            }
+            return sum / (w*h*3);
+        };
+        denoiser->denoise(film.get(), output.get());
+        CHECK(variance(output.get()) < variance(film.get()) * .5);
+    }
+
+    SUBCASE("Output of different size is rejected") {
+        auto small = lm::comp::create<lm::Film>("film::bitmap", "", { {"w", 1}, {"h", 1} });
+        CHECK_THROWS(denoiser->denoise(film.get(), small.get()));
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,81 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/film.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Film") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    auto film = lm::comp::create<lm::Film>("film::bitmap", "", {
+        {"w", 2}, {"h", 1}
+    });
+    REQUIRE(film);
+
+    SUBCASE("Values are output as they are without weight") {
+        film->set_pixel(0, 0, lm::Vec3(1, 2, 3));
+        CHECK(film->weight() == 0);
+        const auto buf = film->buffer();
+        CHECK(buf.data[0] == 1);
+        CHECK(buf.data[1] == 2);
+        CHECK(buf.data[2] == 3);
+    }
+
+    SUBCASE("Accumulated values are normalized by weight") {
+        // Two renderings with 2 and 6 samples per pixel
+        film->splat_pixel(0, 0, lm::Vec3(2));
+        film->add_weight(2);
+        film->splat_pixel(0, 0, lm::Vec3(6));
+        film->splat_pixel(1, 0, lm::Vec3(4));
+        film->add_weight(6);
+        CHECK(film->weight() == 8);
+        const auto buf = film->buffer();
+        CHECK(buf.data[0] == doctest::Approx(1));
+        CHECK(buf.data[3] == doctest::Approx(.5));
+    }
+
+    SUBCASE("Clear resets weight") {
+        film->splat_pixel(0, 0, lm::Vec3(1));
+        film->add_weight(1);
+        film->clear();
+        CHECK(film->weight() == 0);
+        CHECK(film->buffer().data[0] == 0);
+    }
+
+    SUBCASE("AOVs are normalized by weight") {
+        const int albedo = film->add_aov("albedo", 3);
+        const int depth = film->add_aov("depth", 1);
+        REQUIRE(albedo >= 0);
+        REQUIRE(depth >= 0);
+        CHECK(film->add_aov("albedo", 3) == albedo);
+        CHECK(film->aov_index("depth") == depth);
+        CHECK(film->aov_index("normal") == -1);
+        film->splat_aov(albedo, 1, 0, lm::Vec3(2, 4, 6));
+        film->splat_aov(depth, 1, 0, lm::Vec3(8));
+        film->add_weight(2);
+        const auto buf_albedo = film->aov_buffer(albedo);
+        CHECK(buf_albedo.c == 3);
+        CHECK(buf_albedo.data[3] == doctest::Approx(1));
+        CHECK(buf_albedo.data[5] == doctest::Approx(3));
+        const auto buf_depth = film->aov_buffer(depth);
+        CHECK(buf_depth.c == 1);
+        CHECK(buf_depth.data[0] == 0);
+        CHECK(buf_depth.data[1] == doctest::Approx(4));
+    }
+
+    SUBCASE("Clear resets AOVs") {
+        const int depth = film->add_aov("depth", 1);
+        film->splat_aov(depth, 0, 0, lm::Vec3(1));
+        film->clear();
+        CHECK(film->aov_buffer(depth).data[0] == 0);
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
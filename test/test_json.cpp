@@ -49,6 +49,54 @@ TEST_CASE("Json") {
         }
     }
 
+    SUBCASE("Buffer") {
+        const std::vector<float> data{ 1,2,3,4,5,6 };
+        lm::json::ScopedBuffer buffer(data.data(), data.size());
+        const auto j = buffer.ref();
+        CHECK(lm::json::is_buffer_view(j));
+        CHECK(!lm::json::is_buffer_view("[1,2,3]"_lmJson));
+        CHECK(lm::json::array_size(j) == 6);
+        SUBCASE("Same type") {
+            std::vector<float> out(6);
+            lm::json::copy_array(j, out.data(), 6);
+            CHECK(out == data);
+        }
+        SUBCASE("Conversion") {
+            std::vector<int> out(6);
+            lm::json::copy_array(j, out.data(), 6);
+            CHECK(out == std::vector<int>{ 1,2,3,4,5,6 });
+        }
+        SUBCASE("Json array") {
+            std::vector<int> out(3);
+            lm::json::copy_array("[1,2,3]"_lmJson, out.data(), 3);
+            CHECK(out == std::vector<int>{ 1,2,3 });
+        }
+        SUBCASE("Vec types") {
+            lm::json::ScopedBuffer buffer3(data.data(), 3);
+            lm::Vec3 v = buffer3.ref();
+            CHECK(v == lm::Vec3(1,2,3));
+            CHECK_THROWS(lm::Vec3 v2 = j);
+        }
+        SUBCASE("Too many elements") {
+            std::vector<float> out(7);
+            CHECK_THROWS(lm::json::copy_array(j, out.data(), 7));
+        }
+        SUBCASE("Unregistered buffer") {
+            lm::Json j2;
+            {
+                lm::json::ScopedBuffer buffer2(data.data(), data.size());
+                j2 = buffer2.ref();
+            }
+            std::vector<float> out(6);
+            CHECK_THROWS(lm::json::copy_array(j2, out.data(), 6));
+        }
+        SUBCASE("Parsed buffer reference") {
+            CHECK_THROWS(lm::json::parse(j.dump()));
+            CHECK_THROWS(lm::json::parse(R"({"mesh": {"buffer_": 1, "data": 0, "size": 6}})"));
+            CHECK(lm::json::parse("[1,2,3]") == "[1,2,3]"_lmJson);
+        }
+    }
+
     SUBCASE("Conversion of pointer types") {
         SUBCASE("Non const pointer") {
             int v = 42;
@@ -0,0 +1,63 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/mesh.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Binary mesh") {
+    lm::log::ScopedInit log_;
+
+    // Quad with two triangles sharing two vertices
+    const auto raw = lm::comp::create<lm::Mesh>("mesh::raw", "", {
+        {"ps", {-1,0,-1, 1,0,-1, 1,0,1, -1,0,1}},
+        {"ns", {0,1,0}},
+        {"ts", {0,0, 1,0, 1,1, 0,1}},
+        {"fs", {
+            {"p", {0,1,2, 0,2,3}},
+            {"t", {0,1,2, 0,2,3}},
+            {"n", {0,0,0, 0,0,0}}
+        }}
+    });
+    REQUIRE(raw);
+
+    const auto path = (fs::temp_directory_path() / "lm_test_mesh.lmmesh").string();
+    lm::mesh::save_binary(raw.get(), path);
+
+    SUBCASE("Triangles are the same as the original mesh") {
+        const auto mesh = lm::comp::create<lm::Mesh>("mesh::binary", "", {
+            {"path", path}
+        });
+        REQUIRE(mesh);
+        REQUIRE(mesh->num_triangles() == raw->num_triangles());
+        for (int face = 0; face < mesh->num_triangles(); face++) {
+            const auto t1 = raw->triangle_at(face);
+            const auto t2 = mesh->triangle_at(face);
+            for (const auto& [p1, p2] : { std::make_pair(t1.p1, t2.p1), std::make_pair(t1.p2, t2.p2), std::make_pair(t1.p3, t2.p3) }) {
+                CHECK(p1.p == p2.p);
+                CHECK(p1.n == p2.n);
+                CHECK(p1.t == p2.t);
+            }
+            const auto s = mesh->surface_point(face, lm::Vec2(.25, .25));
+            CHECK(s.n == lm::Vec3(0,1,0));
+        }
+    }
+
+    SUBCASE("Invalid file") {
+        {
+            std::ofstream f(path);
+            f << "invalid";
+        }
+        CHECK_THROWS(lm::comp::create<lm::Mesh>("mesh::binary", "", {
+            {"path", path}
+        }));
+    }
+
+    fs::remove(path);
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,95 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/objloader.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Load an OBJ file and record the results of the callbacks
+std::string load_obj(const std::string& type, const lm::Json& prop, const std::string& path, lm::objloader::OBJSurfaceGeometry& geo) {
+    auto loader = lm::comp::create<lm::objloader::OBJLoaderContext>(type, "", prop);
+    REQUIRE(loader);
+    std::ostringstream os;
+    const bool result = loader->load(path, geo, [&](const lm::objloader::OBJMeshFace& fs, const lm::objloader::MTLMatParams& m) {
+        os << "mesh " << m.name;
+        for (const auto& f : fs) {
+            os << " " << f.p << "/" << f.t << "/" << f.n;
+        }
+        os << std::endl;
+        return true;
+    }, [&](const lm::objloader::MTLMatParams& m) {
+        os << "material " << m.name << std::endl;
+        return true;
+    });
+    CHECK(result);
+    return os.str();
+}
+
+}
+
+TEST_CASE("OBJ loader") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    const auto dir = fs::temp_directory_path();
+    {
+        std::ofstream f((dir / "lm_test_objloader.mtl").string());
+        f << "newmtl red\nKd 1 0 0\nnewmtl white\nKd 1 1 1\n";
+    }
+    {
+        // Includes relative indices, quads, and material groups
+        std::ofstream f((dir / "lm_test_objloader.obj").string());
+        f << "mtllib lm_test_objloader.mtl\r\n"
+          << "usemtl red\r\n";
+        for (int i = 0; i < 100; i++) {
+            f << "v " << i << " " << -i * .5 << " 1e-3\n"
+              << "v " << i << " 1 0\n"
+              << "v " << i << " 1 1\n"
+              << "vt 0 " << i * .01 << "\n"
+              << "vn 0 " << -i * .01 << " 1\n";
+            if (i == 50) {
+                f << "usemtl white\n";
+            }
+            if (i % 2 == 0) {
+                f << "f -3/-1/-1 -2/-1/-1 -1/-1/-1\n";
+            }
+            else {
+                f << "f " << 3*i << "//" << i+1 << " " << 3*i+1 << "//" << i+1 << " "
+                  << 3*i+2 << "//" << i+1 << " " << 3*i+3 << "//" << i+1 << "\n";
+            }
+        }
+    }
+    const auto path = (dir / "lm_test_objloader.obj").string();
+
+    // Compare with the results of the simple loader
+    // using small chunks to split the file into many chunks
+    lm::objloader::OBJSurfaceGeometry geo_simple;
+    lm::objloader::OBJSurfaceGeometry geo_fast;
+    const auto result_simple = load_obj("objloader::simple", {}, path, geo_simple);
+    const auto result_fast = load_obj("objloader::fast", { {"min_chunk_size", 64} }, path, geo_fast);
+    CHECK(result_simple == result_fast);
+    REQUIRE(geo_simple.ps.size() == geo_fast.ps.size());
+    REQUIRE(geo_simple.ns.size() == geo_fast.ns.size());
+    REQUIRE(geo_simple.ts.size() == geo_fast.ts.size());
+    for (size_t i = 0; i < geo_simple.ps.size(); i++) {
+        CHECK(geo_simple.ps[i] == geo_fast.ps[i]);
+    }
+    for (size_t i = 0; i < geo_simple.ns.size(); i++) {
+        CHECK(geo_simple.ns[i] == geo_fast.ns[i]);
+    }
+    for (size_t i = 0; i < geo_simple.ts.size(); i++) {
+        CHECK(geo_simple.ts[i] == geo_fast.ts[i]);
+    }
+
+    fs::remove(dir / "lm_test_objloader.obj");
+    fs::remove(dir / "lm_test_objloader.mtl");
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
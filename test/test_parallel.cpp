@@ -0,0 +1,143 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Parallel") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_("openmp", {
+        {"num_threads", 4}
+    });
+
+    SUBCASE("foreach visits every index once") {
+        constexpr long long N = 10007;
+        std::vector<std::atomic<int>> visited(N);
+        lm::parallel::foreach(N, [&](long long index, int) {
+            visited[index]++;
+        });
+        CHECK(std::all_of(visited.begin(), visited.end(), [](const auto& v) { return v == 1; }));
+    }
+
+    SUBCASE("foreach_range visits every index once") {
+        constexpr long long N = 10007;
+        for (long long grain : { 1LL, 7LL, 128LL, N, 2*N }) {
+            std::vector<std::atomic<int>> visited(N);
+            std::atomic<long long> max_range_size = 0;
+            std::atomic<bool> empty_range = false;
+            lm::parallel::foreach_range(N, grain, [&](long long begin, long long end, int) {
+                // Assertion macros are not thread-safe
+                if (begin >= end) {
+                    empty_range = true;
+                }
+                for (long long i = begin; i < end; i++) {
+                    visited[i]++;
+                }
+                auto curr = max_range_size.load();
+                while (curr < end - begin && !max_range_size.compare_exchange_weak(curr, end - begin));
+            });
+            CHECK(std::all_of(visited.begin(), visited.end(), [](const auto& v) { return v == 1; }));
+            CHECK(!empty_range);
+            CHECK(max_range_size <= grain);
+        }
+    }
+
+    SUBCASE("foreach returns number of processed samples") {
+        CHECK(lm::parallel::foreach(10007, [](long long, int) {}) == 10007);
+        CHECK(lm::parallel::foreach_range(10007, 64, [](long long, long long, int) {}) == 10007);
+    }
+
+    SUBCASE("foreach_range stops on cancellation") {
+        constexpr long long N = 100000;
+        lm::parallel::CancelToken token;
+        std::atomic<long long> visited = 0;
+        const auto processed = lm::parallel::foreach_range(N, 10, [&](long long begin, long long end, int) {
+            visited += end - begin;
+            if (begin == 1000) {
+                token.cancel();
+            }
+        }, [](long long) {}, &token);
+        CHECK(processed == visited);
+        CHECK(processed < N);
+    }
+
+    SUBCASE("foreach stops on cancellation") {
+        constexpr long long N = 1000000;
+        lm::parallel::CancelToken token;
+        std::atomic<long long> visited = 0;
+        const auto processed = lm::parallel::foreach(N, [&](long long index, int) {
+            visited++;
+            if (index == 1000) {
+                token.cancel();
+            }
+        }, [](long long) {}, &token);
+        CHECK(processed == visited);
+        CHECK(processed < N);
+    }
+
+    SUBCASE("Expired deadline cancels the loop") {
+        lm::parallel::CancelToken token;
+        token.set_timeout(-1);
+        CHECK(token.cancelled());
+        CHECK(lm::parallel::foreach_range(1000, 10, [](long long, long long, int) {}, [](long long) {}, &token) == 0);
+        token.reset();
+        CHECK(!token.cancelled());
+        CHECK(lm::parallel::foreach_range(1000, 10, [](long long, long long, int) {}, [](long long) {}, &token) == 1000);
+    }
+
+    SUBCASE("foreach_range propagates exceptions") {
+        CHECK_THROWS(lm::parallel::foreach_range(1000, 10, [&](long long begin, long long, int) {
+            if (begin == 500) {
+                throw std::runtime_error("error");
+            }
+        }));
+    }
+}
+
+TEST_CASE("Parallel context with standard threads") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_("threads", {
+        {"num_threads", 4}
+    });
+
+    SUBCASE("foreach visits every index once") {
+        constexpr long long N = 10007;
+        std::vector<std::atomic<int>> visited(N);
+        std::atomic<int> max_thread_id = 0;
+        const auto processed = lm::parallel::foreach(N, [&](long long index, int threadid) {
+            visited[index]++;
+            auto curr = max_thread_id.load();
+            while (curr < threadid && !max_thread_id.compare_exchange_weak(curr, threadid));
+        });
+        CHECK(processed == N);
+        CHECK(std::all_of(visited.begin(), visited.end(), [](const auto& v) { return v == 1; }));
+        CHECK(max_thread_id < lm::parallel::num_threads());
+        CHECK(lm::parallel::main_thread());
+    }
+
+    SUBCASE("foreach_range visits every index once") {
+        constexpr long long N = 10007;
+        std::vector<std::atomic<int>> visited(N);
+        CHECK(lm::parallel::foreach_range(N, 64, [&](long long begin, long long end, int) {
+            for (long long i = begin; i < end; i++) {
+                visited[i]++;
+            }
+        }, [](long long) {}) == N);
+        CHECK(std::all_of(visited.begin(), visited.end(), [](const auto& v) { return v == 1; }));
+    }
+
+    SUBCASE("foreach propagates exceptions") {
+        CHECK_THROWS(lm::parallel::foreach(1000, [&](long long index, int) {
+            if (index == 500) {
+                throw std::runtime_error("error");
+            }
+        }));
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
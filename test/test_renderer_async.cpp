@@ -0,0 +1,81 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/assetgroup.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/scene.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Asynchronous rendering") {
+    lm::log::ScopedInit log_;
+
+    // Use fewer threads than the logical cores so that the parallel loops
+    // dispatched from the rendering thread must not exceed the configured number
+    lm::parallel::ScopedInit parallel_("openmp", { {"num_threads", 1} });
+
+    auto assets = lm::comp::create<lm::AssetGroup>("asset_group::default", "$");
+    REQUIRE(assets);
+    lm::comp::detail::register_root_comp(assets.get());
+
+    // Quad lit by an area light facing the camera
+    REQUIRE(assets->load_asset("quad", "mesh::raw", {
+        {"ps", {-1,-1,-1, 1,-1,-1, 1,1,-1, -1,1,-1}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"t", {0,0,0,0,0,0}},
+            {"n", {0,0,0,0,0,0}}
+        }}
+    }));
+    REQUIRE(assets->load_asset("black", "material::diffuse", { {"Kd", {0,0,0}} }));
+    REQUIRE(assets->load_asset("light", "light::area", {
+        {"Ke", {1,1,1}},
+        {"mesh", "$.quad"}
+    }));
+    REQUIRE(assets->load_asset("camera", "camera::pinhole", {
+        {"position", {0,0,5}},
+        {"center", {0,0,0}},
+        {"up", {0,1,0}},
+        {"vfov", 30}
+    }));
+    REQUIRE(assets->load_asset("accel", "accel::sahbvh", {}));
+    auto* scene = dynamic_cast<lm::Scene*>(assets->load_asset("scene", "scene::default", {
+        {"accel", "$.accel"}
+    }));
+    REQUIRE(scene);
+    scene->add_primitive({ {"camera", "$.camera"} });
+    scene->add_primitive({ {"mesh", "$.quad"}, {"material", "$.black"}, {"light", "$.light"} });
+    scene->build();
+
+    auto* film = dynamic_cast<lm::Film*>(assets->load_asset("film", "film::bitmap", { {"w", 8}, {"h", 4} }));
+    REQUIRE(film);
+    auto* renderer = dynamic_cast<lm::Renderer*>(assets->load_asset("renderer", "renderer::pt", {
+        {"scene", "$.scene"},
+        {"output", "$.film"},
+        {"scheduler", "sample"},
+        {"spp", 4},
+        {"max_length", 2},
+        {"seed", 42}
+    }));
+    REQUIRE(renderer);
+
+    auto job = lm::render_async(renderer);
+    REQUIRE(job);
+    job->wait();
+    CHECK(job->poll());
+
+    // The quad covers the center of the image
+    const auto buf = film->buffer();
+    const int i = 2*buf.w + 4;
+    CHECK(buf.data[3*i] > 0);
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,86 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/assetgroup.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/scheduler.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+// Renderer adding one to the pixel for each sample
+struct TestRenderer_Count final : public lm::Renderer {
+    lm::Film* film;
+    lm::Component::Ptr<lm::scheduler::Scheduler> sched;
+
+    virtual void construct(const lm::Json& prop) override {
+        film = lm::json::comp_ref<lm::Film>(prop, "output");
+        sched = lm::comp::create<lm::scheduler::Scheduler>(
+            "scheduler::spp::sample", make_loc("scheduler"), prop);
+    }
+
+    virtual void foreach_underlying(const ComponentVisitor& visit) override {
+        lm::comp::visit(visit, film);
+        lm::comp::visit(visit, sched);
+    }
+
+    virtual void render() const override {
+        film->clear();
+        const int w = film->size().w;
+        const auto processed = sched->run([&](long long pixel_index, long long, int) {
+            film->splat_pixel(int(pixel_index % w), int(pixel_index / w), lm::Vec3(1));
+        });
+        film->rescale(1.0 / processed);
+    }
+};
+
+LM_COMP_REG_IMPL(TestRenderer_Count, "renderer::test_count");
+
+// ------------------------------------------------------------------------------------------------
+
+TEST_CASE("Multi-process renderer") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    auto assets = lm::comp::create<lm::AssetGroup>("asset_group::default", "$");
+    REQUIRE(assets);
+    lm::comp::detail::register_root_comp(assets.get());
+
+    const int w = 16;
+    const int h = 8;
+    REQUIRE(assets->load_asset("film", "film::bitmap", { {"w", w}, {"h", h} }));
+    REQUIRE(assets->load_asset("renderer", "renderer::test_count", {
+        {"output", "$.film"},
+        {"spp", 3},
+        {"grain", 4}
+    }));
+    auto* film = lm::comp::get<lm::Film>("$.film");
+    REQUIRE(film);
+
+    #if LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+    SUBCASE("Each pixel is rendered by exactly one worker") {
+        for (int num_processes : {1, 2, 3}) {
+            REQUIRE(assets->load_asset("fork", "renderer::fork", {
+                {"renderer", "$.renderer"},
+                {"output", "$.film"},
+                {"num_processes", num_processes},
+                {"num_threads", 1}
+            }));
+            auto* renderer = lm::comp::get<lm::Renderer>("$.fork");
+            REQUIRE(renderer);
+            renderer->render();
+            const auto buf = film->buffer();
+            for (int i = 0; i < w*h*3; i++) {
+                CHECK(buf.data[i] == doctest::Approx(1));
+            }
+        }
+    }
+    #endif
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,127 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/assetgroup.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/scene.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Average of the pixel values of the film
+lm::Vec3 average(lm::Film* film) {
+    const auto buf = film->buffer();
+    lm::Vec3 sum(0);
+    for (int i = 0; i < buf.w*buf.h; i++) {
+        sum += lm::Vec3(buf.data[3*i], buf.data[3*i+1], buf.data[3*i+2]);
+    }
+    return sum / lm::Float(buf.w*buf.h);
+}
+
+}
+
+TEST_CASE("Irradiance cache renderer") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    auto assets = lm::comp::create<lm::AssetGroup>("asset_group::default", "$");
+    REQUIRE(assets);
+    lm::comp::detail::register_root_comp(assets.get());
+
+    // Diffuse scene with a floor and a wall lit by an area light above
+    const auto load_quad = [&](const std::string& name, lm::Vec3 p0, lm::Vec3 e1, lm::Vec3 e2) {
+        const auto p1 = p0 + e1;
+        const auto p2 = p0 + e1 + e2;
+        const auto p3 = p0 + e2;
+        const auto n = glm::normalize(glm::cross(e1, e2));
+        return assets->load_asset(name, "mesh::raw", {
+            {"ps", {p0.x,p0.y,p0.z, p1.x,p1.y,p1.z, p2.x,p2.y,p2.z, p3.x,p3.y,p3.z}},
+            {"ns", {n.x,n.y,n.z}},
+            {"ts", {0,0}},
+            {"fs", {
+                {"p", {0,1,2,0,2,3}},
+                {"t", {0,0,0,0,0,0}},
+                {"n", {0,0,0,0,0,0}}
+            }}
+        });
+    };
+    REQUIRE(load_quad("floor", {-1,0,1}, {2,0,0}, {0,0,-2}));
+    REQUIRE(load_quad("wall", {-1,0,-1}, {2,0,0}, {0,2,0}));
+    REQUIRE(load_quad("light_mesh", {-.3,1.9,-.3}, {.6,0,0}, {0,0,.6}));
+    REQUIRE(assets->load_asset("diffuse", "material::diffuse", { {"Kd", {.5,.5,.5}} }));
+    REQUIRE(assets->load_asset("black", "material::diffuse", { {"Kd", {0,0,0}} }));
+    REQUIRE(assets->load_asset("light", "light::area", {
+        {"Ke", {10,10,10}},
+        {"mesh", "$.light_mesh"}
+    }));
+    REQUIRE(assets->load_asset("camera", "camera::pinhole", {
+        {"position", {0,1,4}},
+        {"center", {0,.5,0}},
+        {"up", {0,1,0}},
+        {"vfov", 40}
+    }));
+    REQUIRE(assets->load_asset("accel", "accel::sahbvh", {}));
+    auto* scene = dynamic_cast<lm::Scene*>(assets->load_asset("scene", "scene::default", {
+        {"accel", "$.accel"}
+    }));
+    REQUIRE(scene);
+    scene->add_primitive({ {"camera", "$.camera"} });
+    scene->add_primitive({ {"mesh", "$.floor"}, {"material", "$.diffuse"} });
+    scene->add_primitive({ {"mesh", "$.wall"}, {"material", "$.diffuse"} });
+    scene->add_primitive({ {"mesh", "$.light_mesh"}, {"material", "$.black"}, {"light", "$.light"} });
+    scene->build();
+
+    // Reference rendered by path tracing
+    const int w = 16;
+    const int h = 16;
+    auto* film_ref = dynamic_cast<lm::Film*>(assets->load_asset("film_ref", "film::bitmap", { {"w", w}, {"h", h} }));
+    REQUIRE(film_ref);
+    auto* pt = dynamic_cast<lm::Renderer*>(assets->load_asset("pt", "renderer::pt", {
+        {"scene", "$.scene"},
+        {"output", "$.film_ref"},
+        {"scheduler", "sample"},
+        {"spp", 256},
+        {"max_length", 8},
+        {"seed", 42}
+    }));
+    REQUIRE(pt);
+    pt->render();
+
+    auto* film = dynamic_cast<lm::Film*>(assets->load_asset("film", "film::bitmap", { {"w", w}, {"h", h} }));
+    REQUIRE(film);
+    auto* renderer = dynamic_cast<lm::Renderer*>(assets->load_asset("renderer", "renderer::irradiancecache", {
+        {"scene", "$.scene"},
+        {"output", "$.film"},
+        {"spp", 16},
+        {"max_length", 8},
+        {"seed", 42}
+    }));
+    REQUIRE(renderer);
+    renderer->render();
+
+    SUBCASE("Cache is hit") {
+        const auto stats = renderer->underlying_value();
+        const auto lookups = stats["cache_lookups"].get<long long>();
+        const auto hits = stats["cache_hits"].get<long long>();
+        CHECK(lookups > 0);
+        CHECK(hits > lookups / 2);
+    }
+
+    SUBCASE("Result is close to path tracing") {
+        const auto ref = average(film_ref);
+        const auto v = average(film);
+        REQUIRE(ref.x > 0);
+        for (int i = 0; i < 3; i++) {
+            CHECK(v[i] == doctest::Approx(ref[i]).epsilon(.1));
+        }
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,87 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/assetgroup.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/scene.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Path tracing renderer with multiple views") {
+    lm::log::ScopedInit log_;
+    lm::parallel::ScopedInit parallel_;
+
+    auto assets = lm::comp::create<lm::AssetGroup>("asset_group::default", "$");
+    REQUIRE(assets);
+    lm::comp::detail::register_root_comp(assets.get());
+
+    // Quad lit by an area light seen from two cameras
+    REQUIRE(assets->load_asset("quad", "mesh::raw", {
+        {"ps", {-1,-1,-1, 1,-1,-1, 1,1,-1, -1,1,-1}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"t", {0,0,0,0,0,0}},
+            {"n", {0,0,0,0,0,0}}
+        }}
+    }));
+    REQUIRE(assets->load_asset("black", "material::diffuse", { {"Kd", {0,0,0}} }));
+    REQUIRE(assets->load_asset("light", "light::area", {
+        {"Ke", {1,1,1}},
+        {"mesh", "$.quad"}
+    }));
+    for (const auto& [name, x] : { std::pair<std::string, double>{"camera1", -.5}, {"camera2", .5} }) {
+        REQUIRE(assets->load_asset(name, "camera::pinhole", {
+            {"position", {x,0,5}},
+            {"center", {x,0,0}},
+            {"up", {0,1,0}},
+            {"vfov", 30}
+        }));
+    }
+    REQUIRE(assets->load_asset("accel", "accel::sahbvh", {}));
+    auto* scene = dynamic_cast<lm::Scene*>(assets->load_asset("scene", "scene::default", {
+        {"accel", "$.accel"}
+    }));
+    REQUIRE(scene);
+    scene->add_primitive({ {"camera", "$.camera1"} });
+    scene->add_primitive({ {"camera", "$.camera2"} });
+    scene->add_primitive({ {"mesh", "$.quad"}, {"material", "$.black"}, {"light", "$.light"} });
+    scene->build();
+
+    auto* film1 = dynamic_cast<lm::Film*>(assets->load_asset("film1", "film::bitmap", { {"w", 8}, {"h", 4} }));
+    auto* film2 = dynamic_cast<lm::Film*>(assets->load_asset("film2", "film::bitmap", { {"w", 8}, {"h", 4} }));
+    REQUIRE(film1);
+    REQUIRE(film2);
+
+    // The sampler refers to the film of the first view
+    auto* renderer = dynamic_cast<lm::Renderer*>(assets->load_asset("renderer", "renderer::pt", {
+        {"scene", "$.scene"},
+        {"views", {
+            { {"output", "$.film1"}, {"camera", "$.camera1"} },
+            { {"output", "$.film2"}, {"camera", "$.camera2"} }
+        }},
+        {"scheduler", "sample"},
+        {"sampler", "sobol_bluenoise"},
+        {"spp", 4},
+        {"max_length", 2},
+        {"seed", 42}
+    }));
+    REQUIRE(renderer);
+    renderer->render();
+
+    // The quad covers the center of both images
+    for (auto* film : { film1, film2 }) {
+        const auto buf = film->buffer();
+        const int i = 2*buf.w + 4;
+        CHECK(buf.data[3*i] > 0);
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,107 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/sampler.h>
+#include <lm/assetgroup.h>
+#include <lm/film.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Sampler") {
+    lm::log::ScopedInit log_;
+
+    auto sampler = lm::comp::create<lm::Sampler>("sampler::sobol", "", {
+        {"seed", 1}
+    });
+    REQUIRE(sampler);
+
+    SUBCASE("Values are deterministic and in [0,1)") {
+        for (int dim = 0; dim < 8; dim++) {
+            for (int i = 0; i < 64; i++) {
+                const auto u = sampler->u(3, i, dim);
+                CHECK(u >= 0);
+                CHECK(u < 1);
+                CHECK(u == sampler->u(3, i, dim));
+            }
+        }
+    }
+
+    SUBCASE("Samples are stratified in pairs of dimensions") {
+        // 16 samples of a pixel occupy all cells of 4x4 grid
+        for (int dim = 0; dim < 8; dim += 2) {
+            std::vector<int> count(16, 0);
+            for (int i = 0; i < 16; i++) {
+                const int x = int(sampler->u(0, i, dim) * 4);
+                const int y = int(sampler->u(0, i, dim + 1) * 4);
+                count[y*4 + x]++;
+            }
+            for (int c : count) {
+                CHECK(c == 1);
+            }
+        }
+    }
+
+    SUBCASE("Rng returns values of consecutive dimensions") {
+        lm::Rng rng(0, 5, 7, sampler.get());
+        for (int dim = 0; dim < 4; dim++) {
+            CHECK(rng.u() == doctest::Approx(sampler->u(5, 7, dim)));
+        }
+    }
+}
+
+TEST_CASE("Sampler with blue noise dithering") {
+    lm::log::ScopedInit log_;
+
+    auto assets = lm::comp::create<lm::AssetGroup>("asset_group::default", "$");
+    REQUIRE(assets);
+    lm::comp::detail::register_root_comp(assets.get());
+
+    // Film of the same size as the dither mask
+    const int w = 64;
+    const int h = 64;
+    REQUIRE(assets->load_asset("film", "film::bitmap", { {"w", w}, {"h", h} }));
+    auto* sampler = dynamic_cast<lm::Sampler*>(assets->load_asset("sampler", "sampler::sobol_bluenoise", {
+        {"seed", 1},
+        {"output", "$.film"}
+    }));
+    REQUIRE(sampler);
+
+    SUBCASE("Values are deterministic and in [0,1)") {
+        // Sampler constructed with the same seed generates the same values
+        auto* sampler2 = dynamic_cast<lm::Sampler*>(assets->load_asset("sampler2", "sampler::sobol_bluenoise", {
+            {"seed", 1},
+            {"output", "$.film"}
+        }));
+        REQUIRE(sampler2);
+        for (int dim = 0; dim < 8; dim++) {
+            for (long long pixel_index : {0LL, 1LL, 65LL, 4095LL}) {
+                for (int i = 0; i < 16; i++) {
+                    const auto u = sampler->u(pixel_index, i, dim);
+                    CHECK(u >= 0);
+                    CHECK(u < 1);
+                    CHECK(u == sampler->u(pixel_index, i, dim));
+                    CHECK(u == sampler2->u(pixel_index, i, dim));
+                }
+            }
+        }
+    }
+
+    SUBCASE("Pixels of the mask are rotated to different strata") {
+        // A sample of all pixels in the mask occupies all strata of [0,1)
+        for (int dim = 0; dim < 4; dim++) {
+            std::vector<int> count(w*h, 0);
+            for (int i = 0; i < w*h; i++) {
+                count[std::min(int(sampler->u(i, 0, dim) * (w*h)), w*h - 1)]++;
+            }
+            for (int c : count) {
+                CHECK(c == 1);
+            }
+        }
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -6,6 +6,7 @@
 #include <pch.h>
 #include "test_common.h"
 #include <lm/serial.h>
+#include <lm/blob.h>
 #include <lm/math.h>
 
 // Serializaition helper
@@ -278,6 +279,59 @@ TEST_CASE("Serialization") {
         }
     }
 
+    SUBCASE("Blob") {
+        SUBCASE("In the stream") {
+            lm::Blob<int> orig(std::vector<int>{ 1, 2, 3 });
+            std::stringstream ss;
+            lm::serial::save(ss, orig);
+            lm::Blob<int> loaded;
+            lm::serial::load(ss, loaded);
+            CHECK(!loaded.mapped());
+            CHECK(std::vector<int>(loaded.begin(), loaded.end()) == std::vector<int>{ 1, 2, 3 });
+        }
+
+        SUBCASE("In the blob region") {
+            lm::Blob<int> orig1(std::vector<int>{ 1, 2, 3 });
+            lm::Blob<int> orig2(std::vector<int>{ 4, 5 });
+            std::stringstream ss;
+            auto region = std::make_shared<std::vector<char>>();
+            {
+                lm::OutputArchive ar(ss);
+                ar.enable_blobs();
+                ar(orig1, orig2);
+                region->resize(ar.blobs_size());
+                ar.foreach_blob([&](uint64_t offset, const void* data, size_t size) {
+                    CHECK(offset % lm::OutputArchive::BlobAlignment == 0);
+                    std::memcpy(region->data() + offset, data, size);
+                });
+            }
+
+            // Only the offsets and sizes are written in the stream
+            // in addition to the preamble of the archive
+            std::stringstream empty;
+            {
+                lm::OutputArchive ar(empty);
+            }
+            CHECK(ss.str().size() == empty.str().size() + 2 * (sizeof(uint8_t) + 2 * sizeof(uint64_t)));
+
+            lm::Blob<int> loaded1, loaded2;
+            {
+                lm::InputArchive ar(ss);
+                ar.set_blobs(region->data(), region->size(), region);
+                ar(loaded1, loaded2);
+            }
+            CHECK(loaded1.mapped());
+            CHECK(loaded2.mapped());
+            CHECK(std::vector<int>(loaded1.begin(), loaded1.end()) == std::vector<int>{ 1, 2, 3 });
+            CHECK(std::vector<int>(loaded2.begin(), loaded2.end()) == std::vector<int>{ 4, 5 });
+
+            // Modification copies the elements
+            loaded1.vec().push_back(4);
+            CHECK(!loaded1.mapped());
+            CHECK(std::vector<int>(loaded1.begin(), loaded1.end()) == std::vector<int>{ 1, 2, 3, 4 });
+        }
+    }
+
     SUBCASE("Component") {
         SUBCASE("Unique pointer") {
             auto orig = lm::comp::create<lm::Component>("testserial_simple", "", {
@@ -382,6 +436,53 @@ TEST_CASE("Serialization") {
             CHECK(s1 == s2);
         }
 
+        SUBCASE("Weak references as indices to the table of locators") {
+            TestSerial_Root root;
+            root.p = lm::comp::create<TestSerial_Container>("testserial_container", "$.p");
+            auto* c = dynamic_cast<TestSerial_Container*>(root.p.get());
+            c->add("instances", "testserial_container", {});
+            c->add("references", "testserial_container", {});
+            auto* instances = lm::comp::get<TestSerial_Container>("$.p.instances");
+            instances->add("p1", "testserial_simple", { {"v1", 1}, {"v2", 2} });
+            instances->add("p2", "testserial_simple", { {"v1", 3}, {"v2", 4} });
+            auto* refs = lm::comp::get<TestSerial_Container>("$.p.references");
+            refs->add("r1", "testserial_ref", { {"ref", "$.p.instances.p1"} });
+            refs->add("r2", "testserial_ref", { {"ref", "$.p.instances.p1"} });
+            refs->add("r3", "testserial_ref", { {"ref", "$.p.instances.p2"} });
+
+            // Save with the table
+            std::stringstream ss;
+            {
+                lm::OutputArchive ar(ss, "", true);
+                ar(root.p);
+                ar.save_weakref_table();
+            }
+
+            // The locator appears once for the owned instance and once in the table
+            const auto s = ss.str();
+            int count = 0;
+            for (auto i = s.find("$.p.instances.p1"); i != std::string::npos; i = s.find("$.p.instances.p1", i + 1)) {
+                count++;
+            }
+            CHECK(count == 2);
+
+            // Load and recover the weak references
+            root.clear();
+            {
+                lm::InputArchive ar(ss, "", true);
+                ar(root.p);
+                ar.load_weakref_table();
+                lm::serial::resolve_weakptrs(ar);
+            }
+            auto* p1 = lm::comp::get<lm::Component>("$.p.instances.p1");
+            auto* p2 = lm::comp::get<lm::Component>("$.p.instances.p2");
+            REQUIRE(p1);
+            REQUIRE(p2);
+            CHECK(lm::comp::get<TestSerial_Ref>("$.p.references.r1")->p == p1);
+            CHECK(lm::comp::get<TestSerial_Ref>("$.p.references.r2")->p == p1);
+            CHECK(lm::comp::get<TestSerial_Ref>("$.p.references.r3")->p == p2);
+        }
+
         SUBCASE("AssetGroup") {
             // Round-trip tests for various assets
             SUBCASE("Film") {
@@ -0,0 +1,107 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/texture.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+// Texture with the texels computed from the pixel coordinates
+class TestTexture final : public lm::Texture {
+private:
+    int w_;
+    int h_;
+    std::vector<float> data_;
+
+public:
+    TestTexture(int w, int h) : w_(w), h_(h) {
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const auto v = expected(x, y);
+                data_.insert(data_.end(), { float(v.x), float(v.y), float(v.z) });
+            }
+        }
+    }
+
+    static lm::Vec3 expected(int x, int y) {
+        return lm::Vec3(x, y, x + y);
+    }
+
+    virtual lm::TextureSize size() const override {
+        return { w_, h_ };
+    }
+
+    virtual lm::Vec3 eval(lm::Vec2) const override {
+        return {};
+    }
+
+    virtual lm::Vec3 eval_by_pixel_coords(int x, int y) const override {
+        return expected(x, y);
+    }
+
+    virtual lm::TextureBuffer buffer() override {
+        return { w_, h_, 3, data_.data() };
+    }
+};
+
+TEST_CASE("Tiled texture") {
+    lm::log::ScopedInit log_;
+
+    const int w = 100;
+    const int h = 70;
+    TestTexture original(w, h);
+    const auto path = (fs::temp_directory_path() / "lm_test_texture.lmtex").string();
+    lm::texture::save_tiled(&original, path, 16);
+
+    SUBCASE("Texels are the same as the original texture") {
+        const auto texture = lm::comp::create<lm::Texture>("texture::tiled", "", {
+            {"path", path},
+            {"filter", "nearest"}
+        });
+        REQUIRE(texture);
+        CHECK(texture->size().w == w);
+        CHECK(texture->size().h == h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                CHECK(texture->eval_by_pixel_coords(x, y) == TestTexture::expected(x, y));
+            }
+        }
+    }
+
+    SUBCASE("Tiles are evicted under the budget") {
+        const size_t tile_bytes = 16 * 16 * 3 * sizeof(float);
+        lm::texture::set_tile_cache_budget(4 * tile_bytes);
+        {
+            const auto texture = lm::comp::create<lm::Texture>("texture::tiled", "", {
+                {"path", path}
+            });
+            REQUIRE(texture);
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    CHECK(texture->eval_by_pixel_coords(x, y) == TestTexture::expected(x, y));
+                    CHECK(lm::texture::tile_cache_size() <= 4 * tile_bytes);
+                }
+            }
+        }
+        // Tiles are removed with the texture
+        CHECK(lm::texture::tile_cache_size() == 0);
+        lm::texture::set_tile_cache_budget(size_t(1) << 30);
+    }
+
+    SUBCASE("Invalid file") {
+        {
+            std::ofstream f(path);
+            f << "invalid";
+        }
+        CHECK_THROWS(lm::comp::create<lm::Texture>("texture::tiled", "", {
+            {"path", path}
+        }));
+    }
+
+    fs::remove(path);
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)